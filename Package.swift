@@ -0,0 +1,21 @@
+// swift-tools-version:5.5
+//
+// The sources of the app under ShadowsocksX-NG/Core only need Foundation.
+// This package builds them and runs their tests with SwiftPM, e.g. on Linux:
+// make swift-test. The app compiles the same files with Xcode.
+//
+
+import PackageDescription
+
+let package = Package(
+    name: "ShadowsocksX-NG",
+    targets: [
+        .target(
+            name: "ShadowsocksXNGCore",
+            path: "ShadowsocksX-NG/Core"),
+        .testTarget(
+            name: "ShadowsocksXNGCoreTests",
+            dependencies: ["ShadowsocksXNGCore"],
+            path: "ShadowsocksX-NGTests/Core"),
+    ]
+)
@@ -124,12 +124,34 @@ extern NSString* const GCDWebServerOption_BindToLocalhost;
 
 /**
  *  The maximum number of incoming HTTP requests that can be queued waiting to
- *  be handled before new ones are dropped (NSNumber / NSUInteger).
+ *  be handled before new ones are dropped (NSNumber / NSUInteger). This is
+ *  the backlog of the listening sockets, which the system caps at
+ *  kern.ipc.somaxconn.
  *
  *  The default value is 16.
  */
 extern NSString* const GCDWebServerOption_MaxPendingConnections;
 
+/**
+ *  The number of dispatch sources accepting connections on each listening
+ *  socket (NSNumber / NSUInteger). Each source accepts every connection
+ *  pending when it fires, and several sources accept a burst of connections
+ *  from several threads at once.
+ *
+ *  The default value is 1.
+ */
+extern NSString* const GCDWebServerOption_AcceptSources;
+
+/**
+ *  The maximum number of connections open at once from a single client IP
+ *  address (NSNumber / NSUInteger). Connections over the limit are closed as
+ *  soon as they are accepted. Clients on the loopback interface are never
+ *  limited.
+ *
+ *  The default value is 0 i.e. unlimited.
+ */
+extern NSString* const GCDWebServerOption_MaxConnectionsPerClient;
+
 /**
  *  The value for "Server" HTTP header used by the GCDWebServer (NSString).
  *
@@ -194,6 +216,24 @@ extern NSString* const GCDWebServerOption_ConnectedStateCoalescingInterval;
  */
 extern NSString* const GCDWebServerOption_DispatchQueuePriority;
 
+/**
+ *  The interval expressed in seconds a connection is kept open after a
+ *  response, waiting for the next request from the same client
+ *  (NSNumber / double). Persistent connections are disabled if the interval
+ *  is <= 0.0, and every response then closes its connection.
+ *
+ *  The default value is 5.0 seconds.
+ */
+extern NSString* const GCDWebServerOption_ConnectionIdleTimeout;
+
+/**
+ *  The maximum number of requests served on a single persistent connection
+ *  before it is closed (NSNumber / NSUInteger).
+ *
+ *  The default value is 100.
+ */
+extern NSString* const GCDWebServerOption_MaxRequestsPerConnection;
+
 #if TARGET_OS_IPHONE
 
 /**
@@ -334,6 +374,23 @@ extern NSString* const GCDWebServerAuthenticationMethod_DigestAccess;
  */
 @property(nonatomic, readonly, nullable) NSString* bonjourType;
 
+/**
+ *  Returns the number of connections currently open.
+ */
+@property(nonatomic, readonly) NSUInteger activeConnectionCount;
+
+/**
+ *  Returns the number of connections opened since the server was created,
+ *  across restarts.
+ */
+@property(nonatomic, readonly) NSUInteger totalConnectionCount;
+
+/**
+ *  Returns the number of connections closed as soon as they were accepted
+ *  since the server was created, as over GCDWebServerOption_MaxConnectionsPerClient.
+ */
+@property(nonatomic, readonly) NSUInteger refusedConnectionCount;
+
 /**
  *  This method is the designated initializer for the class.
  */
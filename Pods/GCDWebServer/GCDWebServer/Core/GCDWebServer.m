@@ -38,6 +38,7 @@
 #endif
 #endif
 #import <netinet/in.h>
+#import <fcntl.h>
 #import <dns_sd.h>
 
 #import "GCDWebServerPrivate.h"
@@ -56,6 +57,8 @@ NSString* const GCDWebServerOption_BonjourType = @"BonjourType";
 NSString* const GCDWebServerOption_RequestNATPortMapping = @"RequestNATPortMapping";
 NSString* const GCDWebServerOption_BindToLocalhost = @"BindToLocalhost";
 NSString* const GCDWebServerOption_MaxPendingConnections = @"MaxPendingConnections";
+NSString* const GCDWebServerOption_AcceptSources = @"AcceptSources";
+NSString* const GCDWebServerOption_MaxConnectionsPerClient = @"MaxConnectionsPerClient";
 NSString* const GCDWebServerOption_ServerName = @"ServerName";
 NSString* const GCDWebServerOption_AuthenticationMethod = @"AuthenticationMethod";
 NSString* const GCDWebServerOption_AuthenticationRealm = @"AuthenticationRealm";
@@ -64,6 +67,8 @@ NSString* const GCDWebServerOption_ConnectionClass = @"ConnectionClass";
 NSString* const GCDWebServerOption_AutomaticallyMapHEADToGET = @"AutomaticallyMapHEADToGET";
 NSString* const GCDWebServerOption_ConnectedStateCoalescingInterval = @"ConnectedStateCoalescingInterval";
 NSString* const GCDWebServerOption_DispatchQueuePriority = @"DispatchQueuePriority";
+NSString* const GCDWebServerOption_ConnectionIdleTimeout = @"ConnectionIdleTimeout";
+NSString* const GCDWebServerOption_MaxRequestsPerConnection = @"MaxRequestsPerConnection";
 #if TARGET_OS_IPHONE
 NSString* const GCDWebServerOption_AutomaticallySuspendInBackground = @"AutomaticallySuspendInBackground";
 #endif
@@ -134,10 +139,11 @@ static void _ExecuteMainThreadRunLoopSources() {
 
 @implementation GCDWebServerHandler
 
-- (instancetype)initWithMatchBlock:(GCDWebServerMatchBlock _Nonnull)matchBlock asyncProcessBlock:(GCDWebServerAsyncProcessBlock _Nonnull)processBlock {
+- (instancetype)initWithMatchBlock:(GCDWebServerMatchBlock _Nonnull)matchBlock asyncProcessBlock:(GCDWebServerAsyncProcessBlock _Nonnull)processBlock order:(NSUInteger)order {
   if ((self = [super init])) {
     _matchBlock = [matchBlock copy];
     _asyncProcessBlock = [processBlock copy];
+    _order = order;
   }
   return self;
 }
@@ -148,7 +154,13 @@ static void _ExecuteMainThreadRunLoopSources() {
   dispatch_queue_t _syncQueue;
   dispatch_group_t _sourceGroup;
   NSMutableArray<GCDWebServerHandler*>* _handlers;
+  NSMutableDictionary<NSString*, NSMutableDictionary<NSString*, GCDWebServerHandler*>*>* _exactHandlers;  // Method to lowercase path to handler
+  NSUInteger _handlerCount;
   NSInteger _activeConnections;  // Accessed through _syncQueue only
+  NSUInteger _totalConnections;  // Accessed through _syncQueue only
+  NSUInteger _refusedConnections;  // Accessed through _syncQueue only
+  NSCountedSet<NSData*>* _clientConnections;  // Open connections by client address, accessed through _syncQueue only
+  NSUInteger _maxConnectionsPerClient;
   BOOL _connected;  // Accessed on main thread only
   CFRunLoopTimerRef _disconnectTimer;  // Accessed on main thread only
 
@@ -157,8 +169,10 @@ static void _ExecuteMainThreadRunLoopSources() {
   NSMutableDictionary<NSString*, NSString*>* _authenticationDigestAccounts;
   Class _connectionClass;
   CFTimeInterval _disconnectDelay;
-  dispatch_source_t _source4;
-  dispatch_source_t _source6;
+  dispatch_source_t* _sources;  // The IPv4 accept sources then the IPv6 ones, NULL while not started
+  NSUInteger _sourceCount;
+  int _listeningSocket4;
+  int _listeningSocket6;
   CFNetServiceRef _registrationService;
   CFNetServiceRef _resolutionService;
   DNSServiceRef _dnsService;
@@ -185,6 +199,8 @@ static void _ExecuteMainThreadRunLoopSources() {
     _syncQueue = dispatch_queue_create([NSStringFromClass([self class]) UTF8String], DISPATCH_QUEUE_SERIAL);
     _sourceGroup = dispatch_group_create();
     _handlers = [[NSMutableArray alloc] init];
+    _exactHandlers = [[NSMutableDictionary alloc] init];
+    _clientConnections = [[NSCountedSet alloc] init];
 #if TARGET_OS_IPHONE
     _backgroundTask = UIBackgroundTaskInvalid;
 #endif
@@ -240,6 +256,19 @@ static void _ExecuteMainThreadRunLoopSources() {
   }
 }
 
+// The address of a client without its port, or nil for loopback clients which are never limited
+static NSData* _ClientAddress(const struct sockaddr* address) {
+  if (address->sa_family == AF_INET) {
+    const struct in_addr* addr = &((const struct sockaddr_in*)address)->sin_addr;
+    return (ntohl(addr->s_addr) >> IN_CLASSA_NSHIFT) == IN_LOOPBACKNET ? nil : [NSData dataWithBytes:addr length:sizeof(*addr)];
+  }
+  if (address->sa_family == AF_INET6) {
+    const struct in6_addr* addr = &((const struct sockaddr_in6*)address)->sin6_addr;
+    return IN6_IS_ADDR_LOOPBACK(addr) ? nil : [NSData dataWithBytes:addr length:sizeof(*addr)];
+  }
+  return nil;
+}
+
 - (void)willStartConnection:(GCDWebServerConnection*)connection {
   dispatch_sync(_syncQueue, ^{
     GWS_DCHECK(self->_activeConnections >= 0);
@@ -256,7 +285,32 @@ static void _ExecuteMainThreadRunLoopSources() {
       });
     }
     self->_activeConnections += 1;
+    self->_totalConnections += 1;
+  });
+}
+
+- (NSUInteger)activeConnectionCount {
+  __block NSUInteger count;
+  dispatch_sync(_syncQueue, ^{
+    count = self->_activeConnections;
+  });
+  return count;
+}
+
+- (NSUInteger)totalConnectionCount {
+  __block NSUInteger count;
+  dispatch_sync(_syncQueue, ^{
+    count = self->_totalConnections;
+  });
+  return count;
+}
+
+- (NSUInteger)refusedConnectionCount {
+  __block NSUInteger count;
+  dispatch_sync(_syncQueue, ^{
+    count = self->_refusedConnections;
   });
+  return count;
 }
 
 #if TARGET_OS_IPHONE
@@ -265,7 +319,7 @@ static void _ExecuteMainThreadRunLoopSources() {
 - (void)_endBackgroundTask {
   GWS_DCHECK([NSThread isMainThread]);
   if (_backgroundTask != UIBackgroundTaskInvalid) {
-    if (_suspendInBackground && ([[UIApplication sharedApplication] applicationState] == UIApplicationStateBackground) && _source4) {
+    if (_suspendInBackground && ([[UIApplication sharedApplication] applicationState] == UIApplicationStateBackground) && _sources) {
       [self _stop];
     }
     [[UIApplication sharedApplication] endBackgroundTask:_backgroundTask];
@@ -293,12 +347,16 @@ static void _ExecuteMainThreadRunLoopSources() {
 }
 
 - (void)didEndConnection:(GCDWebServerConnection*)connection {
+  NSData* clientAddress = _ClientAddress(connection.remoteAddressData.bytes);
   dispatch_sync(_syncQueue, ^{
+    if (clientAddress) {
+      [self->_clientConnections removeObject:clientAddress];
+    }
     GWS_DCHECK(self->_activeConnections > 0);
     self->_activeConnections -= 1;
     if (self->_activeConnections == 0) {
       dispatch_async(dispatch_get_main_queue(), ^{
-        if ((self->_disconnectDelay > 0.0) && (self->_source4 != NULL)) {
+        if ((self->_disconnectDelay > 0.0) && (self->_sources != NULL)) {
           if (self->_disconnectTimer) {
             CFRunLoopTimerInvalidate(self->_disconnectTimer);
             CFRelease(self->_disconnectTimer);
@@ -337,13 +395,41 @@ static void _ExecuteMainThreadRunLoopSources() {
 
 - (void)addHandlerWithMatchBlock:(GCDWebServerMatchBlock)matchBlock asyncProcessBlock:(GCDWebServerAsyncProcessBlock)processBlock {
   GWS_DCHECK(_options == nil);
-  GCDWebServerHandler* handler = [[GCDWebServerHandler alloc] initWithMatchBlock:matchBlock asyncProcessBlock:processBlock];
+  GCDWebServerHandler* handler = [[GCDWebServerHandler alloc] initWithMatchBlock:matchBlock asyncProcessBlock:processBlock order:++_handlerCount];
   [_handlers insertObject:handler atIndex:0];
 }
 
+// Non-ASCII paths are left to the block matchers, as -caseInsensitiveCompare: and -lowercaseString do not fold them alike.
+static inline BOOL _IsExactHandlerPath(NSString* path) {
+  return [path canBeConvertedToEncoding:NSASCIIStringEncoding];
+}
+
+// Like -addHandlerWithMatchBlock:asyncProcessBlock: but also files the handler
+// under its method and path, so requests for them find it without running
+// every match block.
+- (void)_addExactHandlerForMethod:(NSString*)method path:(NSString*)path matchBlock:(GCDWebServerMatchBlock)matchBlock asyncProcessBlock:(GCDWebServerAsyncProcessBlock)processBlock {
+  GWS_DCHECK(_options == nil);
+  GCDWebServerHandler* handler = [[GCDWebServerHandler alloc] initWithMatchBlock:matchBlock asyncProcessBlock:processBlock order:++_handlerCount];
+  NSMutableDictionary<NSString*, GCDWebServerHandler*>* paths = _exactHandlers[method];
+  if (paths == nil) {
+    paths = [[NSMutableDictionary alloc] init];
+    _exactHandlers[method] = paths;
+  }
+  paths[[path lowercaseString]] = handler;  // Replaces any handler it would have shadowed
+}
+
+- (GCDWebServerHandler*)exactHandlerForMethod:(NSString*)method path:(NSString*)path {
+  NSDictionary<NSString*, GCDWebServerHandler*>* paths = _exactHandlers[method];
+  if ((paths == nil) || !_IsExactHandlerPath(path)) {
+    return nil;
+  }
+  return paths[[path lowercaseString]];
+}
+
 - (void)removeAllHandlers {
   GWS_DCHECK(_options == nil);
   [_handlers removeAllObjects];
+  [_exactHandlers removeAllObjects];
 }
 
 static void _NetServiceRegisterCallBack(CFNetServiceRef service, CFStreamError* error, void* info) {
@@ -443,6 +529,7 @@ static inline NSString* _EncodeBase64(NSString* string) {
 
     if (bind(listeningSocket, address, length) == 0) {
       if (listen(listeningSocket, (int)maxPendingConnections) == 0) {
+        fcntl(listeningSocket, F_SETFL, fcntl(listeningSocket, F_GETFL) | O_NONBLOCK);  // Accept sources race for the pending connections
         GWS_LOG_DEBUG(@"Did open %s listening socket %i", useIPv6 ? "IPv6" : "IPv4", listeningSocket);
         return listeningSocket;
       } else {
@@ -469,45 +556,80 @@ static inline NSString* _EncodeBase64(NSString* string) {
   return -1;
 }
 
+- (void)_closeListeningSocket:(int)listeningSocket isIPv6:(BOOL)isIPv6 {
+  int result = close(listeningSocket);
+  if (result != 0) {
+    GWS_LOG_ERROR(@"Failed closing %s listening socket: %s (%i)", isIPv6 ? "IPv6" : "IPv4", strerror(errno), errno);
+  } else {
+    GWS_LOG_DEBUG(@"Did close %s listening socket %i", isIPv6 ? "IPv6" : "IPv4", listeningSocket);
+  }
+}
+
+// Returns NO once there is no pending connection left to accept
+- (BOOL)_acceptConnectionOnListeningSocket:(int)listeningSocket isIPv6:(BOOL)isIPv6 {
+  struct sockaddr_storage remoteSockAddr;
+  socklen_t remoteAddrLen = sizeof(remoteSockAddr);
+  int socket = accept(listeningSocket, (struct sockaddr*)&remoteSockAddr, &remoteAddrLen);
+  if (socket < 0) {
+    if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != ECONNABORTED)) {  // Accepted by another source, or reset by the client while pending
+      GWS_LOG_ERROR(@"Failed accepting %s socket: %s (%i)", isIPv6 ? "IPv6" : "IPv4", strerror(errno), errno);
+    }
+    return NO;
+  }
+  fcntl(socket, F_SETFL, fcntl(socket, F_GETFL) & ~O_NONBLOCK);  // Inherited from the listening socket
+
+  NSData* clientAddress = _ClientAddress((struct sockaddr*)&remoteSockAddr);
+  if (clientAddress) {
+    __block BOOL refused = NO;
+    dispatch_sync(_syncQueue, ^{
+      if (self->_maxConnectionsPerClient && ([self->_clientConnections countForObject:clientAddress] >= self->_maxConnectionsPerClient)) {
+        refused = YES;
+        self->_refusedConnections += 1;
+      } else {
+        [self->_clientConnections addObject:clientAddress];
+      }
+    });
+    if (refused) {
+      GWS_LOG_WARNING(@"Refused connection from %@ over the limit of %lu per client", GCDWebServerStringFromSockAddr((struct sockaddr*)&remoteSockAddr, NO), (unsigned long)_maxConnectionsPerClient);
+      close(socket);
+      return YES;
+    }
+  }
+
+  NSData* remoteAddress = [NSData dataWithBytes:&remoteSockAddr length:remoteAddrLen];
+
+  struct sockaddr_storage localSockAddr;
+  socklen_t localAddrLen = sizeof(localSockAddr);
+  NSData* localAddress = nil;
+  if (getsockname(socket, (struct sockaddr*)&localSockAddr, &localAddrLen) == 0) {
+    localAddress = [NSData dataWithBytes:&localSockAddr length:localAddrLen];
+    GWS_DCHECK((!isIPv6 && localSockAddr.ss_family == AF_INET) || (isIPv6 && localSockAddr.ss_family == AF_INET6));
+  } else {
+    GWS_DNOT_REACHED();
+  }
+
+  int noSigPipe = 1;
+  setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));  // Make sure this socket cannot generate SIG_PIPE
+
+  GCDWebServerConnection* connection = [(GCDWebServerConnection*)[_connectionClass alloc] initWithServer:self localAddress:localAddress remoteAddress:remoteAddress socket:socket];  // Connection will automatically retain itself while opened
+  [connection self];  // Prevent compiler from complaining about unused variable / useless statement
+  return YES;
+}
+
 - (dispatch_source_t)_createDispatchSourceWithListeningSocket:(int)listeningSocket isIPv6:(BOOL)isIPv6 {
   dispatch_group_enter(_sourceGroup);
   dispatch_source_t source = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, listeningSocket, 0, dispatch_get_global_queue(_dispatchQueuePriority, 0));
   dispatch_source_set_cancel_handler(source, ^{
-    @autoreleasepool {
-      int result = close(listeningSocket);
-      if (result != 0) {
-        GWS_LOG_ERROR(@"Failed closing %s listening socket: %s (%i)", isIPv6 ? "IPv6" : "IPv4", strerror(errno), errno);
-      } else {
-        GWS_LOG_DEBUG(@"Did close %s listening socket %i", isIPv6 ? "IPv6" : "IPv4", listeningSocket);
-      }
-    }
     dispatch_group_leave(self->_sourceGroup);
   });
   dispatch_source_set_event_handler(source, ^{
     @autoreleasepool {
-      struct sockaddr_storage remoteSockAddr;
-      socklen_t remoteAddrLen = sizeof(remoteSockAddr);
-      int socket = accept(listeningSocket, (struct sockaddr*)&remoteSockAddr, &remoteAddrLen);
-      if (socket > 0) {
-        NSData* remoteAddress = [NSData dataWithBytes:&remoteSockAddr length:remoteAddrLen];
-
-        struct sockaddr_storage localSockAddr;
-        socklen_t localAddrLen = sizeof(localSockAddr);
-        NSData* localAddress = nil;
-        if (getsockname(socket, (struct sockaddr*)&localSockAddr, &localAddrLen) == 0) {
-          localAddress = [NSData dataWithBytes:&localSockAddr length:localAddrLen];
-          GWS_DCHECK((!isIPv6 && localSockAddr.ss_family == AF_INET) || (isIPv6 && localSockAddr.ss_family == AF_INET6));
-        } else {
-          GWS_DNOT_REACHED();
+      // Drains the connections pending when the source fired instead of one per event, so bursts do not overflow the backlog
+      unsigned long pending = MAX(dispatch_source_get_data(source), 1UL);
+      for (unsigned long i = 0; i < pending; ++i) {
+        if (![self _acceptConnectionOnListeningSocket:listeningSocket isIPv6:isIPv6]) {
+          break;
         }
-
-        int noSigPipe = 1;
-        setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));  // Make sure this socket cannot generate SIG_PIPE
-
-        GCDWebServerConnection* connection = [(GCDWebServerConnection*)[self->_connectionClass alloc] initWithServer:self localAddress:localAddress remoteAddress:remoteAddress socket:socket];  // Connection will automatically retain itself while opened
-        [connection self];  // Prevent compiler from complaining about unused variable / useless statement
-      } else {
-        GWS_LOG_ERROR(@"Failed accepting %s socket: %s (%i)", isIPv6 ? "IPv6" : "IPv4", strerror(errno), errno);
       }
     }
   });
@@ -515,7 +637,7 @@ static inline NSString* _EncodeBase64(NSString* string) {
 }
 
 - (BOOL)_start:(NSError**)error {
-  GWS_DCHECK(_source4 == NULL);
+  GWS_DCHECK(_sources == NULL);
 
   NSUInteger port = [(NSNumber*)_GetOption(_options, GCDWebServerOption_Port, @0) unsignedIntegerValue];
   BOOL bindToLocalhost = [(NSNumber*)_GetOption(_options, GCDWebServerOption_BindToLocalhost, @NO) boolValue];
@@ -574,9 +696,19 @@ static inline NSString* _EncodeBase64(NSString* string) {
   _shouldAutomaticallyMapHEADToGET = [(NSNumber*)_GetOption(_options, GCDWebServerOption_AutomaticallyMapHEADToGET, @YES) boolValue];
   _disconnectDelay = [(NSNumber*)_GetOption(_options, GCDWebServerOption_ConnectedStateCoalescingInterval, @1.0) doubleValue];
   _dispatchQueuePriority = [(NSNumber*)_GetOption(_options, GCDWebServerOption_DispatchQueuePriority, @(DISPATCH_QUEUE_PRIORITY_DEFAULT)) longValue];
-
-  _source4 = [self _createDispatchSourceWithListeningSocket:listeningSocket4 isIPv6:NO];
-  _source6 = [self _createDispatchSourceWithListeningSocket:listeningSocket6 isIPv6:YES];
+  _connectionIdleTimeout = [(NSNumber*)_GetOption(_options, GCDWebServerOption_ConnectionIdleTimeout, @5.0) doubleValue];
+  _maxRequestsPerConnection = [(NSNumber*)_GetOption(_options, GCDWebServerOption_MaxRequestsPerConnection, @100) unsignedIntegerValue];
+  _maxConnectionsPerClient = [(NSNumber*)_GetOption(_options, GCDWebServerOption_MaxConnectionsPerClient, @0) unsignedIntegerValue];
+  NSUInteger acceptSources = MAX([(NSNumber*)_GetOption(_options, GCDWebServerOption_AcceptSources, @1) unsignedIntegerValue], 1);
+
+  _sourceCount = 2 * acceptSources;
+  _sources = calloc(_sourceCount, sizeof(dispatch_source_t));
+  for (NSUInteger i = 0; i < acceptSources; ++i) {
+    _sources[i] = [self _createDispatchSourceWithListeningSocket:listeningSocket4 isIPv6:NO];
+    _sources[acceptSources + i] = [self _createDispatchSourceWithListeningSocket:listeningSocket6 isIPv6:YES];
+  }
+  _listeningSocket4 = listeningSocket4;
+  _listeningSocket6 = listeningSocket6;
   _port = port;
   _bindToLocalhost = bindToLocalhost;
 
@@ -627,8 +759,9 @@ static inline NSString* _EncodeBase64(NSString* string) {
     }
   }
 
-  dispatch_resume(_source4);
-  dispatch_resume(_source6);
+  for (NSUInteger i = 0; i < _sourceCount; ++i) {
+    dispatch_resume(_sources[i]);
+  }
   GWS_LOG_INFO(@"%@ started on port %i and reachable at %@", [self class], (int)_port, self.serverURL);
   if ([_delegate respondsToSelector:@selector(webServerDidStart:)]) {
     dispatch_async(dispatch_get_main_queue(), ^{
@@ -640,7 +773,7 @@ static inline NSString* _EncodeBase64(NSString* string) {
 }
 
 - (void)_stop {
-  GWS_DCHECK(_source4 != NULL);
+  GWS_DCHECK(_sources != NULL);
 
   if (_dnsService) {
     _dnsAddress = nil;
@@ -673,17 +806,20 @@ static inline NSString* _EncodeBase64(NSString* string) {
     _registrationService = NULL;
   }
 
-  dispatch_source_cancel(_source6);
-  dispatch_source_cancel(_source4);
-  dispatch_group_wait(_sourceGroup, DISPATCH_TIME_FOREVER);  // Wait until the cancellation handlers have been called which guarantees the listening sockets are closed
-#if !OS_OBJECT_USE_OBJC_RETAIN_RELEASE
-  dispatch_release(_source6);
-#endif
-  _source6 = NULL;
+  for (NSUInteger i = 0; i < _sourceCount; ++i) {
+    dispatch_source_cancel(_sources[i]);
+  }
+  dispatch_group_wait(_sourceGroup, DISPATCH_TIME_FOREVER);  // Wait until the cancellation handlers have been called which guarantees no source accepts on the listening sockets anymore
+  for (NSUInteger i = 0; i < _sourceCount; ++i) {
 #if !OS_OBJECT_USE_OBJC_RETAIN_RELEASE
-  dispatch_release(_source4);
+    dispatch_release(_sources[i]);
 #endif
-  _source4 = NULL;
+  }
+  free(_sources);
+  _sources = NULL;
+  _sourceCount = 0;
+  [self _closeListeningSocket:_listeningSocket6 isIPv6:YES];
+  [self _closeListeningSocket:_listeningSocket4 isIPv6:NO];
   _port = 0;
   _bindToLocalhost = NO;
 
@@ -714,7 +850,7 @@ static inline NSString* _EncodeBase64(NSString* string) {
 - (void)_didEnterBackground:(NSNotification*)notification {
   GWS_DCHECK([NSThread isMainThread]);
   GWS_LOG_DEBUG(@"Did enter background");
-  if ((_backgroundTask == UIBackgroundTaskInvalid) && _source4) {
+  if ((_backgroundTask == UIBackgroundTaskInvalid) && _sources) {
     [self _stop];
   }
 }
@@ -722,7 +858,7 @@ static inline NSString* _EncodeBase64(NSString* string) {
 - (void)_willEnterForeground:(NSNotification*)notification {
   GWS_DCHECK([NSThread isMainThread]);
   GWS_LOG_DEBUG(@"Will enter foreground");
-  if (!_source4) {
+  if (!_sources) {
     [self _start:NULL];  // TODO: There's probably nothing we can do on failure
   }
 }
@@ -767,7 +903,7 @@ static inline NSString* _EncodeBase64(NSString* string) {
       [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationWillEnterForegroundNotification object:nil];
     }
 #endif
-    if (_source4) {
+    if (_sources) {
       [self _stop];
     }
     _options = nil;
@@ -781,7 +917,7 @@ static inline NSString* _EncodeBase64(NSString* string) {
 @implementation GCDWebServer (Extensions)
 
 - (NSURL*)serverURL {
-  if (_source4) {
+  if (_sources) {
     NSString* ipAddress = _bindToLocalhost ? @"localhost" : GCDWebServerGetPrimaryIPAddress(NO);  // We can't really use IPv6 anyway as it doesn't work great with HTTP URLs in practice
     if (ipAddress) {
       if (_port != 80) {
@@ -795,7 +931,7 @@ static inline NSString* _EncodeBase64(NSString* string) {
 }
 
 - (NSURL*)bonjourServerURL {
-  if (_source4 && _resolutionService) {
+  if (_sources && _resolutionService) {
     NSString* name = (__bridge NSString*)CFNetServiceGetTargetHost(_resolutionService);
     if (name.length) {
       name = [name substringToIndex:(name.length - 1)];  // Strip trailing period at end of domain
@@ -810,7 +946,7 @@ static inline NSString* _EncodeBase64(NSString* string) {
 }
 
 - (NSURL*)publicServerURL {
-  if (_source4 && _dnsService && _dnsAddress && _dnsPort) {
+  if (_sources && _dnsService && _dnsAddress && _dnsPort) {
     if (_dnsPort != 80) {
       return [NSURL URLWithString:[NSString stringWithFormat:@"http://%@:%i/", _dnsAddress, (int)_dnsPort]];
     } else {
@@ -897,17 +1033,20 @@ static inline NSString* _EncodeBase64(NSString* string) {
 
 - (void)addHandlerForMethod:(NSString*)method path:(NSString*)path requestClass:(Class)aClass asyncProcessBlock:(GCDWebServerAsyncProcessBlock)block {
   if ([path hasPrefix:@"/"] && [aClass isSubclassOfClass:[GCDWebServerRequest class]]) {
-    [self
-        addHandlerWithMatchBlock:^GCDWebServerRequest*(NSString* requestMethod, NSURL* requestURL, NSDictionary<NSString*, NSString*>* requestHeaders, NSString* urlPath, NSDictionary<NSString*, NSString*>* urlQuery) {
-          if (![requestMethod isEqualToString:method]) {
-            return nil;
-          }
-          if ([urlPath caseInsensitiveCompare:path] != NSOrderedSame) {
-            return nil;
-          }
-          return [(GCDWebServerRequest*)[aClass alloc] initWithMethod:requestMethod url:requestURL headers:requestHeaders path:urlPath query:urlQuery];
-        }
-               asyncProcessBlock:block];
+    GCDWebServerMatchBlock matchBlock = ^GCDWebServerRequest*(NSString* requestMethod, NSURL* requestURL, NSDictionary<NSString*, NSString*>* requestHeaders, NSString* urlPath, NSDictionary<NSString*, NSString*>* urlQuery) {
+      if (![requestMethod isEqualToString:method]) {
+        return nil;
+      }
+      if ([urlPath caseInsensitiveCompare:path] != NSOrderedSame) {
+        return nil;
+      }
+      return [(GCDWebServerRequest*)[aClass alloc] initWithMethod:requestMethod url:requestURL headers:requestHeaders path:urlPath query:urlQuery];
+    };
+    if (_IsExactHandlerPath(path)) {
+      [self _addExactHandlerForMethod:method path:path matchBlock:matchBlock asyncProcessBlock:block];
+    } else {
+      [self addHandlerWithMatchBlock:matchBlock asyncProcessBlock:block];
+    }
   } else {
     GWS_DNOT_REACHED();
   }
@@ -31,11 +31,13 @@
 
 #import <TargetConditionals.h>
 #import <netdb.h>
+#import <stdatomic.h>
 #ifdef __GCDWEBSERVER_ENABLE_TESTING__
 #import <libkern/OSAtomic.h>
 #endif
 
 #import "GCDWebServerPrivate.h"
+#import "GCDWebServerHTTPScanner.h"
 
 #define kHeadersReadCapacity (1 * 1024)
 #define kBodyReadCapacity (256 * 1024)
@@ -49,7 +51,6 @@ typedef void (^WriteHeadersCompletionBlock)(BOOL success);
 typedef void (^WriteBodyCompletionBlock)(BOOL success);
 
 static NSData* _CRLFData = nil;
-static NSData* _CRLFCRLFData = nil;
 static NSData* _continueData = nil;
 static NSData* _lastChunkData = nil;
 static NSString* _digestAuthenticationNonce = nil;
@@ -68,10 +69,17 @@ NS_ASSUME_NONNULL_BEGIN
 
 @interface GCDWebServerConnection (Write)
 - (void)writeData:(NSData*)data withCompletionBlock:(WriteDataCompletionBlock)block;
+- (void)writeDataSegments:(NSArray<NSData*>*)segments withCompletionBlock:(WriteDataCompletionBlock)block;
 - (void)writeHeadersWithCompletionBlock:(WriteHeadersCompletionBlock)block;
+- (void)writeHeadersWithBodyData:(nullable NSData*)bodyData completionBlock:(WriteHeadersCompletionBlock)block;
 - (void)writeBodyWithCompletionBlock:(WriteBodyCompletionBlock)block;
 @end
 
+@interface GCDWebServerConnection ()
+- (void)_stopIdleTimer;
+- (void)_logRequest;
+@end
+
 NS_ASSUME_NONNULL_END
 
 @implementation GCDWebServerConnection {
@@ -86,6 +94,15 @@ NS_ASSUME_NONNULL_END
   NSInteger _statusCode;
 
   BOOL _opened;
+
+  NSData* _pendingData;  // Read past the end of the current request i.e. pipelined requests
+  NSMutableData* _headersData;  // Reused by every request on this connection
+  GCDWebServerHTTPScanner _scanner;  // Request headers or current chunk of the request body
+  NSUInteger _requestCount;  // Requests already answered on this connection
+  BOOL _keepAlive;
+  BOOL _idle;  // Waiting for the first byte of the next request
+  dispatch_source_t _idleTimer;
+  atomic_bool _idleTimerArmed;  // Claimed by whichever of the idle timer and the next read comes first
 #ifdef __GCDWEBSERVER_ENABLE_TESTING__
   NSUInteger _connectionIndex;
   NSString* _requestPath;
@@ -100,10 +117,6 @@ NS_ASSUME_NONNULL_END
     _CRLFData = [[NSData alloc] initWithBytes:"\r\n" length:2];
     GWS_DCHECK(_CRLFData);
   }
-  if (_CRLFCRLFData == nil) {
-    _CRLFCRLFData = [[NSData alloc] initWithBytes:"\r\n\r\n" length:4];
-    GWS_DCHECK(_CRLFCRLFData);
-  }
   if (_continueData == nil) {
     CFHTTPMessageRef message = CFHTTPMessageCreateResponse(kCFAllocatorDefault, 100, NULL, kCFHTTPVersion1_1);
     _continueData = CFBridgingRelease(CFHTTPMessageCopySerializedMessage(message));
@@ -128,7 +141,12 @@ NS_ASSUME_NONNULL_END
 - (void)_initializeResponseHeadersWithStatusCode:(NSInteger)statusCode {
   _statusCode = statusCode;
   _responseMessage = CFHTTPMessageCreateResponse(kCFAllocatorDefault, statusCode, NULL, kCFHTTPVersion1_1);
-  CFHTTPMessageSetHeaderFieldValue(_responseMessage, CFSTR("Connection"), CFSTR("Close"));
+  if (_keepAlive) {
+    CFHTTPMessageSetHeaderFieldValue(_responseMessage, CFSTR("Connection"), CFSTR("keep-alive"));
+    CFHTTPMessageSetHeaderFieldValue(_responseMessage, CFSTR("Keep-Alive"), (__bridge CFStringRef)[NSString stringWithFormat:@"timeout=%i, max=%lu", (int)ceil(_server.connectionIdleTimeout), (unsigned long)(_server.maxRequestsPerConnection - _requestCount - 1)]);
+  } else {
+    CFHTTPMessageSetHeaderFieldValue(_responseMessage, CFSTR("Connection"), CFSTR("Close"));
+  }
   CFHTTPMessageSetHeaderFieldValue(_responseMessage, CFSTR("Server"), (__bridge CFStringRef)_server.serverName);
   CFHTTPMessageSetHeaderFieldValue(_responseMessage, CFSTR("Date"), (__bridge CFStringRef)GCDWebServerFormatRFC822([NSDate date]));
 }
@@ -147,6 +165,87 @@ NS_ASSUME_NONNULL_END
   }
 }
 
+static inline BOOL _HeaderHasToken(NSString* value, NSString* token) {
+  for (NSString* item in [value componentsSeparatedByString:@","]) {
+    if ([[item stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] caseInsensitiveCompare:token] == NSOrderedSame) {
+      return YES;
+    }
+  }
+  return NO;
+}
+
+// https://tools.ietf.org/html/rfc7230#section-6.3
+- (BOOL)_shouldKeepAliveWithBody:(BOOL)hasBody {
+  if ((_server.connectionIdleTimeout <= 0.0) || (_requestCount + 1 >= _server.maxRequestsPerConnection)) {
+    return NO;
+  }
+  if (hasBody && (_response.contentLength == NSUIntegerMax) && !_response.usesChunkedTransferEncoding) {
+    return NO;  // The end of the connection is the end of the body
+  }
+  NSString* connectionHeader = [_request.headers objectForKey:@"Connection"];
+  NSString* version = CFBridgingRelease(CFHTTPMessageCopyVersion(_requestMessage));
+  if ([version isEqualToString:(__bridge NSString*)kCFHTTPVersion1_0]) {
+    return _HeaderHasToken(connectionHeader, @"keep-alive");
+  }
+  return !_HeaderHasToken(connectionHeader, @"close");
+}
+
+- (void)_logRequest {
+  if (_request) {
+    GWS_LOG_VERBOSE(@"[%@] %@ %i \"%@ %@\" (%lu | %lu)", self.localAddressString, self.remoteAddressString, (int)_statusCode, _virtualHEAD ? @"HEAD" : _request.method, _request.path, (unsigned long)_totalBytesRead, (unsigned long)_totalBytesWritten);
+  } else {
+    GWS_LOG_VERBOSE(@"[%@] %@ %i \"(invalid request)\" (%lu | %lu)", self.localAddressString, self.remoteAddressString, (int)_statusCode, (unsigned long)_totalBytesRead, (unsigned long)_totalBytesWritten);
+  }
+}
+
+// Reads the next request from the same socket if the connection persists.
+// Otherwise nothing retains the connection anymore and it closes.
+- (void)_didFinishResponse:(BOOL)success {
+  if (!success || !_keepAlive) {
+    return;
+  }
+  [self _logRequest];
+  _requestCount += 1;
+  CFRelease(_requestMessage);
+  _requestMessage = NULL;
+  CFRelease(_responseMessage);
+  _responseMessage = NULL;
+  _request = nil;
+  _handler = nil;
+  _response = nil;
+  _statusCode = 0;
+  _virtualHEAD = NO;
+  _keepAlive = NO;
+  [self _readRequestHeaders];
+}
+
+- (void)_startIdleTimer {
+  GWS_DCHECK(_idleTimer == NULL);
+  _idle = YES;
+  atomic_store(&_idleTimerArmed, true);
+  _idleTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_global_queue(_server.dispatchQueuePriority, 0));
+  dispatch_source_set_timer(_idleTimer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(_server.connectionIdleTimeout * NSEC_PER_SEC)), DISPATCH_TIME_FOREVER, NSEC_PER_SEC / 10);
+  __weak GCDWebServerConnection* weakSelf = self;
+  dispatch_source_set_event_handler(_idleTimer, ^{
+    GCDWebServerConnection* strongSelf = weakSelf;
+    if (strongSelf && atomic_exchange(&strongSelf->_idleTimerArmed, false)) {  // Otherwise a request started arriving
+      GWS_LOG_DEBUG(@"Closing idle connection on socket %i", strongSelf->_socket);
+      shutdown(strongSelf->_socket, SHUT_RDWR);  // Ends the pending read
+    }
+  });
+  dispatch_resume(_idleTimer);
+}
+
+- (void)_stopIdleTimer {
+  if (_idleTimer) {
+    dispatch_source_cancel(_idleTimer);
+#if !OS_OBJECT_USE_OBJC_RETAIN_RELEASE
+    dispatch_release(_idleTimer);
+#endif
+    _idleTimer = NULL;
+  }
+}
+
 // http://www.w3.org/Protocols/rfc2616/rfc2616-sec10.html
 - (void)_finishProcessingRequest:(GCDWebServerResponse*)response {
   GWS_DCHECK(_responseMessage == NULL);
@@ -169,6 +268,7 @@ NS_ASSUME_NONNULL_END
   }
 
   if (_response) {
+    _keepAlive = [self _shouldKeepAliveWithBody:hasBody];
     [self _initializeResponseHeadersWithStatusCode:_response.statusCode];
     if (_response.lastModifiedDate) {
       CFHTTPMessageSetHeaderFieldValue(_responseMessage, CFSTR("Last-Modified"), (__bridge CFStringRef)GCDWebServerFormatRFC822((NSDate*)_response.lastModifiedDate));
@@ -195,12 +295,37 @@ NS_ASSUME_NONNULL_END
     [_response.additionalHeaders enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL* stop) {
       CFHTTPMessageSetHeaderFieldValue(self->_responseMessage, (__bridge CFStringRef)key, (__bridge CFStringRef)obj);
     }];
+    if (hasBody && !_response.usesChunkedTransferEncoding) {  // Sends the headers with the start of the body, i.e. the whole body of a data response, in a single write
+      [_response performReadDataWithCompletion:^(NSData* data, NSError* error) {
+        if (data == nil) {
+          GWS_LOG_ERROR(@"Failed reading response body for socket %i: %@", self->_socket, error);
+          [self->_response performClose];
+          return;
+        }
+        [self writeHeadersWithBodyData:data
+                       completionBlock:^(BOOL success) {
+                         if (success && data.length) {
+                           [self writeBodyWithCompletionBlock:^(BOOL successInner) {
+                             [self->_response performClose];
+                             [self _didFinishResponse:successInner];  // Closes the connection on failure, the only way left to tell the client once headers are sent
+                           }];
+                         } else {
+                           [self->_response performClose];
+                           [self _didFinishResponse:success];
+                         }
+                       }];
+      }];
+      return;
+    }
     [self writeHeadersWithCompletionBlock:^(BOOL success) {
       if (success) {
         if (hasBody) {
           [self writeBodyWithCompletionBlock:^(BOOL successInner) {
             [self->_response performClose];  // TODO: There's nothing we can do on failure as headers have already been sent
+            [self _didFinishResponse:successInner];
           }];
+        } else {
+          [self _didFinishResponse:YES];
         }
       } else if (hasBody) {
         [self->_response performClose];
@@ -211,6 +336,26 @@ NS_ASSUME_NONNULL_END
   }
 }
 
+// A body which could not be read entirely leaves the connection anywhere within
+// the request, so it is answered 400 and closed rather than processed and kept
+// alive, lest the rest of the body be read as the next request.
+- (void)_didReadBody:(BOOL)success {
+  NSError* error = nil;
+  if (![_request performClose:&error]) {
+    GWS_LOG_ERROR(@"Failed closing request body for socket %i: %@", _socket, error);
+    if (success) {
+      [self abortRequest:_request withStatusCode:kGCDWebServerHTTPStatusCode_InternalServerError];
+      return;
+    }
+  }
+  if (success) {
+    [self _startProcessingRequest];
+  } else {
+    _pendingData = nil;
+    [self abortRequest:_request withStatusCode:kGCDWebServerHTTPStatusCode_BadRequest];
+  }
+}
+
 - (void)_readBodyWithLength:(NSUInteger)length initialData:(NSData*)initialData {
   NSError* error = nil;
   if (![_request performOpen:&error]) {
@@ -234,13 +379,7 @@ NS_ASSUME_NONNULL_END
   if (length) {
     [self readBodyWithRemainingLength:length
                       completionBlock:^(BOOL success) {
-                        NSError* localError = nil;
-                        if ([self->_request performClose:&localError]) {
-                          [self _startProcessingRequest];
-                        } else {
-                          GWS_LOG_ERROR(@"Failed closing request body for socket %i: %@", self->_socket, error);
-                          [self abortRequest:self->_request withStatusCode:kGCDWebServerHTTPStatusCode_InternalServerError];
-                        }
+                        [self _didReadBody:success];
                       }];
   } else {
     if ([_request performClose:&error]) {
@@ -261,21 +400,27 @@ NS_ASSUME_NONNULL_END
   }
 
   NSMutableData* chunkData = [[NSMutableData alloc] initWithData:initialData];
+  GCDWebServerHTTPScannerInit(&_scanner, kGCDWebServerHTTPScannerMode_Chunk);
   [self readNextBodyChunk:chunkData
           completionBlock:^(BOOL success) {
-            NSError* localError = nil;
-            if ([self->_request performClose:&localError]) {
-              [self _startProcessingRequest];
-            } else {
-              GWS_LOG_ERROR(@"Failed closing request body for socket %i: %@", self->_socket, error);
-              [self abortRequest:self->_request withStatusCode:kGCDWebServerHTTPStatusCode_InternalServerError];
-            }
+            [self _didReadBody:success];
           }];
 }
 
 - (void)_readRequestHeaders {
   _requestMessage = CFHTTPMessageCreateEmpty(kCFAllocatorDefault, true);
-  NSMutableData* headersData = [[NSMutableData alloc] initWithCapacity:kHeadersReadCapacity];
+  if (_headersData == nil) {
+    _headersData = [[NSMutableData alloc] initWithCapacity:kHeadersReadCapacity];
+  }
+  NSMutableData* headersData = _headersData;
+  headersData.length = 0;
+  GCDWebServerHTTPScannerInit(&_scanner, kGCDWebServerHTTPScannerMode_Headers);
+  if (_pendingData) {
+    [headersData appendData:_pendingData];
+    _pendingData = nil;
+  } else if (_requestCount > 0) {
+    [self _startIdleTimer];
+  }
   [self readHeaders:headersData
       withCompletionBlock:^(NSData* extraData) {
         if (extraData) {
@@ -298,17 +443,31 @@ NS_ASSUME_NONNULL_END
           NSString* queryString = requestURL ? CFBridgingRelease(CFURLCopyQueryString((CFURLRef)requestURL, NULL)) : nil;  // Don't use -[NSURL query] to make sure query is not unescaped;
           NSDictionary* requestQuery = queryString ? GCDWebServerParseURLEncodedForm(queryString) : @{};
           if (requestMethod && requestURL && requestHeaders && requestPath && requestQuery) {
-            for (self->_handler in self->_server.handlers) {
-              self->_request = self->_handler.matchBlock(requestMethod, requestURL, requestHeaders, requestPath, requestQuery);
+            GCDWebServerHandler* exactHandler = [self->_server exactHandlerForMethod:requestMethod path:requestPath];
+            for (GCDWebServerHandler* handler in self->_server.handlers) {
+              if (exactHandler && (handler.order < exactHandler.order)) {  // Only handlers added after the exact one take precedence over it
+                break;
+              }
+              self->_request = handler.matchBlock(requestMethod, requestURL, requestHeaders, requestPath, requestQuery);
               if (self->_request) {
+                self->_handler = handler;
                 break;
               }
             }
+            if ((self->_request == nil) && exactHandler) {
+              self->_request = exactHandler.matchBlock(requestMethod, requestURL, requestHeaders, requestPath, requestQuery);
+              self->_handler = exactHandler;
+            }
             if (self->_request) {
               self->_request.localAddressData = self.localAddressData;
               self->_request.remoteAddressData = self.remoteAddressData;
               if ([self->_request hasBody]) {
                 [self->_request prepareForWriting];
+                if (!self->_request.usesChunkedTransferEncoding && (extraData.length > self->_request.contentLength)) {
+                  NSUInteger contentLength = self->_request.contentLength;
+                  self->_pendingData = [extraData subdataWithRange:NSMakeRange(contentLength, extraData.length - contentLength)];
+                  extraData = [extraData subdataWithRange:NSMakeRange(0, contentLength)];
+                }
                 if (self->_request.usesChunkedTransferEncoding || (extraData.length <= self->_request.contentLength)) {
                   NSString* expectHeader = [requestHeaders objectForKey:@"Expect"];
                   if (expectHeader) {
@@ -339,6 +498,7 @@ NS_ASSUME_NONNULL_END
                   [self abortRequest:self->_request withStatusCode:kGCDWebServerHTTPStatusCode_BadRequest];
                 }
               } else {
+                self->_pendingData = extraData.length ? extraData : nil;
                 [self _startProcessingRequest];
               }
             } else {
@@ -350,7 +510,7 @@ NS_ASSUME_NONNULL_END
             [self abortRequest:nil withStatusCode:kGCDWebServerHTTPStatusCode_InternalServerError];
             GWS_DNOT_REACHED();
           }
-        } else {
+        } else if (!self->_idle) {  // Closed between requests, either by the client or by the idle timer
           [self abortRequest:nil withStatusCode:kGCDWebServerHTTPStatusCode_InternalServerError];
         }
       }];
@@ -386,6 +546,8 @@ NS_ASSUME_NONNULL_END
 }
 
 - (void)dealloc {
+  [self _stopIdleTimer];
+
   int result = close(_socket);
   if (result != 0) {
     GWS_LOG_ERROR(@"Failed closing socket %i for connection: %s (%i)", _socket, strerror(errno), errno);
@@ -415,9 +577,18 @@ NS_ASSUME_NONNULL_END
 - (void)readData:(NSMutableData*)data withLength:(NSUInteger)length completionBlock:(ReadDataCompletionBlock)block {
   dispatch_read(_socket, length, dispatch_get_global_queue(_server.dispatchQueuePriority, 0), ^(dispatch_data_t buffer, int error) {
     @autoreleasepool {
+      if (self->_idle) {
+        [self _stopIdleTimer];
+        if (!atomic_exchange(&self->_idleTimerArmed, false)) {  // The idle timer fired first and shuts the socket down
+          GWS_LOG_DEBUG(@"Persistent connection timed out on socket %i", self->_socket);
+          block(NO);
+          return;
+        }
+      }
       if (error == 0) {
         size_t size = dispatch_data_get_size(buffer);
         if (size > 0) {
+          self->_idle = NO;
           NSUInteger originalLength = data.length;
           dispatch_data_apply(buffer, ^bool(dispatch_data_t region, size_t chunkOffset, const void* chunkBytes, size_t chunkSize) {
             [data appendBytes:chunkBytes length:chunkSize];
@@ -426,7 +597,9 @@ NS_ASSUME_NONNULL_END
           [self didReadBytes:((char*)data.bytes + originalLength) length:(data.length - originalLength)];
           block(YES);
         } else {
-          if (self->_totalBytesRead > 0) {
+          if (self->_idle) {
+            GWS_LOG_DEBUG(@"Persistent connection ended on socket %i", self->_socket);
+          } else if (self->_totalBytesRead > 0) {
             GWS_LOG_ERROR(@"No more data available on socket %i", self->_socket);
           } else {
             GWS_LOG_WARNING(@"No data received from socket %i", self->_socket);
@@ -443,31 +616,30 @@ NS_ASSUME_NONNULL_END
 
 - (void)readHeaders:(NSMutableData*)headersData withCompletionBlock:(ReadHeadersCompletionBlock)block {
   GWS_DCHECK(_requestMessage);
-  [self readData:headersData
-           withLength:NSUIntegerMax
-      completionBlock:^(BOOL success) {
-        if (success) {
-          NSRange range = [headersData rangeOfData:_CRLFCRLFData options:0 range:NSMakeRange(0, headersData.length)];
-          if (range.location == NSNotFound) {
+  if (GCDWebServerHTTPScan(&_scanner, headersData.bytes, headersData.length) == kGCDWebServerHTTPScanResult_NeedMoreData) {  // Pipelined requests may already be complete
+    [self readData:headersData
+             withLength:NSUIntegerMax
+        completionBlock:^(BOOL success) {
+          if (success) {
             [self readHeaders:headersData withCompletionBlock:block];
           } else {
-            NSUInteger length = range.location + range.length;
-            if (CFHTTPMessageAppendBytes(self->_requestMessage, headersData.bytes, length)) {
-              if (CFHTTPMessageIsHeaderComplete(self->_requestMessage)) {
-                block([headersData subdataWithRange:NSMakeRange(length, headersData.length - length)]);
-              } else {
-                GWS_LOG_ERROR(@"Failed parsing request headers from socket %i", self->_socket);
-                block(nil);
-              }
-            } else {
-              GWS_LOG_ERROR(@"Failed appending request headers data from socket %i", self->_socket);
-              block(nil);
-            }
+            block(nil);
           }
-        } else {
-          block(nil);
-        }
-      }];
+        }];
+  } else {
+    NSUInteger length = _scanner.offset;
+    if (CFHTTPMessageAppendBytes(_requestMessage, headersData.bytes, length)) {
+      if (CFHTTPMessageIsHeaderComplete(_requestMessage)) {
+        block([headersData subdataWithRange:NSMakeRange(length, headersData.length - length)]);
+      } else {
+        GWS_LOG_ERROR(@"Failed parsing request headers from socket %i", _socket);
+        block(nil);
+      }
+    } else {
+      GWS_LOG_ERROR(@"Failed appending request headers data from socket %i", _socket);
+      block(nil);
+    }
+  }
 }
 
 - (void)readBodyWithRemainingLength:(NSUInteger)length completionBlock:(ReadBodyCompletionBlock)block {
@@ -501,58 +673,55 @@ NS_ASSUME_NONNULL_END
       }];
 }
 
-static inline NSUInteger _ScanHexNumber(const void* bytes, NSUInteger size) {
-  char buffer[size + 1];
-  bcopy(bytes, buffer, size);
-  buffer[size] = 0;
-  char* end = NULL;
-  long result = strtol(buffer, &end, 16);
-  return ((end != NULL) && (*end == 0) && (result >= 0) ? result : NSNotFound);
-}
-
 - (void)readNextBodyChunk:(NSMutableData*)chunkData completionBlock:(ReadBodyCompletionBlock)block {
   GWS_DCHECK([_request hasBody] && [_request usesChunkedTransferEncoding]);
 
+  NSUInteger start = 0;  // Bytes of the chunks already written to the request
   while (1) {
-    NSRange range = [chunkData rangeOfData:_CRLFData options:0 range:NSMakeRange(0, chunkData.length)];
-    if (range.location == NSNotFound) {
+    const char* bytes = (const char*)chunkData.bytes + start;
+    NSUInteger length = chunkData.length - start;
+    GCDWebServerHTTPScanResult result = GCDWebServerHTTPScan(&_scanner, bytes, length);
+    if (result == kGCDWebServerHTTPScanResult_NeedMoreData) {
       break;
     }
-    NSRange extensionRange = [chunkData rangeOfData:[NSData dataWithBytes:";" length:1] options:0 range:NSMakeRange(0, range.location)];  // Ignore chunk extensions
-    NSUInteger length = _ScanHexNumber((char*)chunkData.bytes, extensionRange.location != NSNotFound ? extensionRange.location : range.location);
-    if (length != NSNotFound) {
-      if (length) {
-        if (chunkData.length < range.location + range.length + length + 2) {
-          break;
-        }
-        const char* ptr = (char*)chunkData.bytes + range.location + range.length + length;
-        if ((*ptr == '\r') && (*(ptr + 1) == '\n')) {
-          NSError* error = nil;
-          if ([_request performWriteData:[chunkData subdataWithRange:NSMakeRange(range.location + range.length, length)] error:&error]) {
-            [chunkData replaceBytesInRange:NSMakeRange(0, range.location + range.length + length + 2) withBytes:NULL length:0];
-          } else {
-            GWS_LOG_ERROR(@"Failed writing request body on socket %i: %@", _socket, error);
-            block(NO);
-            return;
-          }
-        } else {
-          GWS_LOG_ERROR(@"Missing terminating CRLF sequence for chunk reading request body on socket %i", _socket);
-          block(NO);
-          return;
-        }
+    if (result == kGCDWebServerHTTPScanResult_Invalid) {
+      GWS_LOG_ERROR(@"Invalid chunk length reading request body on socket %i", _socket);
+      block(NO);
+      return;
+    }
+    NSUInteger lineLength = _scanner.offset;
+    uint64_t size = _scanner.chunkSize;
+    if (size == 0) {  // Last chunk and trailers
+      NSUInteger end = start + lineLength;
+      if (end < chunkData.length) {
+        _pendingData = [chunkData subdataWithRange:NSMakeRange(end, chunkData.length - end)];
+      }
+      block(YES);
+      return;
+    }
+    if ((uint64_t)(length - lineLength) < size + 2) {  // The scanner stays complete until the chunk data is read
+      break;
+    }
+    const char* ptr = bytes + lineLength + size;
+    if ((*ptr == '\r') && (*(ptr + 1) == '\n')) {
+      NSError* error = nil;
+      if ([_request performWriteData:[NSData dataWithBytes:(bytes + lineLength) length:(NSUInteger)size] error:&error]) {
+        start += lineLength + (NSUInteger)size + 2;
+        GCDWebServerHTTPScannerInit(&_scanner, kGCDWebServerHTTPScannerMode_Chunk);
       } else {
-        NSRange trailerRange = [chunkData rangeOfData:_CRLFCRLFData options:0 range:NSMakeRange(range.location, chunkData.length - range.location)];  // Ignore trailers
-        if (trailerRange.location != NSNotFound) {
-          block(YES);
-          return;
-        }
+        GWS_LOG_ERROR(@"Failed writing request body on socket %i: %@", _socket, error);
+        block(NO);
+        return;
       }
     } else {
-      GWS_LOG_ERROR(@"Invalid chunk length reading request body on socket %i", _socket);
+      GWS_LOG_ERROR(@"Missing terminating CRLF sequence for chunk reading request body on socket %i", _socket);
       block(NO);
       return;
     }
   }
+  if (start) {  // Drops the written chunks at once, the scanner being relative to the next one
+    [chunkData replaceBytesInRange:NSMakeRange(0, start) withBytes:NULL length:0];
+  }
 
   [self readData:chunkData
            withLength:NSUIntegerMax
@@ -569,15 +738,39 @@ static inline NSUInteger _ScanHexNumber(const void* bytes, NSUInteger size) {
 
 @implementation GCDWebServerConnection (Write)
 
-- (void)writeData:(NSData*)data withCompletionBlock:(WriteDataCompletionBlock)block {
-  dispatch_data_t buffer = dispatch_data_create(data.bytes, data.length, dispatch_get_global_queue(_server.dispatchQueuePriority, 0), ^{
+// Wraps the bytes of data, which stays alive as long as the region, rather than copying them.
+static inline dispatch_data_t _DispatchDataWithData(NSData* data, dispatch_queue_t queue) {
+  return dispatch_data_create(data.bytes, data.length, queue, ^{
     [data self];  // Keeps ARC from releasing data too early
   });
-  dispatch_write(_socket, buffer, dispatch_get_global_queue(_server.dispatchQueuePriority, 0), ^(dispatch_data_t remainingData, int error) {
+}
+
+- (void)writeData:(NSData*)data withCompletionBlock:(WriteDataCompletionBlock)block {
+  [self writeDataSegments:@[ data ] withCompletionBlock:block];
+}
+
+- (void)writeDataSegments:(NSArray<NSData*>*)segments withCompletionBlock:(WriteDataCompletionBlock)block {
+  dispatch_queue_t queue = dispatch_get_global_queue(_server.dispatchQueuePriority, 0);
+  dispatch_data_t buffer = dispatch_data_empty;
+  for (NSData* segment in segments) {  // Concatenating regions shares them, so a response body goes from its NSData to the socket without a copy
+    if (segment.length == 0) {
+      continue;
+    }
+    dispatch_data_t region = _DispatchDataWithData(segment, queue);
+    dispatch_data_t concatenated = dispatch_data_create_concat(buffer, region);
+#if !OS_OBJECT_USE_OBJC_RETAIN_RELEASE
+    dispatch_release(region);
+    dispatch_release(buffer);
+#endif
+    buffer = concatenated;
+  }
+  dispatch_write(_socket, buffer, queue, ^(dispatch_data_t remainingData, int error) {
     @autoreleasepool {
       if (error == 0) {
         GWS_DCHECK(remainingData == NULL);
-        [self didWriteBytes:data.bytes length:data.length];
+        for (NSData* segment in segments) {
+          [self didWriteBytes:segment.bytes length:segment.length];
+        }
         block(YES);
       } else {
         GWS_LOG_ERROR(@"Error while writing to socket %i: %s (%i)", self->_socket, strerror(error), error);
@@ -591,9 +784,13 @@ static inline NSUInteger _ScanHexNumber(const void* bytes, NSUInteger size) {
 }
 
 - (void)writeHeadersWithCompletionBlock:(WriteHeadersCompletionBlock)block {
+  [self writeHeadersWithBodyData:nil completionBlock:block];
+}
+
+- (void)writeHeadersWithBodyData:(NSData*)bodyData completionBlock:(WriteHeadersCompletionBlock)block {
   GWS_DCHECK(_responseMessage);
   CFDataRef data = CFHTTPMessageCopySerializedMessage(_responseMessage);
-  [self writeData:(__bridge NSData*)data withCompletionBlock:block];
+  [self writeDataSegments:(bodyData.length ? @[ (__bridge NSData*)data, (NSData*)bodyData ] : @[ (__bridge NSData*)data ]) withCompletionBlock:block];
   CFRelease(data);
 }
 
@@ -602,27 +799,15 @@ static inline NSUInteger _ScanHexNumber(const void* bytes, NSUInteger size) {
   [_response performReadDataWithCompletion:^(NSData* data, NSError* error) {
     if (data) {
       if (data.length) {
-        if (self->_response.usesChunkedTransferEncoding) {
-          const char* hexString = [[NSString stringWithFormat:@"%lx", (unsigned long)data.length] UTF8String];
-          size_t hexLength = strlen(hexString);
-          NSData* chunk = [NSMutableData dataWithLength:(hexLength + 2 + data.length + 2)];
-          if (chunk == nil) {
-            GWS_LOG_ERROR(@"Failed allocating memory for response body chunk for socket %i: %@", self->_socket, error);
-            block(NO);
-            return;
-          }
-          char* ptr = (char*)[(NSMutableData*)chunk mutableBytes];
-          bcopy(hexString, ptr, hexLength);
-          ptr += hexLength;
-          *ptr++ = '\r';
-          *ptr++ = '\n';
-          bcopy(data.bytes, ptr, data.length);
-          ptr += data.length;
-          *ptr++ = '\r';
-          *ptr = '\n';
-          data = chunk;
+        NSArray<NSData*>* segments;
+        if (self->_response.usesChunkedTransferEncoding) {  // The chunk framing goes around the data instead of the data being copied into a chunk
+          char header[2 * sizeof(unsigned long) + 3];
+          int headerLength = snprintf(header, sizeof(header), "%lx\r\n", (unsigned long)data.length);
+          segments = @[ [NSData dataWithBytes:header length:headerLength], data, _CRLFData ];
+        } else {
+          segments = @[ data ];
         }
-        [self writeData:data
+        [self writeDataSegments:segments
             withCompletionBlock:^(BOOL success) {
               if (success) {
                 [self writeBodyWithCompletionBlock:block];
@@ -793,6 +978,7 @@ static inline BOOL _CompareResources(NSString* responseETag, NSString* requestET
 - (void)abortRequest:(GCDWebServerRequest*)request withStatusCode:(NSInteger)statusCode {
   GWS_DCHECK(_responseMessage == NULL);
   GWS_DCHECK((statusCode >= 400) && (statusCode < 600));
+  _keepAlive = NO;  // The request may not have been read to its end
   [self _initializeResponseHeadersWithStatusCode:statusCode];
   [self writeHeadersWithCompletionBlock:^(BOOL success){
       // Nothing more to do
@@ -833,10 +1019,8 @@ static inline BOOL _CompareResources(NSString* responseETag, NSString* requestET
   }
 #endif
 
-  if (_request) {
-    GWS_LOG_VERBOSE(@"[%@] %@ %i \"%@ %@\" (%lu | %lu)", self.localAddressString, self.remoteAddressString, (int)_statusCode, _virtualHEAD ? @"HEAD" : _request.method, _request.path, (unsigned long)_totalBytesRead, (unsigned long)_totalBytesWritten);
-  } else {
-    GWS_LOG_VERBOSE(@"[%@] %@ %i \"(invalid request)\" (%lu | %lu)", self.localAddressString, self.remoteAddressString, (int)_statusCode, (unsigned long)_totalBytesRead, (unsigned long)_totalBytesWritten);
+  if (_request || (_requestCount == 0) || _statusCode) {  // Not idle after a previous request
+    [self _logRequest];
   }
 }
 
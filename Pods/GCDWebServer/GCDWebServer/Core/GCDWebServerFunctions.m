@@ -40,12 +40,28 @@
 #import <ifaddrs.h>
 #import <net/if.h>
 #import <netdb.h>
+#import <time.h>
 
 #import "GCDWebServerPrivate.h"
 
 static NSDateFormatter* _dateFormatterRFC822 = nil;
 static NSDateFormatter* _dateFormatterISO8601 = nil;
-static dispatch_queue_t _dateFormatterQueue = NULL;
+static dispatch_queue_t _dateFormatterQueue = NULL;  // Only for dates the fixed-format code below does not parse
+static NSCache<NSString*, id>* _mimeTypeCache = nil;  // NSNull for extensions without a MIME type
+
+static const char* const _weekdayNames[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+static const char* const _monthNames[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+// The last second formatted on the current thread, so responses only format
+// the Date header once per second without sharing anything between threads.
+typedef struct {
+  time_t second;
+  int length;
+  char text[40];
+} GCDWebServerFormattedDate;
+
+static __thread GCDWebServerFormattedDate _lastRFC822 = {.second = -1};
+static __thread GCDWebServerFormattedDate _lastISO8601 = {.second = -1};
 
 // TODO: Handle RFC 850 and ANSI C's asctime() format
 void GCDWebServerInitializeFunctions() {
@@ -68,10 +84,26 @@ void GCDWebServerInitializeFunctions() {
     _dateFormatterQueue = dispatch_queue_create(NULL, DISPATCH_QUEUE_SERIAL);
     GWS_DCHECK(_dateFormatterQueue);
   }
+  if (_mimeTypeCache == nil) {
+    _mimeTypeCache = [[NSCache alloc] init];
+  }
 }
 
 NSString* GCDWebServerNormalizeHeaderValue(NSString* value) {
   if (value) {
+    CFStringInlineBuffer buffer;
+    CFIndex length = CFStringGetLength((CFStringRef)value);
+    CFStringInitInlineBuffer((CFStringRef)value, &buffer, CFRangeMake(0, length));
+    CFIndex index = 0;
+    for (; index < length; ++index) {  // Most values are already lowercase ASCII and are returned as is
+      UniChar c = CFStringGetCharacterFromInlineBuffer(&buffer, index);
+      if ((c == ';') || (c >= 0x80) || ((c >= 'A') && (c <= 'Z'))) {
+        break;
+      }
+    }
+    if ((index == length) || (CFStringGetCharacterFromInlineBuffer(&buffer, index) == ';')) {
+      return value;
+    }
     NSRange range = [value rangeOfString:@";"];  // Assume part before ";" separator is case-insensitive
     if (range.location != NSNotFound) {
       value = [[[value substringToIndex:range.location] lowercaseString] stringByAppendingString:[value substringFromIndex:range.location]];
@@ -119,35 +151,135 @@ NSStringEncoding GCDWebServerStringEncodingFromCharset(NSString* charset) {
   return (encoding != kCFStringEncodingInvalidId ? encoding : NSUTF8StringEncoding);
 }
 
+static inline time_t _SecondsFromDate(NSDate* date) {
+  return (time_t)floor(date.timeIntervalSince1970);  // Like NSDateFormatter, drops fractions of a second
+}
+
+static NSString* _FormatDate(NSDate* date, GCDWebServerFormattedDate* last, BOOL iso8601) {
+  time_t second = _SecondsFromDate(date);
+  if (second != last->second) {
+    struct tm tm;
+    if (gmtime_r(&second, &tm) == NULL) {
+      return nil;
+    }
+    if (iso8601) {
+      last->length = snprintf(last->text, sizeof(last->text), "%04d-%02d-%02dT%02d:%02d:%02d+00:00", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+    } else {
+      last->length = snprintf(last->text, sizeof(last->text), "%s, %02d %s %04d %02d:%02d:%02d GMT", _weekdayNames[tm.tm_wday], tm.tm_mday, _monthNames[tm.tm_mon], tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
+    }
+    last->second = second;
+  }
+  return [[NSString alloc] initWithBytes:last->text length:last->length encoding:NSASCIIStringEncoding];
+}
+
+static inline BOOL _ScanDigits(const char** ptr, int count, int* value) {
+  int result = 0;
+  for (int i = 0; i < count; ++i) {
+    char c = (*ptr)[i];
+    if ((c < '0') || (c > '9')) {
+      return NO;
+    }
+    result = result * 10 + (c - '0');
+  }
+  *ptr += count;
+  *value = result;
+  return YES;
+}
+
+static inline BOOL _ScanLiteral(const char** ptr, const char* literal) {
+  size_t length = strlen(literal);
+  if (strncmp(*ptr, literal, length)) {
+    return NO;
+  }
+  *ptr += length;
+  return YES;
+}
+
+// Parses exactly the format GCDWebServer writes, e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+// or "1994-11-06T08:49:37+00:00", and returns nil for anything else.
+static NSDate* _ParseDate(NSString* string, BOOL iso8601) {
+  char buffer[40];
+  if (!CFStringGetCString((CFStringRef)string, buffer, sizeof(buffer), kCFStringEncodingASCII)) {
+    return nil;
+  }
+  const char* ptr = buffer;
+  struct tm tm = {0};
+  int year, month = -1;
+  if (iso8601) {
+    if (!_ScanDigits(&ptr, 4, &year) || !_ScanLiteral(&ptr, "-") || !_ScanDigits(&ptr, 2, &month) || !_ScanLiteral(&ptr, "-") || !_ScanDigits(&ptr, 2, &tm.tm_mday) || !_ScanLiteral(&ptr, "T")) {
+      return nil;
+    }
+    month -= 1;
+  } else {
+    BOOL weekday = NO;
+    for (int i = 0; i < 7; ++i) {
+      weekday = weekday || _ScanLiteral(&ptr, _weekdayNames[i]);
+    }
+    if (!weekday || !_ScanLiteral(&ptr, ", ") || !_ScanDigits(&ptr, 2, &tm.tm_mday) || !_ScanLiteral(&ptr, " ")) {
+      return nil;
+    }
+    for (int i = 0; (i < 12) && (month < 0); ++i) {
+      if (_ScanLiteral(&ptr, _monthNames[i])) {
+        month = i;
+      }
+    }
+    if ((month < 0) || !_ScanLiteral(&ptr, " ") || !_ScanDigits(&ptr, 4, &year) || !_ScanLiteral(&ptr, " ")) {
+      return nil;
+    }
+  }
+  if (!_ScanDigits(&ptr, 2, &tm.tm_hour) || !_ScanLiteral(&ptr, ":") || !_ScanDigits(&ptr, 2, &tm.tm_min) || !_ScanLiteral(&ptr, ":") || !_ScanDigits(&ptr, 2, &tm.tm_sec) || !_ScanLiteral(&ptr, iso8601 ? "+00:00" : " GMT") || *ptr) {
+    return nil;
+  }
+  if ((month < 0) || (month > 11) || (tm.tm_hour > 23) || (tm.tm_min > 59) || (tm.tm_sec > 59)) {
+    return nil;
+  }
+  tm.tm_year = year - 1900;
+  tm.tm_mon = month;
+  int day = tm.tm_mday;
+  time_t seconds = timegm(&tm);
+  if ((seconds == -1) || (tm.tm_mday != day) || (tm.tm_mon != month)) {  // timegm() normalizes days such as Feb 30 instead of failing
+    return nil;
+  }
+  return [NSDate dateWithTimeIntervalSince1970:seconds];
+}
+
 NSString* GCDWebServerFormatRFC822(NSDate* date) {
-  __block NSString* string;
-  dispatch_sync(_dateFormatterQueue, ^{
-    string = [_dateFormatterRFC822 stringFromDate:date];
-  });
+  __block NSString* string = _FormatDate(date, &_lastRFC822, NO);
+  if (string == nil) {
+    dispatch_sync(_dateFormatterQueue, ^{
+      string = [_dateFormatterRFC822 stringFromDate:date];
+    });
+  }
   return string;
 }
 
 NSDate* GCDWebServerParseRFC822(NSString* string) {
-  __block NSDate* date;
-  dispatch_sync(_dateFormatterQueue, ^{
-    date = [_dateFormatterRFC822 dateFromString:string];
-  });
+  __block NSDate* date = _ParseDate(string, NO);
+  if (date == nil) {
+    dispatch_sync(_dateFormatterQueue, ^{
+      date = [_dateFormatterRFC822 dateFromString:string];
+    });
+  }
   return date;
 }
 
 NSString* GCDWebServerFormatISO8601(NSDate* date) {
-  __block NSString* string;
-  dispatch_sync(_dateFormatterQueue, ^{
-    string = [_dateFormatterISO8601 stringFromDate:date];
-  });
+  __block NSString* string = _FormatDate(date, &_lastISO8601, YES);
+  if (string == nil) {
+    dispatch_sync(_dateFormatterQueue, ^{
+      string = [_dateFormatterISO8601 stringFromDate:date];
+    });
+  }
   return string;
 }
 
 NSDate* GCDWebServerParseISO8601(NSString* string) {
-  __block NSDate* date;
-  dispatch_sync(_dateFormatterQueue, ^{
-    date = [_dateFormatterISO8601 dateFromString:string];
-  });
+  __block NSDate* date = _ParseDate(string, YES);
+  if (date == nil) {
+    dispatch_sync(_dateFormatterQueue, ^{
+      date = [_dateFormatterISO8601 dateFromString:string];
+    });
+  }
   return date;
 }
 
@@ -167,7 +299,11 @@ NSString* GCDWebServerDescribeData(NSData* data, NSString* type) {
 }
 
 NSString* GCDWebServerGetMimeTypeForExtension(NSString* extension, NSDictionary<NSString*, NSString*>* overrides) {
-  NSDictionary* builtInOverrides = @{@"css" : @"text/css"};
+  static NSDictionary* builtInOverrides = nil;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    builtInOverrides = @{@"css" : @"text/css", @"pac" : @"application/x-ns-proxy-autoconfig"};
+  });
   NSString* mimeType = nil;
   extension = [extension lowercaseString];
   if (extension.length) {
@@ -176,10 +312,16 @@ NSString* GCDWebServerGetMimeTypeForExtension(NSString* extension, NSDictionary<
       mimeType = [builtInOverrides objectForKey:extension];
     }
     if (mimeType == nil) {
-      CFStringRef uti = UTTypeCreatePreferredIdentifierForTag(kUTTagClassFilenameExtension, (__bridge CFStringRef)extension, NULL);
-      if (uti) {
-        mimeType = CFBridgingRelease(UTTypeCopyPreferredTagWithClass(uti, kUTTagClassMIMEType));
-        CFRelease(uti);
+      id cached = [_mimeTypeCache objectForKey:extension];  // Launch Services lookups are slow and the same few extensions keep coming
+      if (cached) {
+        mimeType = cached != [NSNull null] ? cached : nil;
+      } else {
+        CFStringRef uti = UTTypeCreatePreferredIdentifierForTag(kUTTagClassFilenameExtension, (__bridge CFStringRef)extension, NULL);
+        if (uti) {
+          mimeType = CFBridgingRelease(UTTypeCopyPreferredTagWithClass(uti, kUTTagClassMIMEType));
+          CFRelease(uti);
+        }
+        [_mimeTypeCache setObject:(mimeType ? mimeType : [NSNull null]) forKey:extension];
       }
     }
   }
@@ -0,0 +1,199 @@
+/*
+ Copyright (c) 2012-2019, Pierre-Olivier Latour
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * The name of Pierre-Olivier Latour may not be used to endorse
+ or promote products derived from this software without specific
+ prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL PIERRE-OLIVIER LATOUR BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ *  Incremental scanning of the framing of HTTP requests, in plain C so it
+ *  can be fuzzed and benchmarked outside of Foundation (see
+ *  tools/http-scanner-bench in ShadowsocksX-NG).
+ *
+ *  A scanner is fed the whole buffer received so far on every call and
+ *  resumes at the byte where the previous call stopped, so finding the end of
+ *  a token costs one pass over its bytes however they are split into reads,
+ *  and nothing is allocated.
+ */
+
+#ifndef GCDWebServerHTTPScanner_h
+#define GCDWebServerHTTPScanner_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ *  Longest chunk size line, extensions and CRLF included, before a chunked
+ *  body is rejected instead of buffered.
+ */
+#define kGCDWebServerHTTPScannerMaxChunkLineLength 1024
+
+typedef enum {
+  kGCDWebServerHTTPScannerMode_Headers = 0,  // Request line and header fields, up to and including the empty line
+  kGCDWebServerHTTPScannerMode_Chunk  // Chunk size line, or last chunk and trailer fields up to and including the empty line
+} GCDWebServerHTTPScannerMode;
+
+typedef enum {
+  kGCDWebServerHTTPScanResult_NeedMoreData = 0,
+  kGCDWebServerHTTPScanResult_Complete,
+  kGCDWebServerHTTPScanResult_Invalid
+} GCDWebServerHTTPScanResult;
+
+enum {
+  // Matching "\r\n\r\n", by the number of its bytes already matched
+  _kGCDWebServerHTTPScannerState_Line = 0,
+  _kGCDWebServerHTTPScannerState_LineCR,
+  _kGCDWebServerHTTPScannerState_LineCRLF,
+  _kGCDWebServerHTTPScannerState_LineCRLFCR,
+  // Chunk size line
+  _kGCDWebServerHTTPScannerState_ChunkSizeStart,
+  _kGCDWebServerHTTPScannerState_ChunkSize,
+  _kGCDWebServerHTTPScannerState_ChunkExtension,
+  _kGCDWebServerHTTPScannerState_ChunkLF,
+  _kGCDWebServerHTTPScannerState_Complete,
+  _kGCDWebServerHTTPScannerState_Invalid
+};
+
+typedef struct {
+  size_t offset;  // Bytes scanned so far, i.e. the length of the token once complete
+  int state;
+  uint64_t chunkSize;  // Valid once a chunk size line is complete, 0 for the last chunk
+} GCDWebServerHTTPScanner;
+
+static inline void GCDWebServerHTTPScannerInit(GCDWebServerHTTPScanner* scanner, GCDWebServerHTTPScannerMode mode) {
+  scanner->offset = 0;
+  scanner->state = mode == kGCDWebServerHTTPScannerMode_Chunk ? _kGCDWebServerHTTPScannerState_ChunkSizeStart : _kGCDWebServerHTTPScannerState_Line;
+  scanner->chunkSize = 0;
+}
+
+static inline int _GCDWebServerHTTPScannerHexValue(unsigned char c) {
+  if ((c >= '0') && (c <= '9')) {
+    return c - '0';
+  }
+  c |= 0x20;
+  if ((c >= 'a') && (c <= 'f')) {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+/**
+ *  Scans bytes, the buffer received so far of which the first scanner->offset
+ *  bytes were scanned by previous calls, and returns whether the token ends
+ *  within it. Once complete, scanner->offset is the length of the token and
+ *  the scanner keeps returning kGCDWebServerHTTPScanResult_Complete until it
+ *  is initialized again, and once invalid it keeps returning
+ *  kGCDWebServerHTTPScanResult_Invalid.
+ */
+static inline GCDWebServerHTTPScanResult GCDWebServerHTTPScan(GCDWebServerHTTPScanner* scanner, const void* bytes, size_t length) {
+  const unsigned char* ptr = (const unsigned char*)bytes;
+  size_t offset = scanner->offset;
+  int state = scanner->state;
+  while ((offset < length) && (state != _kGCDWebServerHTTPScannerState_Complete) && (state != _kGCDWebServerHTTPScannerState_Invalid)) {
+    if ((state >= _kGCDWebServerHTTPScannerState_ChunkSizeStart) && (offset >= kGCDWebServerHTTPScannerMaxChunkLineLength)) {
+      state = _kGCDWebServerHTTPScannerState_Invalid;
+      continue;
+    }
+    unsigned char c = ptr[offset];
+    switch (state) {
+      case _kGCDWebServerHTTPScannerState_Line: {
+        const void* cr = memchr(ptr + offset, '\r', length - offset);  // Skips the bytes of a line at once
+        if (cr == NULL) {
+          offset = length;
+          continue;
+        }
+        offset = (const unsigned char*)cr - ptr;
+        state = _kGCDWebServerHTTPScannerState_LineCR;
+        break;
+      }
+
+      case _kGCDWebServerHTTPScannerState_LineCR:
+        state = c == '\n' ? _kGCDWebServerHTTPScannerState_LineCRLF : (c == '\r' ? _kGCDWebServerHTTPScannerState_LineCR : _kGCDWebServerHTTPScannerState_Line);
+        break;
+
+      case _kGCDWebServerHTTPScannerState_LineCRLF:
+        state = c == '\r' ? _kGCDWebServerHTTPScannerState_LineCRLFCR : _kGCDWebServerHTTPScannerState_Line;
+        break;
+
+      case _kGCDWebServerHTTPScannerState_LineCRLFCR:
+        state = c == '\n' ? _kGCDWebServerHTTPScannerState_Complete : (c == '\r' ? _kGCDWebServerHTTPScannerState_LineCR : _kGCDWebServerHTTPScannerState_Line);
+        break;
+
+      case _kGCDWebServerHTTPScannerState_ChunkSizeStart:
+      case _kGCDWebServerHTTPScannerState_ChunkSize: {
+        int value = _GCDWebServerHTTPScannerHexValue(c);
+        if (value >= 0) {
+          if (scanner->chunkSize >> 60) {  // Larger than any body could be
+            state = _kGCDWebServerHTTPScannerState_Invalid;
+            continue;
+          }
+          scanner->chunkSize = (scanner->chunkSize << 4) | (uint64_t)value;
+          state = _kGCDWebServerHTTPScannerState_ChunkSize;
+        } else if (state == _kGCDWebServerHTTPScannerState_ChunkSizeStart) {
+          state = _kGCDWebServerHTTPScannerState_Invalid;
+          continue;
+        } else if (c == '\r') {
+          state = _kGCDWebServerHTTPScannerState_ChunkLF;
+        } else if ((c == ';') || (c == ' ') || (c == '\t')) {  // Chunk extensions are ignored
+          state = _kGCDWebServerHTTPScannerState_ChunkExtension;
+        } else {
+          state = _kGCDWebServerHTTPScannerState_Invalid;
+          continue;
+        }
+        break;
+      }
+
+      case _kGCDWebServerHTTPScannerState_ChunkExtension: {
+        const void* cr = memchr(ptr + offset, '\r', length - offset);
+        offset = cr ? (size_t)((const unsigned char*)cr - ptr) : length;
+        if (cr) {
+          state = _kGCDWebServerHTTPScannerState_ChunkLF;
+          break;
+        }
+        continue;
+      }
+
+      case _kGCDWebServerHTTPScannerState_ChunkLF:
+        if (c != '\n') {
+          state = _kGCDWebServerHTTPScannerState_Invalid;
+          continue;
+        }
+        // The last chunk goes on with the trailer fields, which are ignored, as if its size line were a header field
+        state = scanner->chunkSize ? _kGCDWebServerHTTPScannerState_Complete : _kGCDWebServerHTTPScannerState_LineCRLF;
+        break;
+    }
+    offset += 1;
+  }
+  if ((state >= _kGCDWebServerHTTPScannerState_ChunkSizeStart) && (state <= _kGCDWebServerHTTPScannerState_ChunkLF) && (offset >= kGCDWebServerHTTPScannerMaxChunkLineLength)) {
+    state = _kGCDWebServerHTTPScannerState_Invalid;  // Whatever the rest of the line
+  }
+  scanner->offset = offset;
+  scanner->state = state;
+  if (state == _kGCDWebServerHTTPScannerState_Complete) {
+    return kGCDWebServerHTTPScanResult_Complete;
+  }
+  return state == _kGCDWebServerHTTPScannerState_Invalid ? kGCDWebServerHTTPScanResult_Invalid : kGCDWebServerHTTPScanResult_NeedMoreData;
+}
+
+#endif
@@ -185,20 +185,24 @@ extern NSString* GCDWebServerStringFromSockAddr(const struct sockaddr* addr, BOO
 @end
 
 @interface GCDWebServer ()
-@property(nonatomic, readonly) NSMutableArray<GCDWebServerHandler*>* handlers;
+@property(nonatomic, readonly) NSMutableArray<GCDWebServerHandler*>* handlers;  // Handlers not added for an exact method and path, most recent first
 @property(nonatomic, readonly, nullable) NSString* serverName;
 @property(nonatomic, readonly, nullable) NSString* authenticationRealm;
 @property(nonatomic, readonly, nullable) NSMutableDictionary<NSString*, NSString*>* authenticationBasicAccounts;
 @property(nonatomic, readonly, nullable) NSMutableDictionary<NSString*, NSString*>* authenticationDigestAccounts;
 @property(nonatomic, readonly) BOOL shouldAutomaticallyMapHEADToGET;
 @property(nonatomic, readonly) dispatch_queue_priority_t dispatchQueuePriority;
+@property(nonatomic, readonly) NSTimeInterval connectionIdleTimeout;
+@property(nonatomic, readonly) NSUInteger maxRequestsPerConnection;
 - (void)willStartConnection:(GCDWebServerConnection*)connection;
 - (void)didEndConnection:(GCDWebServerConnection*)connection;
+- (nullable GCDWebServerHandler*)exactHandlerForMethod:(NSString*)method path:(NSString*)path;
 @end
 
 @interface GCDWebServerHandler : NSObject
 @property(nonatomic, readonly) GCDWebServerMatchBlock matchBlock;
 @property(nonatomic, readonly) GCDWebServerAsyncProcessBlock asyncProcessBlock;
+@property(nonatomic, readonly) NSUInteger order;  // Handlers added later have higher orders and take precedence
 @end
 
 @interface GCDWebServerRequest ()
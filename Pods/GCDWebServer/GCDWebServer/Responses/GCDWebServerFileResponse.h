@@ -42,6 +42,20 @@ NS_ASSUME_NONNULL_BEGIN
 @property(nonatomic) NSDate* lastModifiedDate;  // Redeclare as non-null
 @property(nonatomic, copy) NSString* eTag;  // Redeclare as non-null
 
+/**
+ *  Sets if large files are mapped into memory instead of read, so their bytes
+ *  go from the page cache to the socket without a copy.
+ *
+ *  The default value is NO.
+ *
+ *  @warning Only set this for files which cannot be truncated or rewritten in
+ *  place while the response is sent, e.g. files owned by the server. The mapped
+ *  pages are read later when writing to the socket, and reading a page past the
+ *  end of a file truncated after it was mapped crashes the process with SIGBUS,
+ *  where reading the file would only fail the response.
+ */
+@property(nonatomic) BOOL mapsFile;
+
 /**
  *  Creates a response with the contents of a file.
  */
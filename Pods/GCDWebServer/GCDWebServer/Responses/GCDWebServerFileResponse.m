@@ -29,11 +29,14 @@
 #error GCDWebServer requires ARC
 #endif
 
+#import <sys/mman.h>
 #import <sys/stat.h>
 
 #import "GCDWebServerPrivate.h"
 
 #define kFileReadBufferSize (32 * 1024)
+#define kFileMapMinimumSize (64 * 1024)  // Smaller reads are cheaper to copy than to map
+#define kFileMapWindowSize (8 * 1024 * 1024)
 
 @implementation GCDWebServerFileResponse {
   NSString* _path;
@@ -155,7 +158,43 @@ static inline NSDate* _NSDateFromTimeSpec(const struct timespec* t) {
   return YES;
 }
 
+// Maps the next bytes of the file instead of reading them into a buffer, so
+// they go from the page cache to the socket without a copy. Returns nil if
+// the file cannot be mapped or is already shorter than expected. Truncating
+// it later, while the pages are written, is not caught (see mapsFile).
+- (NSData*)_readMappedData {
+  struct stat info;
+  off_t position = lseek(_file, 0, SEEK_CUR);
+  size_t length = MIN((NSUInteger)kFileMapWindowSize, _size);
+  if ((position < 0) || fstat(_file, &info) || (info.st_size < position + (off_t)length)) {
+    return nil;
+  }
+  off_t pageOffset = position % getpagesize();
+  size_t mapLength = length + (size_t)pageOffset;
+  void* map = mmap(NULL, mapLength, PROT_READ, MAP_PRIVATE, _file, position - pageOffset);
+  if (map == MAP_FAILED) {
+    GWS_LOG_DEBUG(@"Failed mapping file \"%@\": %s (%i)", _path, strerror(errno), errno);
+    return nil;
+  }
+  if (lseek(_file, position + (off_t)length, SEEK_SET) < 0) {
+    munmap(map, mapLength);
+    return nil;
+  }
+  _size -= length;
+  return [[NSData alloc] initWithBytesNoCopy:((char*)map + pageOffset)
+                                      length:length
+                                 deallocator:^(void* bytes, NSUInteger bytesLength) {
+                                   munmap(map, mapLength);
+                                 }];
+}
+
 - (NSData*)readData:(NSError**)error {
+  if (_mapsFile && (_size >= kFileMapMinimumSize)) {
+    NSData* data = [self _readMappedData];
+    if (data) {
+      return data;
+    }
+  }
   size_t length = MIN((NSUInteger)kFileReadBufferSize, _size);
   NSMutableData* data = [[NSMutableData alloc] initWithLength:length];
   ssize_t result = read(_file, data.mutableBytes, length);
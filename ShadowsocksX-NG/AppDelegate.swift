@@ -97,10 +97,18 @@ class AppDelegate: NSObject, NSApplicationDelegate, NSUserNotificationCenterDele
             "LocalSocks5.ListenAddress": "127.0.0.1",
             "PacServer.BindToLocalhost": NSNumber(value: true as Bool),
             "PacServer.ListenPort":NSNumber(value: 1089 as UInt16),
+            "PacServer.MaxPendingConnections": NSNumber(value: 128 as UInt),
+            "PacServer.AcceptSources": NSNumber(value: 2 as UInt),
+            "PacServer.MaxConnectionsPerClient": NSNumber(value: 16 as UInt),
+            "PacServer.Metrics": false,
             "LocalSocks5.Timeout": NSNumber(value: 60 as UInt),
             "LocalSocks5.EnableUDPRelay": NSNumber(value: false as Bool),
             "LocalSocks5.EnableVerboseMode": NSNumber(value: false as Bool),
             "GFWListURL": "https://cdn.jsdelivr.net/gh/gfwlist/gfwlist/gfwlist.txt",
+            "PAC.PrecompileDomainTables": true,
+            "PAC.RuleSources": [String](),
+            "PAC.OptimizeRules": true,
+            "PAC.LowerSlowFilters": true,
             "AutoConfigureNetworkServices": NSNumber(value: true as Bool),
             "LocalHTTP.ListenAddress": "127.0.0.1",
             "LocalHTTP.ListenPort": NSNumber(value: 1087 as UInt16),
@@ -226,6 +234,9 @@ class AppDelegate: NSObject, NSApplicationDelegate, NSUserNotificationCenterDele
         StopSSLocal()
         StopPrivoxy()
         ProxyConfHelper.disableProxy()
+        // The agents would keep running after the app if their stop scripts
+        // were left running.
+        ServiceSupervisor.shared.waitUntilIdle(timeout: 10)
     }
 
     func applyConfig() {
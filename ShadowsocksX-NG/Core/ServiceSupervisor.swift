@@ -0,0 +1,200 @@
+//
+//  ServiceSupervisor.swift
+//  ShadowsocksX-NG
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import Foundation
+
+// Runs a program and calls completion with its exit status once it exits,
+// without waiting for it on the calling thread. Abstracted so that the
+// supervisor can run stub programs in tests.
+protocol ProcessLauncher {
+    func run(_ launchPath: String, arguments: [String], completion: @escaping (Int32) -> Void)
+}
+
+struct SystemProcessLauncher: ProcessLauncher {
+    func run(_ launchPath: String, arguments: [String], completion: @escaping (Int32) -> Void) {
+        // Process.launch() raises instead of failing for a path it cannot run.
+        guard FileManager.default.isExecutableFile(atPath: launchPath) else {
+            completion(127)
+            return
+        }
+        let task = Process()
+        task.launchPath = launchPath
+        task.arguments = arguments
+        task.terminationHandler = { task in
+            completion(task.terminationStatus)
+        }
+        task.launch()
+    }
+}
+
+// Starts and stops the launch agents of ss-local and privoxy through their
+// launchctl scripts, off the calling thread. Plugins are run by ss-local, so
+// they follow it.
+//
+// The scripts of a service run one at a time, those of different services at
+// once. A request made while a script of its service runs waits for it, and
+// of several waiting only the last counts, so switching servers quickly runs
+// launchctl once per service rather than once per switch. Each state change
+// is posted as notificationName on the main queue.
+//
+// Only needs Foundation, so that it is also built and tested on Linux, see
+// Package.swift. The app's instance is ServiceSupervisor.shared.
+final class ServiceSupervisor {
+    enum Service: String, CaseIterable {
+        case ssLocal = "ss-local"
+        case privoxy = "privoxy"
+
+        var startScript: String {
+            return self == .ssLocal ? "start_ss_local.sh" : "start_privoxy.sh"
+        }
+
+        var stopScript: String {
+            return self == .ssLocal ? "stop_ss_local.sh" : "stop_privoxy.sh"
+        }
+    }
+
+    enum State: String {
+        case stopped, starting, running, stopping, failed
+    }
+
+    enum Request {
+        case start, stop
+        // Stop, then start after restartDelay, for a changed configuration.
+        case restart
+    }
+
+    // Keys of the userInfo of the notifications.
+    static let serviceKey = "service"
+    static let stateKey = "state"
+    // The exit status of the script, for the states which end one.
+    static let statusKey = "status"
+
+    private struct Slot {
+        var state = State.stopped
+        var running = false
+        var next: Request? = nil
+    }
+
+    let launcher: ProcessLauncher
+    let scriptPath: (String) -> String?
+    let notificationCenter: NotificationCenter
+    let notificationName: Notification.Name
+    // launchd may still be tearing the agent down when its stop script ends.
+    let restartDelay: TimeInterval
+
+    private let queue = DispatchQueue(label: "ServiceSupervisor")
+    private let busy = DispatchGroup()
+    private var slots: [Service: Slot] = [:]  // Accessed on queue only
+
+    init(launcher: ProcessLauncher, notificationCenter: NotificationCenter = .default
+        , notificationName: Notification.Name, restartDelay: TimeInterval = 1
+        , scriptPath: @escaping (String) -> String?) {
+        self.launcher = launcher
+        self.scriptPath = scriptPath
+        self.notificationCenter = notificationCenter
+        self.notificationName = notificationName
+        self.restartDelay = restartDelay
+        for service in Service.allCases {
+            slots[service] = Slot()
+        }
+    }
+
+    func start(_ service: Service) {
+        submit(.start, for: service)
+    }
+
+    func stop(_ service: Service) {
+        submit(.stop, for: service)
+    }
+
+    func restart(_ service: Service) {
+        submit(.restart, for: service)
+    }
+
+    func state(of service: Service) -> State {
+        return queue.sync { slots[service]!.state }
+    }
+
+    // Waits until no script runs or waits to run, e.g. for the agents to be
+    // stopped before the app quits. Returns false on timeout.
+    @discardableResult
+    func waitUntilIdle(timeout: TimeInterval) -> Bool {
+        queue.sync {}  // Requests submitted before are taken into account
+        return busy.wait(timeout: .now() + timeout) == .success
+    }
+
+    private func submit(_ request: Request, for service: Service) {
+        queue.async {
+            // A restart waiting keeps stopping first even if a start follows.
+            if request == .start, self.slots[service]!.next == .restart {
+                return
+            }
+            self.slots[service]!.next = request
+            self.advance(service)
+        }
+    }
+
+    // On queue.
+    private func advance(_ service: Service) {
+        guard !slots[service]!.running, let request = slots[service]!.next else {
+            return
+        }
+        slots[service]!.next = nil
+        slots[service]!.running = true
+        busy.enter()
+        let done = {
+            self.slots[service]!.running = false
+            self.advance(service)
+            self.busy.leave()
+        }
+        switch request {
+        case .start:
+            run(service, start: true, then: done)
+        case .stop:
+            run(service, start: false, then: done)
+        case .restart:
+            run(service, start: false) {
+                self.queue.asyncAfter(deadline: .now() + self.restartDelay) {
+                    self.run(service, start: true, then: done)
+                }
+            }
+        }
+    }
+
+    // On queue, and calls completion on queue.
+    private func run(_ service: Service, start: Bool, then completion: @escaping () -> Void) {
+        setState(start ? .starting : .stopping, of: service, status: nil)
+        let script = start ? service.startScript : service.stopScript
+        guard let path = scriptPath(script) else {
+            NSLog("\(start ? "Start" : "Stop") \(service.rawValue) failed: \(script) not found.")
+            setState(.failed, of: service, status: nil)
+            completion()
+            return
+        }
+        launcher.run(path, arguments: [""]) { status in
+            self.queue.async {
+                NSLog("\(start ? "Start" : "Stop") \(service.rawValue) \(status == 0 ? "succeeded" : "failed").")
+                self.setState(status != 0 ? .failed : (start ? .running : .stopped), of: service, status: status)
+                completion()
+            }
+        }
+    }
+
+    // On queue.
+    private func setState(_ state: State, of service: Service, status: Int32?) {
+        slots[service]!.state = state
+        var userInfo: [String: Any] = [ServiceSupervisor.serviceKey: service.rawValue
+            , ServiceSupervisor.stateKey: state.rawValue]
+        userInfo[ServiceSupervisor.statusKey] = status
+        let notificationCenter = self.notificationCenter
+        let notificationName = self.notificationName
+        DispatchQueue.main.async {
+            notificationCenter.post(name: notificationName, object: nil, userInfo: userInfo)
+        }
+    }
+}
@@ -43,10 +43,15 @@ func diagnose() -> String {
         "LocalSocks5.ListenAddress",
         "PacServer.BindToLocalhost",
         "PacServer.ListenPort",
+        "PacServer.MaxPendingConnections",
+        "PacServer.AcceptSources",
+        "PacServer.MaxConnectionsPerClient",
+        "PacServer.Metrics",
         "LocalSocks5.Timeout",
         "LocalSocks5.EnableUDPRelay",
         "LocalSocks5.EnableVerboseMode",
         "GFWListURL",
+        "PAC.RuleSources",
         "LocalHTTP.ListenAddress",
         "LocalHTTP.ListenPort",
         "LocalHTTPOn",
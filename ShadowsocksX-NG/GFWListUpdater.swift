@@ -0,0 +1,136 @@
+//
+//  GFWListUpdater.swift
+//  ShadowsocksX-NG
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import Foundation
+import Alamofire
+
+// Downloads the gfwlist, or any other rule list, with a conditional request
+// and merges it under the user rules while it streams in, so the list is
+// never held as a String and never decoded in one piece.
+//
+// The ETag and Last-Modified of the last download are persisted in the user
+// defaults, together with the URL they belong to, and sent back as
+// If-None-Match and If-Modified-Since.
+class GFWListUpdater {
+    struct Download {
+        // The body as served, to be written to the list file.
+        let list: Data
+        // The user rules ruleSet was merged with.
+        let userRules: Data?
+        let ruleSet: PACRuleSet
+        let etag: String?
+        let lastModified: String?
+    }
+
+    enum Result {
+        // The server answered 304, the local gfwlist.txt is current.
+        case notModified
+        case downloaded(Download)
+        case failed
+    }
+
+    let url: String
+    let userRules: Data?
+    let format: RuleListFormat
+    let defaults: UserDefaults
+    let session: Session
+
+    private let etagKey: String
+    private let lastModifiedKey: String
+    private let validatorsURLKey: String
+
+    // The validators are kept under "<defaultsKey>.ETag" and so on.
+    init(url: String, userRules: Data?, format: RuleListFormat = .base64, defaultsKey: String = "GFWList"
+        , defaults: UserDefaults = .standard, session: Session = AF) {
+        self.url = url
+        self.userRules = userRules
+        self.format = format
+        self.defaults = defaults
+        self.session = session
+        etagKey = defaultsKey + ".ETag"
+        lastModifiedKey = defaultsKey + ".LastModified"
+        validatorsURLKey = defaultsKey + ".ValidatorsURL"
+    }
+
+    // Pass useValidators false if the content of the last download is gone,
+    // a 304 would not help then. The completion is called on the main queue.
+    func update(useValidators: Bool, completion: @escaping (Result) -> Void) {
+        guard var request = try? URLRequest(url: url, method: .get) else {
+            completion(.failed)
+            return
+        }
+        // Let the 304 through instead of a copy from the URL cache.
+        request.cachePolicy = .reloadIgnoringLocalCacheData
+        if useValidators && defaults.string(forKey: validatorsURLKey) == url {
+            if let etag = defaults.string(forKey: etagKey) {
+                request.setValue(etag, forHTTPHeaderField: "If-None-Match")
+            }
+            if let lastModified = defaults.string(forKey: lastModifiedKey) {
+                request.setValue(lastModified, forHTTPHeaderField: "If-Modified-Since")
+            }
+        }
+
+        var list = Data()
+        var decoder = RuleListDecoder(format: format)
+        var ruleSet = PACRuleSet(userRules: userRules)
+        var isValid = true
+
+        // Each download is parsed on a queue of its own.
+        let queue = DispatchQueue(label: "GFWListUpdater")
+        session.streamRequest(request).responseStream(on: queue) { stream in
+            switch stream.event {
+            case .stream(let chunkResult):
+                guard case .success(let chunk) = chunkResult else {
+                    return
+                }
+                list.append(chunk)
+                if isValid {
+                    isValid = decoder.feed(chunk) { ruleSet.addGFWListLine($0) }
+                }
+            case .complete(let end):
+                let result: Result
+                switch end.response?.statusCode {
+                case 304 where end.error == nil:
+                    result = .notModified
+                case 200 where end.error == nil:
+                    if isValid && decoder.finish({ ruleSet.addGFWListLine($0) }) {
+                        let headers = end.response?.headers
+                        result = .downloaded(Download(list: list, userRules: self.userRules, ruleSet: ruleSet
+                            , etag: headers?.value(for: "ETag")
+                            , lastModified: headers?.value(for: "Last-Modified")))
+                    } else {
+                        NSLog("GFWListUpdater - \(self.url) is not valid base64")
+                        result = .failed
+                    }
+                default:
+                    result = .failed
+                }
+                DispatchQueue.main.async {
+                    completion(result)
+                }
+            }
+        }
+    }
+
+    // Remembers the validators of a download once it has been saved.
+    func commit(_ download: Download) {
+        if download.etag == nil && download.lastModified == nil {
+            forgetValidators()
+            return
+        }
+        defaults.set(download.etag, forKey: etagKey)
+        defaults.set(download.lastModified, forKey: lastModifiedKey)
+        defaults.set(url, forKey: validatorsURLKey)
+    }
+
+    func forgetValidators() {
+        defaults.removeObject(forKey: etagKey)
+        defaults.removeObject(forKey: lastModifiedKey)
+        defaults.removeObject(forKey: validatorsURLKey)
+    }
+}
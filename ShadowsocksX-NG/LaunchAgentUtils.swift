@@ -82,28 +82,19 @@ func generateSSLocalLauchAgentPlist() -> Bool {
     }
 }
 
-func StartSSLocal() {
-    let bundle = Bundle.main
-    let installerPath = bundle.path(forResource: "start_ss_local.sh", ofType: nil)
-    let task = Process.launchedProcess(launchPath: installerPath!, arguments: [""])
-    task.waitUntilExit()
-    if task.terminationStatus == 0 {
-        NSLog("Start ss-local succeeded.")
-    } else {
-        NSLog("Start ss-local failed.")
+extension ServiceSupervisor {
+    static let shared = ServiceSupervisor(launcher: SystemProcessLauncher()
+        , notificationName: NOTIFY_SERVICE_STATE_CHANGED) {
+        Bundle.main.path(forResource: $0, ofType: nil)
     }
 }
 
+func StartSSLocal() {
+    ServiceSupervisor.shared.start(.ssLocal)
+}
+
 func StopSSLocal() {
-    let bundle = Bundle.main
-    let installerPath = bundle.path(forResource: "stop_ss_local.sh", ofType: nil)
-    let task = Process.launchedProcess(launchPath: installerPath!, arguments: [""])
-    task.waitUntilExit()
-    if task.terminationStatus == 0 {
-        NSLog("Stop ss-local succeeded.")
-    } else {
-        NSLog("Stop ss-local failed.")
-    }
+    ServiceSupervisor.shared.stop(.ssLocal)
 }
 
 func InstallSSLocal() {
@@ -180,13 +171,7 @@ func SyncSSLocal() {
         let on = UserDefaults.standard.bool(forKey: "ShadowsocksOn")
         if on {
             if changed {
-                StopSSLocal()
-                DispatchQueue.main.asyncAfter(
-                    deadline: DispatchTime.now() + DispatchTimeInterval.seconds(1),
-                    execute: {
-                        () in
-                        StartSSLocal()
-                    })
+                ServiceSupervisor.shared.restart(.ssLocal)
             } else {
                 StartSSLocal()
             }
@@ -317,27 +302,11 @@ func generatePrivoxyLauchAgentPlist() -> Bool {
 }
 
 func StartPrivoxy() {
-    let bundle = Bundle.main
-    let installerPath = bundle.path(forResource: "start_privoxy.sh", ofType: nil)
-    let task = Process.launchedProcess(launchPath: installerPath!, arguments: [""])
-    task.waitUntilExit()
-    if task.terminationStatus == 0 {
-        NSLog("Start privoxy succeeded.")
-    } else {
-        NSLog("Start privoxy failed.")
-    }
+    ServiceSupervisor.shared.start(.privoxy)
 }
 
 func StopPrivoxy() {
-    let bundle = Bundle.main
-    let installerPath = bundle.path(forResource: "stop_privoxy.sh", ofType: nil)
-    let task = Process.launchedProcess(launchPath: installerPath!, arguments: [""])
-    task.waitUntilExit()
-    if task.terminationStatus == 0 {
-        NSLog("Stop privoxy succeeded.")
-    } else {
-        NSLog("Stop privoxy failed.")
-    }
+    ServiceSupervisor.shared.stop(.privoxy)
 }
 
 func InstallPrivoxy() {
@@ -432,13 +401,7 @@ func SyncPrivoxy() {
         let on = UserDefaults.standard.bool(forKey: "LocalHTTPOn")
         if on {
             if changed {
-                StopPrivoxy()
-                DispatchQueue.main.asyncAfter(
-                    deadline: DispatchTime.now() + DispatchTimeInterval.seconds(1),
-                    execute: {
-                        () in
-                        StartPrivoxy()
-                    })
+                ServiceSupervisor.shared.restart(.privoxy)
             } else {
                 StartPrivoxy()
             }
@@ -16,3 +16,6 @@ let NOTIFY_TOGGLE_RUNNING_SHORTCUT = Notification.Name(rawValue: "NOTIFY_TOGGLE_
 let NOTIFY_SWITCH_PROXY_MODE_SHORTCUT = Notification.Name(rawValue: "NOTIFY_SWITCH_PROXY_MODE_SHORTCUT")
 
 let NOTIFY_FOUND_SS_URL = Notification.Name(rawValue: "NOTIFY_FOUND_SS_URL")
+
+// Posted by ServiceSupervisor.shared, see its userInfo keys.
+let NOTIFY_SERVICE_STATE_CHANGED = Notification.Name(rawValue: "NOTIFY_SERVICE_STATE_CHANGED")
@@ -0,0 +1,538 @@
+//
+//  PACCompiler.swift
+//  ShadowsocksX-NG
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import Foundation
+
+// Placeholders in abp.js which are substituted when generating the PAC file.
+enum PACTemplatePlaceholder: String, CaseIterable {
+    case rules = "__RULES__"
+    case tables = "__TABLES__"
+    case socks5Address = "__SOCKS5ADDR__"
+    case socks5Port = "__SOCKS5PORT__"
+}
+
+// The abp.js template, split once into literal chunks and placeholders.
+struct PACTemplate {
+    enum Segment {
+        case literal([UInt8])
+        case placeholder(PACTemplatePlaceholder)
+    }
+
+    let data: Data
+    let segments: [Segment]
+    let literalByteCount: Int
+    // Index of the first segment which depends on the rules.
+    let bodyStart: Int
+    // Whether the proxy address is used after bodyStart too.
+    let bodyNeedsProxy: Bool
+
+    static let bundled: PACTemplate? = {
+        guard let url = Bundle.main.url(forResource: "abp", withExtension: "js"),
+            let data = try? Data(contentsOf: url) else {
+            return nil
+        }
+        return PACTemplate(data: data)
+    }()
+
+    init(data: Data) {
+        self.data = data
+        let bytes = [UInt8](data)
+        let placeholders = PACTemplatePlaceholder.allCases.map { ($0, Array($0.rawValue.utf8)) }
+
+        var segments: [Segment] = []
+        var literalStart = 0
+        var i = 0
+        scan: while i + 1 < bytes.count {
+            if bytes[i] == UInt8(ascii: "_") && bytes[i + 1] == UInt8(ascii: "_") {
+                for (placeholder, name) in placeholders {
+                    if i + name.count <= bytes.count && bytes[i..<(i + name.count)].elementsEqual(name) {
+                        if literalStart < i {
+                            segments.append(.literal(Array(bytes[literalStart..<i])))
+                        }
+                        segments.append(.placeholder(placeholder))
+                        i += name.count
+                        literalStart = i
+                        continue scan
+                    }
+                }
+            }
+            i += 1
+        }
+        if literalStart < bytes.count {
+            segments.append(.literal(Array(bytes[literalStart...])))
+        }
+        self.segments = segments
+        self.literalByteCount = segments.reduce(0) {
+            if case .literal(let chunk) = $1 {
+                return $0 + chunk.count
+            }
+            return $0
+        }
+        let bodyStart = segments.firstIndex {
+            if case .placeholder(let placeholder) = $0 {
+                return placeholder == .rules || placeholder == .tables
+            }
+            return false
+        } ?? segments.count
+        self.bodyStart = bodyStart
+        self.bodyNeedsProxy = segments[bodyStart...].contains {
+            if case .placeholder(let placeholder) = $0 {
+                return placeholder == .socks5Address || placeholder == .socks5Port
+            }
+            return false
+        }
+    }
+}
+
+// Renders the merged rules into gfwlist.js.
+//
+// Every rule is JSON escaped straight into one output buffer together with
+// the template chunks, so no intermediate strings or arrays are built.
+// Without precompiled domain tables and for the same rules, the output is
+// byte-identical to the JSONSerialization(.prettyPrinted) and
+// replacingOccurrences based pipeline it replaces.
+struct PACCompiler {
+    let template: PACTemplate
+    // Compile the rules that need no regex into PACDomainTables.
+    let precompileDomainTables: Bool
+    // Write the rules as `["a","b"]` instead of one per line.
+    let compactOutput: Bool
+    // Rewrite the rules abp.js would test on every lookup, see PACRuleLowering.
+    let lowerSlowFilters: Bool
+
+    init(template: PACTemplate, precompileDomainTables: Bool = false, compactOutput: Bool = false
+        , lowerSlowFilters: Bool = false) {
+        self.template = template
+        self.precompileDomainTables = precompileDomainTables
+        self.compactOutput = compactOutput
+        self.lowerSlowFilters = lowerSlowFilters
+    }
+
+    // Everything besides the rules and the template that changes the output.
+    var options: [String] {
+        return ["precompileDomainTables=\(precompileDomainTables)", "compactOutput=\(compactOutput)"
+            , "lowerSlowFilters=\(lowerSlowFilters)"]
+    }
+
+    // The lowering of the rules left to the runtime matcher, for its report.
+    func lowering(of rules: [PACRule]) -> PACRuleLowering {
+        return PACRuleLowering(rules: tables(for: rules).runtimeRules)
+    }
+
+    // IP ranges have no ABP equivalent, so they always go to the tables.
+    private func tables(for rules: [PACRule]) -> PACDomainTables {
+        if rules.isEmpty {
+            return PACDomainTables.empty
+        }
+        return precompileDomainTables ? PACDomainTables(rules: rules) : PACDomainTables(ipRangesOf: rules)
+    }
+
+    // The size of the rules literal, for reports.
+    func rulesByteCount(_ rules: [PACRule]) -> Int {
+        var out = [UInt8]()
+        var writer = JSONArrayWriter(compact: compactOutput)
+        for rule in rules {
+            writer.append(rule.text.utf8, to: &out)
+        }
+        writer.finish(to: &out)
+        return out.count
+    }
+
+    func compile(gfwlist: Data, userRules: Data?, socks5Address: String, socks5Port: Int) -> Data? {
+        guard let ruleSet = PACRuleSet(gfwlist: gfwlist, userRules: userRules) else {
+            return nil
+        }
+        return render(rules: ruleSet.rules, socks5Address: socks5Address, socks5Port: socks5Port)
+    }
+
+    func render(rules: [PACRule], socks5Address: String, socks5Port: Int) -> Data {
+        var out = [UInt8]()
+        write(template.segments[...], rules: rules, socks5Address: socks5Address, socks5Port: socks5Port, to: &out)
+        return Data(out)
+    }
+
+    // The part of the PAC before the rules, which holds the proxy address.
+    func renderHeader(socks5Address: String, socks5Port: Int) -> [UInt8] {
+        var out = [UInt8]()
+        write(template.segments[..<template.bodyStart], rules: [], socks5Address: socks5Address
+            , socks5Port: socks5Port, to: &out)
+        return out
+    }
+
+    // The rest of the PAC, which only depends on the rules. Returns nil if
+    // the template uses the proxy address after the rules too.
+    func renderBody(rules: [PACRule]) -> [UInt8]? {
+        if template.bodyNeedsProxy {
+            return nil
+        }
+        var out = [UInt8]()
+        write(template.segments[template.bodyStart...], rules: rules, socks5Address: "", socks5Port: 0, to: &out)
+        return out
+    }
+
+    private func write(_ segments: ArraySlice<PACTemplate.Segment>, rules: [PACRule]
+        , socks5Address: String, socks5Port: Int, to out: inout [UInt8]) {
+        let address: [UInt8]
+        if isIPv6Address(socks5Address) {
+            address = Array("[\(socks5Address)]".utf8)
+        } else {
+            address = Array(socks5Address.utf8)
+        }
+        let port = Array("\(socks5Port)".utf8)
+
+        let tables = self.tables(for: rules)
+        var runtimeRules = tables.runtimeRules
+        if lowerSlowFilters {
+            runtimeRules = PACRuleLowering(rules: runtimeRules).rules
+        }
+
+        var rulesByteCount = 0
+        for rule in runtimeRules {
+            rulesByteCount += rule.text.utf8.count + 8
+        }
+        out.reserveCapacity(out.count + template.literalByteCount + rulesByteCount + rulesByteCount / 8
+            + 4 * (address.count + port.count))
+
+        for segment in segments {
+            switch segment {
+            case .literal(let chunk):
+                out.append(contentsOf: chunk)
+            case .placeholder(.socks5Address):
+                out.append(contentsOf: address)
+            case .placeholder(.socks5Port):
+                out.append(contentsOf: port)
+            case .placeholder(.rules):
+                var writer = JSONArrayWriter(compact: compactOutput)
+                for rule in runtimeRules {
+                    writer.append(rule.text.utf8, to: &out)
+                }
+                writer.finish(to: &out)
+            case .placeholder(.tables):
+                tables.write(to: &out)
+            }
+        }
+    }
+}
+
+// MARK: - Helpers
+
+private func isIPv6Address(_ address: String) -> Bool {
+    var sin6 = sockaddr_in6()
+    return address.withCString({ cstring in inet_pton(AF_INET6, cstring, &sin6.sin6_addr) }) == 1
+}
+
+// Splits on the same characters as CharacterSet.newlines:
+// U+000A...U+000D, U+0085, U+2028 and U+2029.
+func forEachLine(_ bytes: [UInt8], _ body: (ArraySlice<UInt8>) -> Void) {
+    var splitter = LineSplitter()
+    splitter.feed(bytes, body)
+    splitter.finish(body)
+}
+
+// forEachLine over a byte stream which arrives in chunks. A line or a
+// multi-byte newline split across two chunks is held back until the next one.
+struct LineSplitter {
+    private var pending: [UInt8] = []
+    private var atStart = true
+
+    mutating func feed(_ chunk: [UInt8], _ body: (ArraySlice<UInt8>) -> Void) {
+        var bytes = chunk
+        if !pending.isEmpty {
+            pending.append(contentsOf: chunk)
+            bytes = pending
+        }
+        pending = []
+
+        var start = 0
+        if atStart {
+            // Skip the UTF-8 BOM, String(contentsOfFile:) drops it too.
+            let bom: [UInt8] = [0xEF, 0xBB, 0xBF]
+            if bytes.count < bom.count && bom.starts(with: bytes) {
+                pending = bytes
+                return
+            }
+            if bytes.starts(with: bom) {
+                start = bom.count
+            }
+            atStart = false
+        }
+        var i = start
+        let n = bytes.count
+        while i < n {
+            let c = bytes[i]
+            var newlineLength = 0
+            if c >= 0x0A && c <= 0x0D {
+                newlineLength = 1
+            } else if c == 0xC2 {
+                if i + 1 == n {
+                    break
+                }
+                if bytes[i + 1] == 0x85 {
+                    newlineLength = 2
+                }
+            } else if c == 0xE2 {
+                if i + 2 >= n {
+                    break
+                }
+                if bytes[i + 1] == 0x80 && (bytes[i + 2] == 0xA8 || bytes[i + 2] == 0xA9) {
+                    newlineLength = 3
+                }
+            }
+            if newlineLength > 0 {
+                body(bytes[start..<i])
+                i += newlineLength
+                start = i
+            } else {
+                i += 1
+            }
+        }
+        pending = Array(bytes[start..<n])
+    }
+
+    // Hands out the last line, which may be empty.
+    mutating func finish(_ body: (ArraySlice<UInt8>) -> Void) {
+        body(pending[...])
+        pending = []
+        atStart = true
+    }
+}
+
+// Same semantics as Data(base64Encoded:options: .ignoreUnknownCharacters).
+func decodeBase64(_ data: Data) -> [UInt8]? {
+    var decoder = Base64Decoder()
+    var out = [UInt8]()
+    out.reserveCapacity(data.count / 4 * 3)
+    guard decoder.decode(data, to: &out) && decoder.finish(to: &out) else {
+        return nil
+    }
+    return out
+}
+
+// decodeBase64 over a stream which arrives in chunks of any size.
+struct Base64Decoder {
+    private var quantum: UInt32 = 0
+    private var bits = 0
+    private var padding = 0
+
+    // Appends every complete byte decoded so far. Returns false on data
+    // after the padding.
+    mutating func decode<C: Sequence>(_ chunk: C, to out: inout [UInt8]) -> Bool where C.Element == UInt8 {
+        for c in chunk {
+            let v = base64DecodeTable[Int(c)]
+            if v < 0 {
+                if c == UInt8(ascii: "=") {
+                    padding += 1
+                }
+                continue
+            }
+            if padding > 0 {
+                return false
+            }
+            quantum = (quantum << 6) | UInt32(v)
+            bits += 6
+            if bits == 24 {
+                out.append(UInt8(truncatingIfNeeded: quantum >> 16))
+                out.append(UInt8(truncatingIfNeeded: quantum >> 8))
+                out.append(UInt8(truncatingIfNeeded: quantum))
+                quantum = 0
+                bits = 0
+            }
+        }
+        return true
+    }
+
+    // Appends the bytes of the last, partial quantum. Returns false if it
+    // holds a single character.
+    mutating func finish(to out: inout [UInt8]) -> Bool {
+        defer {
+            quantum = 0
+            bits = 0
+            padding = 0
+        }
+        switch bits {
+        case 0:
+            break
+        case 12:
+            out.append(UInt8(truncatingIfNeeded: quantum >> 4))
+        case 18:
+            out.append(UInt8(truncatingIfNeeded: quantum >> 10))
+            out.append(UInt8(truncatingIfNeeded: quantum >> 2))
+        default:
+            return false
+        }
+        return true
+    }
+}
+
+// The encodings of an ABP list. gfwlist.txt is base64, most other lists are
+// plain text.
+enum RuleListFormat: String {
+    case base64
+    case plain
+    // base64 if the first line is, plain otherwise.
+    case detect
+}
+
+// Splits a rule list arriving in chunks into lines, decoding it first if it
+// is base64.
+struct RuleListDecoder {
+    private(set) var format: RuleListFormat
+    private var base64 = Base64Decoder()
+    private var splitter = LineSplitter()
+    // The start of the list while its format is not known yet.
+    private var head: [UInt8] = []
+    private var decoded: [UInt8] = []
+
+    init(format: RuleListFormat) {
+        self.format = format
+    }
+
+    // Returns false if the list is not valid base64.
+    mutating func feed<C: Collection>(_ chunk: C, _ body: (ArraySlice<UInt8>) -> Void) -> Bool
+        where C.Element == UInt8 {
+        switch format {
+        case .detect:
+            head.append(contentsOf: chunk)
+            guard let newline = head.firstIndex(where: { $0 == 0x0A || $0 == 0x0D }) else {
+                return true
+            }
+            detect(firstLine: head[..<newline])
+            let held = head
+            head = []
+            return feed(held, body)
+        case .plain:
+            splitter.feed(Array(chunk), body)
+            return true
+        case .base64:
+            decoded.removeAll(keepingCapacity: true)
+            guard base64.decode(chunk, to: &decoded) else {
+                return false
+            }
+            splitter.feed(decoded, body)
+            return true
+        }
+    }
+
+    mutating func finish(_ body: (ArraySlice<UInt8>) -> Void) -> Bool {
+        if format == .detect {
+            detect(firstLine: head[...])
+            let held = head
+            head = []
+            guard feed(held, body) else {
+                return false
+            }
+        }
+        if format == .base64 {
+            decoded.removeAll()
+            guard base64.finish(to: &decoded) else {
+                return false
+            }
+            splitter.feed(decoded, body)
+        }
+        splitter.finish(body)
+        return true
+    }
+
+    // Base64 lists are wrapped into lines of whole quanta, and an ABP line
+    // always holds a character outside the base64 alphabet or is no multiple
+    // of four long, e.g. "[Adblock Plus 2.0]", "! Title" or "example.com".
+    private mutating func detect(firstLine line: ArraySlice<UInt8>) {
+        let isBase64 = !line.isEmpty && line.count % 4 == 0 && line.allSatisfy {
+            base64DecodeTable[Int($0)] >= 0 || $0 == UInt8(ascii: "=")
+        }
+        format = isBase64 ? .base64 : .plain
+    }
+}
+
+// The rules of one list in file order, without duplicates.
+func parseRuleList(_ data: Data, format: RuleListFormat) -> [PACRule]? {
+    var decoder = RuleListDecoder(format: format)
+    var ruleSet = PACRuleSet()
+    guard decoder.feed(data, { ruleSet.addGFWListLine($0) }),
+        decoder.finish({ ruleSet.addGFWListLine($0) }) else {
+        return nil
+    }
+    return ruleSet.rules
+}
+
+private let base64DecodeTable: [Int8] = {
+    var table = [Int8](repeating: -1, count: 256)
+    for (i, c) in "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/".utf8.enumerated() {
+        table[Int(c)] = Int8(i)
+    }
+    return table
+}()
+
+// Writes a JSON array of strings in the layout of JSONSerialization's
+// .prettyPrinted option, escaping the same characters, "/" included.
+// Compact arrays have no whitespace and leave "/" alone.
+struct JSONArrayWriter {
+    let compact: Bool
+    private(set) var count = 0
+
+    init(compact: Bool = false) {
+        self.compact = compact
+    }
+
+    mutating func append<C: Collection>(_ string: C, to out: inout [UInt8]) where C.Element == UInt8 {
+        if compact {
+            out.append(contentsOf: count == 0 ? "[\"".utf8 : ",\"".utf8)
+        } else if count == 0 {
+            out.append(contentsOf: "[\n  \"".utf8)
+        } else {
+            out.append(contentsOf: ",\n  \"".utf8)
+        }
+        appendJSONEscaped(string, to: &out, escapeSlash: !compact)
+        out.append(UInt8(ascii: "\""))
+        count += 1
+    }
+
+    func finish(to out: inout [UInt8]) {
+        if compact {
+            out.append(contentsOf: count == 0 ? "[]".utf8 : "]".utf8)
+        } else if count == 0 {
+            out.append(contentsOf: "[\n\n]".utf8)
+        } else {
+            out.append(contentsOf: "\n]".utf8)
+        }
+    }
+}
+
+func appendJSONEscaped<C: Collection>(_ string: C, to out: inout [UInt8], escapeSlash: Bool = true)
+    where C.Element == UInt8 {
+    let hex: [UInt8] = Array("0123456789abcdef".utf8)
+    for c in string {
+        switch c {
+        case UInt8(ascii: "\""):
+            out.append(UInt8(ascii: "\\"))
+            out.append(c)
+        case UInt8(ascii: "\\"):
+            out.append(UInt8(ascii: "\\"))
+            out.append(c)
+        case UInt8(ascii: "/") where escapeSlash:
+            out.append(UInt8(ascii: "\\"))
+            out.append(c)
+        case 0x08:
+            out.append(contentsOf: "\\b".utf8)
+        case 0x09:
+            out.append(contentsOf: "\\t".utf8)
+        case 0x0A:
+            out.append(contentsOf: "\\n".utf8)
+        case 0x0C:
+            out.append(contentsOf: "\\f".utf8)
+        case 0x0D:
+            out.append(contentsOf: "\\r".utf8)
+        case 0x00..<0x20:
+            out.append(contentsOf: "\\u00".utf8)
+            out.append(hex[Int(c >> 4)])
+            out.append(hex[Int(c & 0x0F)])
+        default:
+            out.append(c)
+        }
+    }
+}
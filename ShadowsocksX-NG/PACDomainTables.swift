@@ -0,0 +1,318 @@
+//
+//  PACDomainTables.swift
+//  ShadowsocksX-NG
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import Foundation
+
+// Lookup tables for the rules which need no regex at all, embedded in the PAC
+// as `tables` so abp.js does not have to build a Filter for each of them.
+//
+// - "||example.com" goes to `domains`. ABP matches it where the host starts
+//   or after any dot of it, and the domain may end mid label, so this is a
+//   sorted prefix-free array searched at each of those positions.
+// - "||example.com^" goes to `suffixes`, a hash of exact host suffixes.
+// - "|http://example.com/path" goes to `prefixes`, a sorted prefix-free array
+//   of URL prefixes.
+// - "10.0.0.0/8" and "fd00::/8" go to `ipv4` and `ipv6`, sorted disjoint
+//   ranges of addresses as integers and hex strings. abp.js searches them
+//   only for hosts which are IP literals, so the PAC never resolves a name.
+//
+// Everything else, keyword, regex and rules with options, stays in `rules`
+// for the runtime matcher.
+struct PACDomainTables {
+    struct Table {
+        var domains: [String] = []
+        var suffixes: [String] = []
+        var prefixes: [String] = []
+        var ranges: [PACIPRange] = []
+
+        var count: Int {
+            return domains.count + suffixes.count + prefixes.count + ranges.count
+        }
+
+        fileprivate mutating func finish() {
+            domains = prefixFree(domains)
+            prefixes = prefixFree(prefixes)
+            suffixes = Array(Set(suffixes)).sorted(by: utf8Precedes)
+            ranges = PACIPRange.merged(ranges)
+        }
+    }
+
+    var proxy = Table()
+    var direct = Table()
+    private(set) var runtimeRules: [PACRule] = []
+
+    // Tables which leave every rule to the runtime matcher.
+    static let empty = PACDomainTables()
+
+    private init() {
+    }
+
+    init(rules: [PACRule]) {
+        for rule in rules {
+            if !compile(rule) {
+                runtimeRules.append(rule)
+            }
+        }
+        proxy.finish()
+        direct.finish()
+    }
+
+    // Tables of the IP ranges only, which have no ABP equivalent to leave to
+    // the runtime matcher.
+    init(ipRangesOf rules: [PACRule]) {
+        for rule in rules {
+            if let range = PACIPRange(rule: rule) {
+                add(range, whitelist: rule.isWhitelist)
+            } else {
+                runtimeRules.append(rule)
+            }
+        }
+        proxy.finish()
+        direct.finish()
+    }
+
+    private mutating func compile(_ rule: PACRule) -> Bool {
+        if let range = PACIPRange(rule: rule) {
+            add(range, whitelist: rule.isWhitelist)
+            return true
+        }
+        var rest = Substring(rule.text.lowercased())
+        if rule.isWhitelist {
+            rest = rest.dropFirst(2)
+        }
+        switch rule.kind {
+        case .domainAnchor:
+            rest = rest.dropFirst(2)
+            var exact = false
+            if rest.hasSuffix("^") {
+                exact = true
+                rest = rest.dropLast()
+            }
+            guard let first = rest.utf8.first, let last = rest.utf8.last,
+                isAlphanumeric(first) && (!exact || isAlphanumeric(last)),
+                rest.utf8.allSatisfy({ isAlphanumeric($0) || $0 == UInt8(ascii: ".") || $0 == UInt8(ascii: "-") }) else {
+                return false
+            }
+            add(String(rest), to: exact ? \.suffixes : \.domains, whitelist: rule.isWhitelist)
+            return true
+        case .startAnchor:
+            rest = rest.dropFirst()
+            // "*", "^", "|" and "$" have a meaning in ABP, everything else
+            // is matched literally.
+            guard !rest.isEmpty, rest.utf8.allSatisfy({
+                $0 > 0x20 && $0 < 0x7F && $0 != UInt8(ascii: "*") && $0 != UInt8(ascii: "^")
+                    && $0 != UInt8(ascii: "|") && $0 != UInt8(ascii: "$")
+            }) else {
+                return false
+            }
+            add(String(rest), to: \.prefixes, whitelist: rule.isWhitelist)
+            return true
+        case .plain, .regex:
+            return false
+        }
+    }
+
+    private mutating func add(_ s: String, to list: WritableKeyPath<Table, [String]>, whitelist: Bool) {
+        if whitelist {
+            direct[keyPath: list].append(s)
+        } else {
+            proxy[keyPath: list].append(s)
+        }
+    }
+
+    private mutating func add(_ range: PACIPRange, whitelist: Bool) {
+        if whitelist {
+            direct.ranges.append(range)
+        } else {
+            proxy.ranges.append(range)
+        }
+    }
+
+    // Writes the `tables` object literal of abp.js.
+    func write(to out: inout [UInt8]) {
+        out.append(contentsOf: "{\"proxy\":".utf8)
+        writeTable(proxy, to: &out)
+        out.append(contentsOf: ",\"direct\":".utf8)
+        writeTable(direct, to: &out)
+        out.append(UInt8(ascii: "}"))
+    }
+
+    private func writeTable(_ table: Table, to out: inout [UInt8]) {
+        out.append(contentsOf: "{\"domains\":".utf8)
+        writeArray(table.domains, to: &out)
+        out.append(contentsOf: ",\"suffixes\":{".utf8)
+        for (i, suffix) in table.suffixes.enumerated() {
+            if i > 0 {
+                out.append(UInt8(ascii: ","))
+            }
+            out.append(UInt8(ascii: "\""))
+            appendJSONEscaped(suffix.utf8, to: &out)
+            out.append(contentsOf: "\":1".utf8)
+        }
+        out.append(contentsOf: "},\"prefixes\":".utf8)
+        writeArray(table.prefixes, to: &out)
+        // [first, last, first, last, ...] of each family.
+        out.append(contentsOf: ",\"ipv4\":[".utf8)
+        var first = true
+        for range in table.ranges where range.first.count == 4 {
+            for address in [range.first, range.last] {
+                if !first {
+                    out.append(UInt8(ascii: ","))
+                }
+                first = false
+                out.append(contentsOf: String(address.reduce(UInt32(0)) { $0 << 8 | UInt32($1) }).utf8)
+            }
+        }
+        out.append(contentsOf: "],\"ipv6\":".utf8)
+        writeArray(table.ranges.filter { $0.first.count == 16 }.flatMap { [hex($0.first), hex($0.last)] }, to: &out)
+        out.append(UInt8(ascii: "}"))
+    }
+
+    private func writeArray(_ strings: [String], to out: inout [UInt8]) {
+        out.append(UInt8(ascii: "["))
+        for (i, s) in strings.enumerated() {
+            if i > 0 {
+                out.append(UInt8(ascii: ","))
+            }
+            out.append(UInt8(ascii: "\""))
+            appendJSONEscaped(s.utf8, to: &out)
+            out.append(UInt8(ascii: "\""))
+        }
+        out.append(UInt8(ascii: "]"))
+    }
+}
+
+// The block of addresses of a CIDR rule, "10.0.0.0/8" or "@@fd00::/8".
+struct PACIPRange: Equatable {
+    // 4 or 16 bytes in network order.
+    let first: [UInt8]
+    let last: [UInt8]
+
+    init(first: [UInt8], last: [UInt8]) {
+        self.first = first
+        self.last = last
+    }
+
+    // Returns nil unless the rule is "@@"?, an address, "/" and a prefix
+    // length. A bare address stays an ABP rule, which matches it anywhere in
+    // the URL.
+    init?(rule: PACRule) {
+        guard rule.kind == .plain else {
+            return nil
+        }
+        let text = rule.text.dropFirst(rule.isWhitelist ? 2 : 0)
+        // Checked first, as every rule of the list goes through here.
+        guard let slash = text.firstIndex(of: "/"), slash > text.startIndex,
+            text[..<slash].utf8.allSatisfy({ $0 == UInt8(ascii: ".") || $0 == UInt8(ascii: ":") || isHexDigit($0) }),
+            let address = PACIPRange.address(String(text[..<slash])) else {
+            return nil
+        }
+        let length = text[text.index(after: slash)...]
+        guard !length.isEmpty && length.count <= 3 && length.allSatisfy({ $0.isASCII && $0.isNumber }),
+            let bits = Int(length), bits <= address.count * 8 else {
+            return nil
+        }
+        var first = address
+        var last = address
+        for i in address.indices {
+            let kept = min(max(bits - i * 8, 0), 8)
+            let mask = kept == 0 ? UInt8(0) : UInt8(truncatingIfNeeded: 0xFF << (8 - kept))
+            first[i] &= mask
+            last[i] |= ~mask
+        }
+        self.first = first
+        self.last = last
+    }
+
+    // The bytes of an IPv4 or IPv6 literal, as hosts are passed to
+    // FindProxyForURL: without brackets or with, and with a zone.
+    static func address(_ host: String) -> [UInt8]? {
+        var host = Substring(host)
+        if host.hasPrefix("[") && host.hasSuffix("]") {
+            host = host.dropFirst().dropLast()
+        }
+        if let zone = host.firstIndex(of: "%") {
+            host = host[..<zone]
+        }
+        if host.contains(":") {
+            var address = in6_addr()
+            guard String(host).withCString({ inet_pton(AF_INET6, $0, &address) }) == 1 else {
+                return nil
+            }
+            return withUnsafeBytes(of: &address) { Array($0) }
+        }
+        var address = in_addr()
+        guard String(host).withCString({ inet_pton(AF_INET, $0, &address) }) == 1 else {
+            return nil
+        }
+        return withUnsafeBytes(of: &address) { Array($0) }
+    }
+
+    func contains(_ address: [UInt8]) -> Bool {
+        return address.count == first.count && !address.lexicographicallyPrecedes(first)
+            && !last.lexicographicallyPrecedes(address)
+    }
+
+    // Sorted by first address, each family apart, with the ranges inside or
+    // overlapping another one joined.
+    static func merged(_ ranges: [PACIPRange]) -> [PACIPRange] {
+        var result: [PACIPRange] = []
+        let sorted = ranges.sorted {
+            $0.first.count != $1.first.count ? $0.first.count < $1.first.count
+                : $0.first.lexicographicallyPrecedes($1.first)
+        }
+        for range in sorted {
+            if let previous = result.last, previous.first.count == range.first.count
+                && !previous.last.lexicographicallyPrecedes(range.first) {
+                if previous.last.lexicographicallyPrecedes(range.last) {
+                    result[result.count - 1] = PACIPRange(first: previous.first, last: range.last)
+                }
+                continue
+            }
+            result.append(range)
+        }
+        return result
+    }
+}
+
+private func isHexDigit(_ c: UInt8) -> Bool {
+    return (c >= UInt8(ascii: "0") && c <= UInt8(ascii: "9")) || (c >= UInt8(ascii: "a") && c <= UInt8(ascii: "f"))
+        || (c >= UInt8(ascii: "A") && c <= UInt8(ascii: "F"))
+}
+
+private func hex(_ bytes: [UInt8]) -> String {
+    let digits = Array("0123456789abcdef".utf8)
+    var out = [UInt8]()
+    for b in bytes {
+        out.append(digits[Int(b >> 4)])
+        out.append(digits[Int(b & 0x0F)])
+    }
+    return String(decoding: out, as: UTF8.self)
+}
+
+private func isAlphanumeric(_ c: UInt8) -> Bool {
+    return (c >= UInt8(ascii: "a") && c <= UInt8(ascii: "z")) || (c >= UInt8(ascii: "0") && c <= UInt8(ascii: "9"))
+}
+
+// Byte order, which is also the UTF-16 order JavaScript compares ASCII in.
+private func utf8Precedes(_ a: String, _ b: String) -> Bool {
+    return a.utf8.lexicographicallyPrecedes(b.utf8)
+}
+
+// Sorts and drops every string another one is a prefix of. Anything the
+// longer string matches, the shorter one already matches.
+private func prefixFree(_ strings: [String]) -> [String] {
+    var result: [String] = []
+    for s in strings.sorted(by: utf8Precedes) {
+        if let last = result.last, s.utf8.starts(with: last.utf8) {
+            continue
+        }
+        result.append(s)
+    }
+    return result
+}
@@ -0,0 +1,655 @@
+//
+//  PACMatcher.swift
+//  ShadowsocksX-NG
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import Foundation
+
+// Tells whether the PAC would proxy a URL without evaluating it. Built from
+// the rules the PAC is generated from, see LoadPACMatcher, with the semantics
+// of CombinedMatcher in abp.js:
+//
+// - A URL goes DIRECT if any whitelist rule matches it, through the proxy if
+//   any other rule does, and DIRECT if none does.
+// - Rules are parsed as RegExpFilter.fromText parses them, "$domain=" and
+//   "$match-case" included. The request type options are ignored, as
+//   FindProxyForURL has no request type. Rules abp.js rejects, for an
+//   unknown option or an invalid regex, never match. In the PAC they throw.
+// - abp.js tests a rule only if the keyword it indexed the rule by is a whole
+//   token of the URL. Any keyword it may pick is one in every URL the rule
+//   matches, so the keyword never decides. Here rules are indexed by their
+//   longest literal in an Aho–Corasick automaton instead, which also covers
+//   the rules abp.js has no keyword for and tests on every lookup.
+// - CIDR rules like "10.0.0.0/8" match hosts which are IP literals in the
+//   range, as the PAC's IP tables do, see PACDomainTables.
+//
+// Rules other than regexes are matched without NSRegularExpression. ASCII
+// letters match case insensitively, other characters as they are: clients
+// pass the PAC percent-encoded URLs and punycode hosts.
+//
+// A matcher is immutable, so lookups may run on any thread.
+final class PACMatcher {
+    enum Decision: Equatable {
+        case proxy(rule: String)
+        // The whitelist rule, nil if no rule matched.
+        case direct(rule: String?)
+
+        var isProxy: Bool {
+            if case .proxy = self {
+                return true
+            }
+            return false
+        }
+    }
+
+    private let filters: [PACFilter]
+    private let automaton: AhoCorasick
+    // The filters of each string of the automaton.
+    private let filtersByLiteral: [[Int32]]
+    // Filters without a literal, tested on every lookup.
+    private let unindexed: [Int32]
+
+    var ruleCount: Int {
+        return filters.count
+    }
+
+    init(rules: [PACRule]) {
+        var filters: [PACFilter] = []
+        var literals: [[UInt8]] = []
+        var literalIndex = [[UInt8]: Int]()
+        var filtersByLiteral: [[Int32]] = []
+        var unindexed: [Int32] = []
+        var texts = Set<String>()
+        for rule in rules {
+            guard texts.insert(rule.text).inserted, let filter = PACFilter(text: rule.text) else {
+                continue
+            }
+            let i = Int32(filters.count)
+            filters.append(filter)
+            guard let literal = filter.literal else {
+                unindexed.append(i)
+                continue
+            }
+            if let j = literalIndex[literal] {
+                filtersByLiteral[j].append(i)
+            } else {
+                literalIndex[literal] = literals.count
+                literals.append(literal)
+                filtersByLiteral.append([i])
+            }
+        }
+        self.filters = filters
+        self.automaton = AhoCorasick(literals)
+        self.filtersByLiteral = filtersByLiteral
+        self.unindexed = unindexed
+    }
+
+    // host is what the client passes FindProxyForURL, by default the host of
+    // url.
+    func decision(for url: String, host: String? = nil) -> Decision {
+        let input = PACMatchInput(url: url, host: (host ?? PACMatcher.host(of: url)).lowercased())
+        var blocking: Int32? = nil
+        var whitelisted: Int32? = nil
+        // Returns false once the decision is made.
+        func test(_ i: Int32) -> Bool {
+            let filter = filters[Int(i)]
+            if filter.isWhitelist {
+                if filter.matches(input) {
+                    whitelisted = i
+                    return false
+                }
+            } else if blocking == nil && filter.matches(input) {
+                blocking = i
+            }
+            return true
+        }
+
+        automaton.forEachMatch(in: input.lowercased) { literal in
+            for i in filtersByLiteral[literal] {
+                if !test(i) {
+                    return false
+                }
+            }
+            return true
+        }
+        if whitelisted == nil {
+            for i in unindexed {
+                if !test(i) {
+                    break
+                }
+            }
+        }
+
+        if let i = whitelisted {
+            return .direct(rule: filters[Int(i)].text)
+        }
+        if let i = blocking {
+            return .proxy(rule: filters[Int(i)].text)
+        }
+        return .direct(rule: nil)
+    }
+
+    // The host of a URL as clients pass it to FindProxyForURL, without user
+    // info, port or IPv6 brackets.
+    static func host(of url: String) -> String {
+        var rest = Substring(url)
+        if let scheme = rest.range(of: "://") {
+            rest = rest[scheme.upperBound...]
+        }
+        if let end = rest.firstIndex(where: { $0 == "/" || $0 == "?" || $0 == "#" }) {
+            rest = rest[..<end]
+        }
+        if let at = rest.lastIndex(of: "@") {
+            rest = rest[rest.index(after: at)...]
+        }
+        if rest.hasPrefix("[") {
+            if let close = rest.firstIndex(of: "]") {
+                return String(rest[rest.index(after: rest.startIndex)..<close])
+            }
+        } else if let colon = rest.firstIndex(of: ":") {
+            rest = rest[..<colon]
+        }
+        return String(rest)
+    }
+}
+
+private struct PACMatchInput {
+    let url: String
+    let host: String
+    let bytes: [UInt8]
+    // bytes with ASCII letters lowercased.
+    let lowercased: [UInt8]
+
+    init(url: String, host: String) {
+        self.url = url
+        self.host = host
+        bytes = Array(url.utf8)
+        lowercased = bytes.map { $0 >= UInt8(ascii: "A") && $0 <= UInt8(ascii: "Z") ? $0 + 0x20 : $0 }
+    }
+}
+
+// Filter.optionsRegExp, with the ASCII classes of JavaScript spelled out.
+private let optionsRegex = try! NSRegularExpression(
+    pattern: "\\$(~?[A-Za-z0-9_\\-]+(?:=[^,\\s]+)?(?:,~?[A-Za-z0-9_\\-]+(?:=[^,\\s]+)?)*)$")
+
+// RegExpFilter.typeMap, the options which only restrict the request type.
+private let requestTypes: Set<String> = [
+    "OTHER", "SCRIPT", "IMAGE", "STYLESHEET", "OBJECT", "SUBDOCUMENT", "DOCUMENT", "XBL", "PING",
+    "XMLHTTPREQUEST", "OBJECT_SUBREQUEST", "DTD", "MEDIA", "FONT", "BACKGROUND", "POPUP", "ELEMHIDE",
+]
+
+// One rule as RegExpFilter.fromText builds it.
+private struct PACFilter {
+    enum Pattern {
+        case glob(PACGlob)
+        case regex(NSRegularExpression)
+        case ipRange(PACIPRange)
+    }
+
+    let text: String
+    let isWhitelist: Bool
+    let pattern: Pattern
+    // As ActiveFilter.getDomains builds them: upper case domains to whether
+    // the rule applies there, and "" for every other domain.
+    let domains: [String: Bool]?
+    // FindProxyForURL has no sitekey, so "$sitekey=" rules never apply.
+    let hasSitekeys: Bool
+
+    // What every URL the rule matches contains, lowercased.
+    var literal: [UInt8]? {
+        if case .glob(let glob) = pattern {
+            return glob.literal
+        }
+        return nil
+    }
+
+    init?(text: String) {
+        self.text = text
+        var rest = text
+        isWhitelist = rest.hasPrefix("@@")
+        if isWhitelist {
+            rest = String(rest.dropFirst(2))
+        }
+        if let range = PACIPRange(rule: PACRule(text: text)) {
+            pattern = .ipRange(range)
+            domains = nil
+            hasSitekeys = false
+            return
+        }
+
+        var matchCase = false
+        var domainSource: String? = nil
+        var hasSitekeys = false
+        if rest.contains("$"),
+            let match = optionsRegex.firstMatch(in: rest, range: NSRange(rest.startIndex..., in: rest)),
+            let whole = Range(match.range, in: rest), let list = Range(match.range(at: 1), in: rest) {
+            let options = rest[list].uppercased().split(separator: ",", omittingEmptySubsequences: false)
+            rest = String(rest[..<whole.lowerBound])
+            for option in options {
+                var name = option
+                var value: Substring? = nil
+                if let equal = option.firstIndex(of: "=") {
+                    name = option[..<equal]
+                    value = option[option.index(after: equal)...]
+                }
+                var key = String(name)
+                if let hyphen = key.firstIndex(of: "-") {
+                    key.replaceSubrange(hyphen...hyphen, with: "_")
+                }
+                if requestTypes.contains(key) || (key.hasPrefix("~") && requestTypes.contains(String(key.dropFirst()))) {
+                    continue
+                }
+                switch key {
+                case "MATCH_CASE":
+                    matchCase = true
+                case "~MATCH_CASE":
+                    matchCase = false
+                case "DOMAIN":
+                    domainSource = value.map { String($0) }
+                case "SITEKEY":
+                    hasSitekeys = value != nil
+                case "THIRD_PARTY", "~THIRD_PARTY", "COLLAPSE", "~COLLAPSE":
+                    break
+                default:
+                    return nil
+                }
+            }
+        }
+        self.domains = PACFilter.domains(from: domainSource)
+        self.hasSitekeys = hasSitekeys
+
+        if rest.utf16.count >= 2 && rest.hasPrefix("/") && rest.hasSuffix("/") {
+            let source = String(rest.dropFirst().dropLast())
+            guard let regex = try? NSRegularExpression(pattern: source
+                , options: matchCase ? [] : [.caseInsensitive]) else {
+                return nil
+            }
+            pattern = .regex(regex)
+        } else {
+            pattern = .glob(PACGlob(Array(rest.utf8), matchCase: matchCase))
+        }
+    }
+
+    private static func domains(from source: String?) -> [String: Bool]? {
+        guard let source = source, !source.isEmpty else {
+            return nil
+        }
+        let list = source.split(separator: "|", omittingEmptySubsequences: false)
+        var domains = [String: Bool]()
+        if list.count == 1 && !list[0].hasPrefix("~") {
+            domains[""] = false
+            domains[trimmingTrailingDots(list[0])] = true
+            return domains
+        }
+        var hasIncludes = false
+        for entry in list {
+            var domain = trimmingTrailingDots(entry)
+            if domain.isEmpty {
+                continue
+            }
+            var include = true
+            if domain.hasPrefix("~") {
+                include = false
+                domain = String(domain.dropFirst())
+            } else {
+                hasIncludes = true
+            }
+            domains[domain] = include
+        }
+        domains[""] = !hasIncludes
+        return domains
+    }
+
+    // ActiveFilter.isActiveOnDomain
+    private func isActive(on docDomain: String) -> Bool {
+        if hasSitekeys {
+            return false
+        }
+        guard let domains = domains else {
+            return true
+        }
+        if docDomain.isEmpty {
+            return domains[""] ?? false
+        }
+        var domain = trimmingTrailingDots(docDomain).uppercased()[...]
+        while true {
+            if let include = domains[String(domain)] {
+                return include
+            }
+            guard let dot = domain.firstIndex(of: ".") else {
+                break
+            }
+            domain = domain[domain.index(after: dot)...]
+        }
+        return domains[""] ?? false
+    }
+
+    func matches(_ input: PACMatchInput) -> Bool {
+        let matched: Bool
+        switch pattern {
+        case .glob(let glob):
+            matched = glob.matches(glob.matchCase ? input.bytes : input.lowercased)
+        case .regex(let regex):
+            matched = regex.firstMatch(in: input.url, range: NSRange(location: 0, length: input.url.utf16.count)) != nil
+        case .ipRange(let range):
+            matched = PACIPRange.address(input.host).map { range.contains($0) } ?? false
+        }
+        return matched && isActive(on: input.host)
+    }
+}
+
+private func trimmingTrailingDots<S: StringProtocol>(_ s: S) -> String {
+    var end = s.endIndex
+    while end > s.startIndex && s[s.index(before: end)] == "." {
+        end = s.index(before: end)
+    }
+    return String(s[..<end])
+}
+
+// An ABP pattern matched the way the regex RegExpFilter.getRegexp makes of it
+// does, byte by byte.
+private struct PACGlob {
+    enum Anchor {
+        case none
+        case start      // "|"
+        case domain     // "||"
+    }
+
+    static let star: Int16 = -1
+    static let separator: Int16 = -2
+
+    let anchor: Anchor
+    let anchoredEnd: Bool
+    let matchCase: Bool
+    // A byte, lowercased unless matchCase, or star or separator.
+    let tokens: [Int16]
+
+    init(_ source: [UInt8], matchCase: Bool) {
+        var s: [UInt8] = []
+        s.reserveCapacity(source.count)
+        // "**" is "*".
+        for c in source where !(c == UInt8(ascii: "*") && s.last == UInt8(ascii: "*")) {
+            s.append(c)
+        }
+        // "^|" at the end is "^".
+        if s.count >= 2 && s[s.count - 2] == UInt8(ascii: "^") && s[s.count - 1] == UInt8(ascii: "|") {
+            s.removeLast()
+        }
+        var body = s[...]
+        if body.starts(with: [UInt8(ascii: "|"), UInt8(ascii: "|")]) {
+            anchor = .domain
+            body = body.dropFirst(2)
+        } else if body.first == UInt8(ascii: "|") {
+            anchor = .start
+            body = body.dropFirst()
+        } else {
+            anchor = .none
+        }
+        anchoredEnd = body.last == UInt8(ascii: "|")
+        if anchoredEnd {
+            body = body.dropLast()
+        }
+        self.matchCase = matchCase
+        tokens = body.map { c -> Int16 in
+            switch c {
+            case UInt8(ascii: "*"):
+                return PACGlob.star
+            case UInt8(ascii: "^"):
+                return PACGlob.separator
+            case UInt8(ascii: "A")...UInt8(ascii: "Z") where !matchCase:
+                return Int16(c + 0x20)
+            default:
+                return Int16(c)
+            }
+        }
+    }
+
+    // The longest run of bytes, lowercased.
+    var literal: [UInt8]? {
+        var best = 0..<0
+        var start = 0
+        for i in 0...tokens.count {
+            if i == tokens.count || tokens[i] < 0 {
+                if i - start > best.count {
+                    best = start..<i
+                }
+                start = i + 1
+            }
+        }
+        guard !best.isEmpty else {
+            return nil
+        }
+        return tokens[best].map { t -> UInt8 in
+            let c = UInt8(t)
+            return c >= UInt8(ascii: "A") && c <= UInt8(ascii: "Z") ? c + 0x20 : c
+        }
+    }
+
+    func matches(_ text: [UInt8]) -> Bool {
+        switch anchor {
+        case .none:
+            return match(text, from: 0, floating: true)
+        case .start:
+            return match(text, from: 0, floating: false)
+        case .domain:
+            // `^[\w\-]+:\/+(?!\/)(?:[^\/]+\.)?`: the host start, or after a
+            // dot past it and before the next "/".
+            guard let host = PACGlob.hostStart(text) else {
+                return false
+            }
+            if match(text, from: host, floating: false) {
+                return true
+            }
+            var i = host + 1
+            while i < text.count && text[i] != UInt8(ascii: "/") {
+                if text[i] == UInt8(ascii: ".") && match(text, from: i + 1, floating: false) {
+                    return true
+                }
+                i += 1
+            }
+            return false
+        }
+    }
+
+    // Wildcard matching of tokens against text from start on, backtracking
+    // to the last star only. floating is a star before the first token, and
+    // unless anchoredEnd there is one after the last.
+    private func match(_ text: [UInt8], from start: Int, floating: Bool) -> Bool {
+        let n = text.count
+        let m = tokens.count
+        var p = 0
+        var t = start
+        var starP = floating ? 0 : -1
+        var starT = start
+        while t < n {
+            if p < m {
+                let token = tokens[p]
+                if token == PACGlob.star {
+                    p += 1
+                    starP = p
+                    starT = t
+                    continue
+                }
+                if token >= 0 ? text[t] == UInt8(token) : isSeparator(text[t]) {
+                    p += 1
+                    t += 1
+                    continue
+                }
+            } else if !anchoredEnd {
+                return true
+            }
+            if starP < 0 {
+                return false
+            }
+            starT += 1
+            t = starT
+            p = starP
+        }
+        // The separator also matches the end.
+        while p < m && tokens[p] < 0 {
+            p += 1
+        }
+        return p == m
+    }
+
+    private static func hostStart(_ text: [UInt8]) -> Int? {
+        var i = 0
+        while i < text.count && isSchemeCharacter(text[i]) {
+            i += 1
+        }
+        guard i > 0 && i < text.count && text[i] == UInt8(ascii: ":") else {
+            return nil
+        }
+        i += 1
+        guard i < text.count && text[i] == UInt8(ascii: "/") else {
+            return nil
+        }
+        while i < text.count && text[i] == UInt8(ascii: "/") {
+            i += 1
+        }
+        return i
+    }
+}
+
+// `[\x00-\x24\x26-\x2C\x2F\x3A-\x40\x5B-\x5E\x60\x7B-\x7F]`, what ABP's "^"
+// matches besides the end.
+private func isSeparator(_ c: UInt8) -> Bool {
+    switch c {
+    case 0x00...0x24, 0x26...0x2C, 0x2F, 0x3A...0x40, 0x5B...0x5E, 0x60, 0x7B...0x7F:
+        return true
+    default:
+        return false
+    }
+}
+
+private func isSchemeCharacter(_ c: UInt8) -> Bool {
+    switch c {
+    case UInt8(ascii: "a")...UInt8(ascii: "z"), UInt8(ascii: "A")...UInt8(ascii: "Z")
+        , UInt8(ascii: "0")...UInt8(ascii: "9"), UInt8(ascii: "_"), UInt8(ascii: "-"):
+        return true
+    default:
+        return false
+    }
+}
+
+// Finds every occurrence of a set of distinct byte strings in one pass over a
+// text. The trie is stored flat: the edges of state s, sorted by byte, are
+// edgeBytes and edgeTargets in edgeStart[s]..<edgeStart[s + 1]. The root has
+// a full table, as most bytes of a URL lead back to it.
+struct AhoCorasick {
+    private var rootNext = [Int32](repeating: 0, count: 256)
+    private var edgeStart: [Int32] = []
+    private var edgeBytes: [UInt8] = []
+    private var edgeTargets: [Int32] = []
+    private var fail: [Int32] = []
+    // The string ending in a state, -1 if none, and the next state on its
+    // fail chain in which one ends.
+    private var output: [Int32] = []
+    private var outputLink: [Int32] = []
+
+    init(_ strings: [[UInt8]]) {
+        var children: [[(UInt8, Int32)]] = [[]]
+        output = [-1]
+        for (index, string) in strings.enumerated() {
+            var state = 0
+            for c in string {
+                if let edge = children[state].first(where: { $0.0 == c }) {
+                    state = Int(edge.1)
+                } else {
+                    let next = Int32(children.count)
+                    children.append([])
+                    output.append(-1)
+                    children[state].append((c, next))
+                    state = Int(next)
+                }
+            }
+            output[state] = Int32(index)
+        }
+
+        edgeStart.reserveCapacity(children.count + 1)
+        for edges in children {
+            edgeStart.append(Int32(edgeBytes.count))
+            for (c, target) in edges.sorted(by: { $0.0 < $1.0 }) {
+                edgeBytes.append(c)
+                edgeTargets.append(target)
+            }
+        }
+        edgeStart.append(Int32(edgeBytes.count))
+        for (c, target) in children[0] {
+            rootNext[Int(c)] = target
+        }
+
+        // Breadth first, so the fail state of a state is done before it.
+        fail = [Int32](repeating: 0, count: children.count)
+        outputLink = [Int32](repeating: -1, count: children.count)
+        var queue = children[0].map { $0.1 }
+        var head = 0
+        while head < queue.count {
+            let state = Int(queue[head])
+            head += 1
+            for (c, target) in children[state] {
+                queue.append(target)
+                var f = Int(fail[state])
+                var next: Int32 = 0
+                while true {
+                    if let n = self.next(f, c) {
+                        next = n
+                        break
+                    }
+                    if f == 0 {
+                        break
+                    }
+                    f = Int(fail[f])
+                }
+                fail[Int(target)] = next
+                outputLink[Int(target)] = output[Int(next)] >= 0 ? next : outputLink[Int(next)]
+            }
+        }
+    }
+
+    private func next(_ state: Int, _ c: UInt8) -> Int32? {
+        if state == 0 {
+            let next = rootNext[Int(c)]
+            return next != 0 ? next : nil
+        }
+        var lo = Int(edgeStart[state])
+        var hi = Int(edgeStart[state + 1])
+        while lo < hi {
+            let mid = (lo + hi) / 2
+            if edgeBytes[mid] < c {
+                lo = mid + 1
+            } else {
+                hi = mid
+            }
+        }
+        return lo < Int(edgeStart[state + 1]) && edgeBytes[lo] == c ? edgeTargets[lo] : nil
+    }
+
+    // Calls body with the index of every string found, as it ends, until
+    // body returns false.
+    func forEachMatch(in text: [UInt8], _ body: (Int) -> Bool) {
+        var state = 0
+        for c in text {
+            while true {
+                if let n = next(state, c) {
+                    state = Int(n)
+                    break
+                }
+                if state == 0 {
+                    break
+                }
+                state = Int(fail[state])
+            }
+            var s = output[state] >= 0 ? state : Int(outputLink[state])
+            while s >= 0 {
+                if !body(Int(output[s])) {
+                    return
+                }
+                s = Int(outputLink[s])
+            }
+        }
+    }
+}
@@ -0,0 +1,163 @@
+//
+//  PACRule.swift
+//  ShadowsocksX-NG
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import Foundation
+
+// One ABP filter line of gfwlist.txt or user-rule.txt.
+struct PACRule: Hashable {
+    enum Kind: UInt8 {
+        case plain = 0      // keyword or substring, e.g. ".example.com"
+        case domainAnchor   // "||example.com"
+        case startAnchor    // "|http://example.com"
+        case regex          // "/^https?:\/\/example\.com/"
+    }
+
+    let text: String
+    let isWhitelist: Bool
+    let kind: Kind
+    // The text without its leading "@" and "|" characters, as written. A user
+    // rule with this text overrides the rule, e.g. "example.com" overrides
+    // "||example.com" and "@@||example.com".
+    let body: String
+
+    // Returns nil for empty lines, "!" comments and "[AutoProxy x.x]" headers.
+    init?<C: Collection>(line: C) where C.Element == UInt8 {
+        guard let c = line.first, c != UInt8(ascii: "!") && c != UInt8(ascii: "[") else {
+            return nil
+        }
+        self.init(text: String(decoding: line, as: UTF8.self))
+    }
+
+    init(text: String, isWhitelist: Bool, kind: Kind, body: String) {
+        self.text = text
+        self.isWhitelist = isWhitelist
+        self.kind = kind
+        self.body = body
+    }
+
+    init(text: String) {
+        self.text = text
+
+        var rest = Substring(text)
+        isWhitelist = rest.hasPrefix("@@")
+        if isWhitelist {
+            rest = rest.dropFirst(2)
+        }
+        if rest.hasPrefix("||") {
+            kind = .domainAnchor
+        } else if rest.hasPrefix("|") {
+            kind = .startAnchor
+        } else if rest.count >= 2 && rest.hasPrefix("/") && (rest.hasSuffix("/") || rest.contains("/$")) {
+            kind = .regex
+        } else {
+            kind = .plain
+        }
+        body = String(text.drop { $0 == "@" || $0 == "|" })
+    }
+}
+
+// The merged user-rule.txt and gfwlist.txt rules in PAC order: user rules
+// first, then the gfwlist rules not overridden by them.
+//
+// A gfwlist rule is overridden by a user-rule.txt line equal to its body,
+// the way GeneratePACFile() always filtered them. Rules and user lines are
+// indexed by text, so deduplication and override lookups are O(1) per rule.
+// Every gfwlist rule dropped while merging is recorded in the report.
+struct PACRuleSet {
+    struct Override: Equatable {
+        let rule: String
+        let userRule: String
+    }
+
+    struct Report {
+        // Rules whose exact text was already in the set.
+        var duplicated: [String] = []
+        // gfwlist rules hidden by a user rule of the same polarity, e.g.
+        // "||example.com" by "example.com".
+        var shadowed: [Override] = []
+        // gfwlist rules hidden by a user rule of the opposite polarity, e.g.
+        // "@@||example.com" by "example.com".
+        var conflicting: [Override] = []
+
+        var summary: String {
+            return "\(duplicated.count) duplicated, \(shadowed.count) shadowed, \(conflicting.count) conflicting"
+        }
+    }
+
+    private(set) var rules: [PACRule] = []
+    private(set) var report = Report()
+    private(set) var userRuleCount = 0
+
+    private var texts = Set<String>()
+    // Every user-rule.txt line as written, comments included.
+    private var userLines = Set<String>()
+
+    init() {
+    }
+
+    // A set holding only the user rules, for gfwlist rules streamed in later
+    // with addGFWListLine.
+    init(userRules: Data?) {
+        if let userRules = userRules {
+            forEachLine([UInt8](userRules)) { line in
+                if let rule = PACRule(line: line) {
+                    addUserRule(rule)
+                } else {
+                    userLines.insert(String(decoding: line, as: UTF8.self))
+                }
+            }
+        }
+    }
+
+    // Decodes the base64 gfwlist and merges it under the user rules.
+    // Returns nil if gfwlist is not valid base64.
+    init?(gfwlist: Data, userRules: Data?) {
+        guard let decoded = decodeBase64(gfwlist) else {
+            return nil
+        }
+        self.init(userRules: userRules)
+        forEachLine(decoded) { line in
+            addGFWListLine(line)
+        }
+    }
+
+    mutating func addGFWListLine<C: Collection>(_ line: C) where C.Element == UInt8 {
+        if let rule = PACRule(line: line) {
+            addGFWListRule(rule)
+        }
+    }
+
+    mutating func addUserRule(_ rule: PACRule) {
+        guard texts.insert(rule.text).inserted else {
+            report.duplicated.append(rule.text)
+            return
+        }
+        userLines.insert(rule.text)
+        rules.append(rule)
+        userRuleCount += 1
+    }
+
+    mutating func addGFWListRule(_ rule: PACRule) {
+        if texts.contains(rule.text) {
+            report.duplicated.append(rule.text)
+            return
+        }
+        if userLines.contains(rule.body) {
+            // The body has no leading "@", so the user rule is never a whitelist rule.
+            let override = Override(rule: rule.text, userRule: rule.body)
+            if rule.isWhitelist {
+                report.conflicting.append(override)
+            } else {
+                report.shadowed.append(override)
+            }
+            return
+        }
+        texts.insert(rule.text)
+        rules.append(rule)
+    }
+}
@@ -0,0 +1,484 @@
+//
+//  PACRuleLowering.swift
+//  ShadowsocksX-NG
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import Foundation
+
+// Rewrites the filters abp.js tests on every lookup into ones it finds by
+// keyword, or into as few of them as possible.
+//
+// CombinedMatcher only tests a filter if the URL has the filter's keyword, a
+// run of [a-z0-9%]{3,} in its text between two other characters. Regexes and
+// rules like "example.com" have none, so every lookup tests each of them.
+// They are rewritten only into rules which match the same URLs:
+//
+// - A regex of literals, "?", groups of alternatives, ".*", "^" and "$" is
+//   expanded into ABP rules, e.g. /twimg\.edgesuite\.net\/\/?appledaily/ into
+//   "twimg.edgesuite.net/appledaily" and "twimg.edgesuite.net//appledaily".
+//   A leading ^https?:\/\/([^\/]+\.)* is kept: "||" would also match the
+//   domain under any other scheme, e.g. ftp:// and wss://.
+// - The keywordless literal rules of each polarity are merged into a single
+//   regex of their prefix trie, so a lookup tests one filter instead of
+//   hundreds. Both are unanchored substring matches ignoring case.
+//
+// The slow filters left are listed in the report with their estimated cost.
+struct PACRuleLowering {
+    // What a lookup of a typical URL costs per slow filter: the positions of
+    // the URL its regex is tried at.
+    static let typicalURLLength = 80
+    // A regex expanding into more rules than this is kept, as the rules
+    // would all share one keyword and be tested together anyway.
+    static let maxExpansion = 16
+
+    struct Lowering: Equatable {
+        let rule: String
+        let to: [String]
+    }
+
+    struct SlowFilter: Equatable {
+        let rule: String
+        let reason: String
+        let cost: Int
+    }
+
+    struct Report {
+        var slowBefore = 0
+        var costBefore = 0
+        var lowered: [Lowering] = []
+        // Keywordless literal rules merged into a regex.
+        var merged = 0
+        // The slow filters left, costliest first.
+        var slow: [SlowFilter] = []
+
+        var costAfter: Int {
+            return slow.reduce(0) { $0 + $1.cost }
+        }
+
+        var summary: String {
+            return "\(slowBefore) -> \(slow.count) slow filters, \(lowered.count) regexes lowered"
+                + ", \(merged) literals merged, ~\(costBefore) -> ~\(costAfter) positions tried per lookup"
+        }
+
+        // The report written next to gfwlist.js.
+        var text: String {
+            var lines = [
+                "! Filters gfwlist.js tests on every lookup, as they have no keyword.",
+                "! \(summary)",
+                "! Cost: positions of a \(PACRuleLowering.typicalURLLength) character URL the filter is tried at.",
+                "!",
+            ]
+            for lowering in lowered {
+                lines.append("! lowered \(lowering.rule) -> \(lowering.to.joined(separator: " "))")
+            }
+            lines.append("!")
+            lines.append("! cost\treason\trule")
+            for filter in slow {
+                lines.append("\(filter.cost)\t\(filter.reason)\t\(filter.rule)")
+            }
+            return lines.joined(separator: "\n") + "\n"
+        }
+    }
+
+    private(set) var rules: [PACRule] = []
+    private(set) var report = Report()
+
+    init(rules: [PACRule]) {
+        var literals: [[PACRule]] = [[], []]
+        var slow: [SlowFilter] = []
+
+        for rule in rules {
+            if hasKeyword(rule) {
+                self.rules.append(rule)
+                continue
+            }
+            report.slowBefore += 1
+            report.costBefore += cost(of: rule)
+
+            if rule.kind == .regex {
+                switch lower(regex: rule) {
+                case .lowered(let texts):
+                    report.lowered.append(Lowering(rule: rule.text, to: texts))
+                    for text in texts {
+                        let lowered = PACRule(text: text)
+                        if hasKeyword(lowered) {
+                            self.rules.append(lowered)
+                        } else if isMergeable(lowered) {
+                            literals[lowered.isWhitelist ? 1 : 0].append(lowered)
+                        } else {
+                            self.rules.append(lowered)
+                            slow.append(SlowFilter(rule: text, reason: "no keyword", cost: cost(of: lowered)))
+                        }
+                    }
+                case .kept(let reason):
+                    self.rules.append(rule)
+                    slow.append(SlowFilter(rule: rule.text, reason: reason, cost: cost(of: rule)))
+                }
+                continue
+            }
+            if isMergeable(rule) {
+                literals[rule.isWhitelist ? 1 : 0].append(rule)
+                continue
+            }
+            self.rules.append(rule)
+            slow.append(SlowFilter(rule: rule.text, reason: "no keyword", cost: cost(of: rule)))
+        }
+
+        for group in literals where !group.isEmpty {
+            if group.count == 1 {
+                self.rules.append(group[0])
+                slow.append(SlowFilter(rule: group[0].text, reason: "no keyword", cost: cost(of: group[0])))
+                continue
+            }
+            let merged = mergedRegex(group)
+            self.rules.append(merged)
+            report.merged += group.count
+            slow.append(SlowFilter(rule: merged.text, reason: "\(group.count) literals merged"
+                , cost: cost(of: merged)))
+        }
+
+        // A stable sort, so equal costs keep the rule order.
+        report.slow = slow.enumerated().sorted {
+            $0.element.cost != $1.element.cost ? $0.element.cost > $1.element.cost : $0.offset < $1.offset
+        }.map { $0.element }
+    }
+}
+
+private func isWordCharacter(_ c: UInt8) -> Bool {
+    return (c >= UInt8(ascii: "a") && c <= UInt8(ascii: "z")) || (c >= UInt8(ascii: "A") && c <= UInt8(ascii: "Z"))
+        || (c >= UInt8(ascii: "0") && c <= UInt8(ascii: "9")) || c == UInt8(ascii: "_")
+}
+
+private func isKeywordCharacter(_ c: UInt8) -> Bool {
+    return (c >= UInt8(ascii: "a") && c <= UInt8(ascii: "z")) || (c >= UInt8(ascii: "0") && c <= UInt8(ascii: "9"))
+        || c == UInt8(ascii: "%")
+}
+
+// Whether Matcher.findKeyword finds one, i.e. the lowercased text without
+// "@@" and options has a match of /[^a-z0-9%*][a-z0-9%]{3,}(?=[^a-z0-9%*])/.
+private func hasKeyword(_ rule: PACRule) -> Bool {
+    if rule.kind == .regex {
+        return false
+    }
+    var text = Array(rule.text.lowercased().utf8)[...]
+    if rule.isWhitelist {
+        text = text.dropFirst(2)
+    }
+    if let dollar = text.lastIndex(of: UInt8(ascii: "$")) {
+        text = text[..<dollar]
+    }
+    var run = 0
+    var bounded = false
+    for c in text {
+        if isKeywordCharacter(c) {
+            run += 1
+            continue
+        }
+        if bounded && run >= 3 && c != UInt8(ascii: "*") {
+            return true
+        }
+        bounded = c != UInt8(ascii: "*")
+        run = 0
+    }
+    return false
+}
+
+// Positions of a typical URL the filter's regex is tried at: one if it is
+// anchored at the start of the URL, every one otherwise.
+private func cost(of rule: PACRule) -> Int {
+    switch rule.kind {
+    case .domainAnchor, .startAnchor:
+        return 1
+    case .regex:
+        let source = rule.text.dropFirst(rule.isWhitelist ? 3 : 1)
+        return source.hasPrefix("^") ? 1 : PACRuleLowering.typicalURLLength
+    case .plain:
+        return PACRuleLowering.typicalURLLength
+    }
+}
+
+// A plain rule matching its text literally, as a substring and ignoring case.
+// "*", "^" and "|" have a meaning in ABP, "$" starts options, "#" element
+// hiding rules and whitespace is removed.
+private func isMergeable(_ rule: PACRule) -> Bool {
+    guard rule.kind == .plain else {
+        return false
+    }
+    let text = rule.text.utf8.dropFirst(rule.isWhitelist ? 2 : 0)
+    return !text.isEmpty && text.allSatisfy {
+        $0 > 0x20 && $0 < 0x7F && $0 != UInt8(ascii: "*") && $0 != UInt8(ascii: "^") && $0 != UInt8(ascii: "|")
+            && $0 != UInt8(ascii: "$") && $0 != UInt8(ascii: "#")
+    }
+}
+
+// One regex rule matching the URLs any of the literal rules matches. Once a
+// literal ends, the longer ones it is a prefix of are matched by it already,
+// so the trie is cut there.
+private func mergedRegex(_ rules: [PACRule]) -> PACRule {
+    var children: [[UInt8: Int]] = [[:]]
+    var terminal = [false]
+    for rule in rules {
+        var node = 0
+        for c in rule.text.lowercased().utf8.dropFirst(rule.isWhitelist ? 2 : 0) {
+            if terminal[node] {
+                break
+            }
+            if let next = children[node][c] {
+                node = next
+            } else {
+                children.append([:])
+                terminal.append(false)
+                children[node][c] = children.count - 1
+                node = children.count - 1
+            }
+        }
+        terminal[node] = true
+        children[node] = [:]
+    }
+
+    var source = [UInt8]()
+    func emit(_ node: Int) {
+        if terminal[node] {
+            return
+        }
+        let edges = children[node].sorted { $0.key < $1.key }
+        if edges.count > 1 {
+            source.append(contentsOf: "(?:".utf8)
+        }
+        for (i, (c, next)) in edges.enumerated() {
+            if i > 0 {
+                source.append(UInt8(ascii: "|"))
+            }
+            if !isWordCharacter(c) {
+                source.append(UInt8(ascii: "\\"))
+            }
+            source.append(c)
+            emit(next)
+        }
+        if edges.count > 1 {
+            source.append(UInt8(ascii: ")"))
+        }
+    }
+    emit(0)
+    let prefix = rules[0].isWhitelist ? "@@/" : "/"
+    return PACRule(text: prefix + String(decoding: source, as: UTF8.self) + "/")
+}
+
+// MARK: - Regex lowering
+
+private enum Outcome {
+    case lowered([String])
+    case kept(String)
+}
+
+private enum Piece {
+    case literal(UInt8)
+    // ".*"
+    case star
+    case alternatives([[Piece]])
+}
+
+private struct Failure: Error {
+    let reason: String
+}
+
+private func lower(regex rule: PACRule) -> Outcome {
+    let text = Array(rule.text.utf8)
+    let start = rule.isWhitelist ? 3 : 1
+    guard text.count > start, text.last == UInt8(ascii: "/") else {
+        return .kept("has options")
+    }
+    var source = text[start..<(text.count - 1)]
+
+    var anchor = ""
+    if source.first == UInt8(ascii: "^") {
+        source = source.dropFirst()
+        anchor = "|"
+    }
+    var end = ""
+    if source.last == UInt8(ascii: "$") && (source.count < 2 || source[source.endIndex - 2] != UInt8(ascii: "\\")) {
+        source = source.dropLast()
+        end = "|"
+    }
+
+    var parser = RegexParser(source: source)
+    let pieces: [Piece]
+    let variants: [[Piece]]
+    do {
+        pieces = try parser.parse()
+        variants = try expand(pieces)
+    } catch let failure as Failure {
+        return .kept(failure.reason)
+    } catch {
+        return .kept("\(error)")
+    }
+
+    var texts: [String] = []
+    for var variant in variants {
+        // ".*" next to an unanchored end matches nothing more.
+        if end.isEmpty {
+            while case .star? = variant.last {
+                variant.removeLast()
+            }
+        }
+        if anchor.isEmpty {
+            while case .star? = variant.first {
+                variant.removeFirst()
+            }
+        }
+        var body = [UInt8]()
+        for piece in variant {
+            switch piece {
+            case .literal(let c):
+                guard c > 0x20 && c < 0x7F && c != UInt8(ascii: "*") && c != UInt8(ascii: "^")
+                    && c != UInt8(ascii: "|") && c != UInt8(ascii: "$") && c != UInt8(ascii: "#") else {
+                    return .kept("'\(Character(Unicode.Scalar(c)))' has no ABP equivalent")
+                }
+                body.append(c)
+            case .star:
+                body.append(UInt8(ascii: "*"))
+            case .alternatives:
+                // expand leaves none.
+                return .kept("alternatives")
+            }
+        }
+        guard !body.isEmpty else {
+            return .kept("matches every URL")
+        }
+        let text = (rule.isWhitelist ? "@@" : "") + anchor + String(decoding: body, as: UTF8.self) + end
+        guard !text.hasPrefix("!") else {
+            return .kept("would be read as a comment")
+        }
+        let lowered = PACRule(text: text)
+        guard lowered.kind != .regex && lowered.isWhitelist == rule.isWhitelist else {
+            return .kept("would be read back differently")
+        }
+        if !texts.contains(text) {
+            texts.append(text)
+        }
+    }
+    return .lowered(texts)
+}
+
+// Every sequence of literals and ".*" the pieces match, at most
+// maxExpansion of them.
+private func expand(_ pieces: [Piece]) throws -> [[Piece]] {
+    var variants: [[Piece]] = [[]]
+    for piece in pieces {
+        switch piece {
+        case .literal, .star:
+            for i in variants.indices {
+                variants[i].append(piece)
+            }
+        case .alternatives(let alternatives):
+            var next: [[Piece]] = []
+            for alternative in alternatives {
+                for tail in try expand(alternative) {
+                    for head in variants {
+                        next.append(head + tail)
+                    }
+                }
+            }
+            guard next.count <= PACRuleLowering.maxExpansion else {
+                throw Failure(reason: "expands to more than \(PACRuleLowering.maxExpansion) rules")
+            }
+            variants = next
+        }
+    }
+    return variants
+}
+
+// Parses the subset of JavaScript regex syntax which ABP rules can express.
+private struct RegexParser {
+    let source: ArraySlice<UInt8>
+    var i: Int
+
+    init(source: ArraySlice<UInt8>) {
+        self.source = source
+        self.i = source.startIndex
+    }
+
+    mutating func parse() throws -> [Piece] {
+        let pieces = try sequence()
+        if i < source.endIndex {
+            throw Failure(reason: source[i] == UInt8(ascii: "|") ? "alternatives outside a group"
+                : "unbalanced ')'")
+        }
+        return pieces
+    }
+
+    private var next: UInt8? {
+        return i < source.endIndex ? source[i] : nil
+    }
+
+    private mutating func sequence() throws -> [Piece] {
+        var pieces: [Piece] = []
+        while let c = next, c != UInt8(ascii: "|") && c != UInt8(ascii: ")") {
+            i += 1
+            var piece: Piece
+            switch c {
+            case UInt8(ascii: "\\"):
+                guard let escaped = next, !isWordCharacter(escaped) else {
+                    throw Failure(reason: "character class escape")
+                }
+                i += 1
+                piece = .literal(escaped)
+            case UInt8(ascii: "."):
+                guard next == UInt8(ascii: "*") else {
+                    throw Failure(reason: "'.' matches any character")
+                }
+                i += 1
+                pieces.append(.star)
+                continue
+            case UInt8(ascii: "("):
+                if next == UInt8(ascii: "?") {
+                    guard i + 1 < source.endIndex && source[i + 1] == UInt8(ascii: ":") else {
+                        throw Failure(reason: "lookaround")
+                    }
+                    i += 2
+                }
+                var alternatives = [try sequence()]
+                while next == UInt8(ascii: "|") {
+                    i += 1
+                    alternatives.append(try sequence())
+                }
+                guard next == UInt8(ascii: ")") else {
+                    throw Failure(reason: "unbalanced '('")
+                }
+                i += 1
+                piece = .alternatives(alternatives)
+            case UInt8(ascii: "["):
+                throw Failure(reason: "character class")
+            case UInt8(ascii: "^"), UInt8(ascii: "$"):
+                throw Failure(reason: "anchor inside the regex")
+            case UInt8(ascii: "*"), UInt8(ascii: "+"), UInt8(ascii: "?"), UInt8(ascii: "{"):
+                throw Failure(reason: "repetition")
+            default:
+                // A quantifier would apply to the last byte of a multi-byte
+                // character only.
+                guard c < 0x80 else {
+                    throw Failure(reason: "non-ASCII character")
+                }
+                piece = .literal(c)
+            }
+            switch next {
+            case UInt8(ascii: "?")?:
+                i += 1
+                piece = .alternatives([[piece], []])
+            case UInt8(ascii: "*")?, UInt8(ascii: "+")?, UInt8(ascii: "{")?:
+                throw Failure(reason: "repetition")
+            default:
+                break
+            }
+            if case .alternatives(let alternatives) = piece, alternatives.count == 1 {
+                pieces.append(contentsOf: alternatives[0])
+            } else {
+                pieces.append(piece)
+            }
+        }
+        return pieces
+    }
+}
@@ -0,0 +1,315 @@
+//
+//  PACRuleOptimizer.swift
+//  ShadowsocksX-NG
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import Foundation
+
+// Drops the rules which provably never change what FindProxyForURL returns.
+//
+// abp.js answers DIRECT if any whitelist rule matches and PROXY if any other
+// rule does, so a rule is redundant when a rule of the same polarity matches
+// every URL it matches. Of the rules which match the same URLs only the first
+// is kept, and a rule covered by a broader one is dropped:
+//
+// - "||example.com" covers "||b.example.com", "||example.com.hk" and
+//   "|https://b.example.com/path", as ABP does not anchor its end.
+// - "|http://example.com" covers "|http://example.com/path".
+// - The keyword "example" covers every rule with "example" in its literal
+//   text, e.g. "||example.org" and ".example.net/a*b".
+//
+// Only lowercase ASCII rules without options are touched. Regexes, IP ranges,
+// element hiding rules and rules abp.js would normalize are left alone.
+struct PACRuleOptimizer {
+    struct Drop: Equatable {
+        let rule: String
+        let by: String
+    }
+
+    struct Report {
+        var rulesBefore = 0
+        // Rules matching the same URLs as an earlier one.
+        var merged: [Drop] = []
+        // Rules covered by a broader one.
+        var subsumed: [Drop] = []
+
+        var rulesAfter: Int {
+            return rulesBefore - merged.count - subsumed.count
+        }
+
+        var summary: String {
+            return "\(rulesBefore) -> \(rulesAfter) rules, \(merged.count) merged, \(subsumed.count) subsumed"
+        }
+    }
+
+    private(set) var rules: [PACRule] = []
+    private(set) var report = Report()
+
+    init(rules: [PACRule]) {
+        report.rulesBefore = rules.count
+
+        var patterns: [Pattern?] = []
+        patterns.reserveCapacity(rules.count)
+        var kept: [Int] = []
+        var seen = [[UInt8]: String]()
+        for rule in rules {
+            guard let pattern = Pattern(rule: rule) else {
+                patterns.append(nil)
+                kept.append(patterns.count - 1)
+                continue
+            }
+            if let first = seen[pattern.key] {
+                report.merged.append(Drop(rule: rule.text, by: first))
+                patterns.append(nil)
+                continue
+            }
+            seen[pattern.key] = rule.text
+            patterns.append(pattern)
+            kept.append(patterns.count - 1)
+        }
+
+        var covers = [Covers(), Covers()]
+        for case let pattern? in patterns {
+            covers[pattern.isWhitelist ? 1 : 0].add(pattern)
+        }
+        covers[0].finish()
+        covers[1].finish()
+
+        for i in kept {
+            if let pattern = patterns[i], let by = covers[pattern.isWhitelist ? 1 : 0].cover(of: pattern) {
+                report.subsumed.append(Drop(rule: rules[i].text, by: by))
+                continue
+            }
+            self.rules.append(rules[i])
+        }
+    }
+}
+
+private let star = UInt8(ascii: "*")
+private let caret = UInt8(ascii: "^")
+private let bar = UInt8(ascii: "|")
+private let dot = UInt8(ascii: ".")
+private let slash = UInt8(ascii: "/")
+
+private func isSpecial(_ c: UInt8) -> Bool {
+    return c == star || c == caret || c == bar
+}
+
+// A rule as ABP matches it: its anchor and the literal runs between its
+// wildcards, which every URL it matches contains as they are.
+private struct Pattern {
+    let text: String
+    let isWhitelist: Bool
+    // Kind, polarity and the normalized body. Equal keys match the same URLs.
+    let key: [UInt8]
+    let runs: [ArraySlice<UInt8>]
+    // Set if the rule is only a literal, it then covers other rules.
+    var keyword: ArraySlice<UInt8>? = nil
+    var domain: ArraySlice<UInt8>? = nil
+    var prefix: ArraySlice<UInt8>? = nil
+    // What a URL it matches has at the start of its host and at its start.
+    var host: ArraySlice<UInt8>? = nil
+    var start: ArraySlice<UInt8>? = nil
+
+    init?(rule: PACRule) {
+        // IP ranges are not substring rules, see PACDomainTables.
+        if rule.kind == .regex || PACIPRange(rule: rule) != nil {
+            return nil
+        }
+        var bytes = Array(rule.text.utf8)
+        for (i, c) in bytes.enumerated() {
+            // Whitespace is removed by abp.js, "$" starts options and "#"
+            // element hiding rules.
+            guard c > 0x20 && c < 0x7F && c != UInt8(ascii: "$") && c != UInt8(ascii: "#") else {
+                return nil
+            }
+            if c >= UInt8(ascii: "A") && c <= UInt8(ascii: "Z") {
+                bytes[i] = c + 0x20
+            }
+        }
+        text = rule.text
+        isWhitelist = rule.isWhitelist
+
+        var body = bytes[...]
+        if isWhitelist {
+            body = body.dropFirst(2)
+        }
+        switch rule.kind {
+        case .domainAnchor:
+            body = body.dropFirst(2)
+        case .startAnchor:
+            body = body.dropFirst()
+        case .plain, .regex:
+            break
+        }
+        // "**" is "*", and a "*" at either end matches nothing more.
+        var normalized = [UInt8]()
+        normalized.reserveCapacity(body.count)
+        for c in body where !(c == star && normalized.last == star) {
+            normalized.append(c)
+        }
+        while normalized.last == star {
+            normalized.removeLast()
+        }
+        if rule.kind == .plain && normalized.first == star {
+            normalized.removeFirst()
+        }
+        guard let first = normalized.first, first != bar else {
+            return nil
+        }
+
+        key = [rule.kind.rawValue, isWhitelist ? 1 : 0] + normalized
+        let literal = normalized[...]
+        runs = literal.split(whereSeparator: isSpecial)
+        let isLiteral = !literal.contains(where: isSpecial)
+        let head = literal.prefix { !isSpecial($0) }
+
+        switch rule.kind {
+        case .plain:
+            if isLiteral {
+                keyword = literal
+            }
+        case .domainAnchor:
+            if isLiteral {
+                domain = literal
+            }
+            if !head.isEmpty {
+                host = head
+            }
+        case .startAnchor:
+            if isLiteral {
+                prefix = literal
+            }
+            if !head.isEmpty {
+                start = head
+                host = hostPart(of: head)
+            }
+        case .regex:
+            break
+        }
+    }
+}
+
+// The part after "scheme://" as the domain anchor regex of ABP matches it,
+// `^[\w\-]+:\/+(?!\/)`.
+private func hostPart(of url: ArraySlice<UInt8>) -> ArraySlice<UInt8>? {
+    guard let colon = url.firstIndex(of: UInt8(ascii: ":")), colon > url.startIndex,
+        url[..<colon].allSatisfy({ isWordCharacter($0) || $0 == UInt8(ascii: "-") }) else {
+        return nil
+    }
+    let rest = url[(colon + 1)...]
+    guard rest.starts(with: [slash, slash]) else {
+        return nil
+    }
+    let host = rest.dropFirst(2)
+    guard let first = host.first, first != slash else {
+        return nil
+    }
+    return host
+}
+
+private func isWordCharacter(_ c: UInt8) -> Bool {
+    return (c >= UInt8(ascii: "a") && c <= UInt8(ascii: "z")) || (c >= UInt8(ascii: "0") && c <= UInt8(ascii: "9"))
+        || c == UInt8(ascii: "_")
+}
+
+// The literal rules of one polarity, indexed to find one covering a rule.
+private struct Covers {
+    // Sorted and prefix-free, with the rule each comes from.
+    private var domains: [(ArraySlice<UInt8>, String)] = []
+    private var prefixes: [(ArraySlice<UInt8>, String)] = []
+    private var keywords = [ArraySlice<UInt8>: String]()
+    private var keywordLengths: [Int] = []
+
+    mutating func add(_ pattern: Pattern) {
+        if let domain = pattern.domain {
+            domains.append((domain, pattern.text))
+        }
+        if let prefix = pattern.prefix {
+            prefixes.append((prefix, pattern.text))
+        }
+        if let keyword = pattern.keyword {
+            keywords[keyword] = pattern.text
+        }
+    }
+
+    mutating func finish() {
+        domains = prefixFree(domains)
+        prefixes = prefixFree(prefixes)
+        keywordLengths = Set(keywords.keys.map { $0.count }).sorted()
+    }
+
+    // The text of a rule other than pattern which matches every URL it does.
+    func cover(of pattern: Pattern) -> String? {
+        for run in pattern.runs {
+            for length in keywordLengths {
+                if length > run.count {
+                    break
+                }
+                var i = run.startIndex
+                while i + length <= run.endIndex {
+                    let window = run[i..<(i + length)]
+                    if let by = keywords[window], !(pattern.keyword != nil && length == run.count) {
+                        return by
+                    }
+                    i += 1
+                }
+            }
+        }
+        if let host = pattern.host {
+            // The host start, then after each dot. ABP matches the domain
+            // after `(?:[^\/]+\.)?`, so never past a "/".
+            if let (domain, by) = entry(in: domains, prefixOf: host), domain != pattern.domain {
+                return by
+            }
+            for i in host.indices where host[i] == dot && i > host.startIndex {
+                if host[..<i].contains(slash) {
+                    break
+                }
+                if let (_, by) = entry(in: domains, prefixOf: host[(i + 1)...]) {
+                    return by
+                }
+            }
+        }
+        if let start = pattern.start {
+            if let (prefix, by) = entry(in: prefixes, prefixOf: start), prefix != pattern.prefix {
+                return by
+            }
+        }
+        return nil
+    }
+}
+
+private func prefixFree(_ entries: [(ArraySlice<UInt8>, String)]) -> [(ArraySlice<UInt8>, String)] {
+    var result: [(ArraySlice<UInt8>, String)] = []
+    for entry in entries.sorted(by: { $0.0.lexicographicallyPrecedes($1.0) }) {
+        if let last = result.last, entry.0.starts(with: last.0) {
+            continue
+        }
+        result.append(entry)
+    }
+    return result
+}
+
+// In a sorted prefix-free array, only the greatest entry not after s can be a
+// prefix of s.
+private func entry(in sorted: [(ArraySlice<UInt8>, String)], prefixOf s: ArraySlice<UInt8>)
+    -> (ArraySlice<UInt8>, String)? {
+    var lo = 0
+    var hi = sorted.count
+    while lo < hi {
+        let mid = (lo + hi) / 2
+        if s.lexicographicallyPrecedes(sorted[mid].0) {
+            hi = mid
+        } else {
+            lo = mid + 1
+        }
+    }
+    guard lo > 0 && s.starts(with: sorted[lo - 1].0) else {
+        return nil
+    }
+    return sorted[lo - 1]
+}
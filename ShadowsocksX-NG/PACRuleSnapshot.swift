@@ -0,0 +1,180 @@
+//
+//  PACRuleSnapshot.swift
+//  ShadowsocksX-NG
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import Foundation
+
+// The merged rule set and the rendered PAC body, cached in
+// ~/.ShadowsocksX-NG/gfwlist.snapshot so that a change of the SOCKS5 address
+// or port only re-renders the PAC header.
+//
+// The snapshot is keyed by a SHA1 over everything the rules and the body are
+// derived from: gfwlist.txt, user-rule.txt, abp.js and the compiler options.
+//
+// Layout, integers little endian:
+//
+//     "SSXS"  u32 version  [20] key
+//     u32 rule count, then per rule:
+//         u8 kind | 0x80 if whitelist, u32 length, text, u32 length, body
+//     u32 body length (0xFFFFFFFF if none), body
+struct PACRuleSnapshot {
+    static let version: UInt32 = 3  // 3: bodies are the text as written without leading "@" and "|"
+    private static let magic: [UInt8] = Array("SSXS".utf8)
+    private static let noBody = UInt32.max
+
+    let key: [UInt8]
+    let rules: [PACRule]
+    // The PAC from the first rules placeholder on, see PACCompiler.renderBody.
+    let body: Data?
+
+    static func key(gfwlist: Data, userRules: Data?, template: Data, options: [String]) -> [UInt8] {
+        var ctx = CC_SHA1_CTX()
+        CC_SHA1_Init(&ctx)
+        var version = PACRuleSnapshot.version.littleEndian
+        CC_SHA1_Update(&ctx, &version, CC_LONG(MemoryLayout<UInt32>.size))
+        for part in [gfwlist, userRules ?? Data(), template, Data(options.joined(separator: ",").utf8)] {
+            var length = UInt64(part.count).littleEndian
+            CC_SHA1_Update(&ctx, &length, CC_LONG(MemoryLayout<UInt64>.size))
+            part.withUnsafeBytes { (raw: UnsafeRawBufferPointer) -> Void in
+                CC_SHA1_Update(&ctx, raw.baseAddress, CC_LONG(raw.count))
+            }
+        }
+        var digest = [UInt8](repeating: 0, count: Int(CC_SHA1_DIGEST_LENGTH))
+        CC_SHA1_Final(&digest, &ctx)
+        return digest
+    }
+
+    init(key: [UInt8], rules: [PACRule], body: Data?) {
+        self.key = key
+        self.rules = rules
+        self.body = body
+    }
+
+    // Maps the snapshot file and returns nil unless it is intact and was
+    // built for `key`.
+    init?(contentsOfFile path: String, key: [UInt8]) {
+        guard let data = try? Data(contentsOf: URL(fileURLWithPath: path), options: .alwaysMapped) else {
+            return nil
+        }
+        var reader = SnapshotReader(data: data)
+        guard reader.read(count: 4) == PACRuleSnapshot.magic,
+            reader.readUInt32() == PACRuleSnapshot.version,
+            reader.read(count: key.count) == key,
+            let ruleCount = reader.readUInt32() else {
+            return nil
+        }
+
+        var rules: [PACRule] = []
+        rules.reserveCapacity(Int(ruleCount))
+        for _ in 0..<ruleCount {
+            guard let flags = reader.readUInt8(),
+                let kind = PACRule.Kind(rawValue: flags & 0x7F),
+                let text = reader.readString(),
+                let body = reader.readString() else {
+                return nil
+            }
+            rules.append(PACRule(text: text, isWhitelist: flags & 0x80 != 0, kind: kind, body: body))
+        }
+
+        guard let bodyLength = reader.readUInt32() else {
+            return nil
+        }
+        var body: Data? = nil
+        if bodyLength != PACRuleSnapshot.noBody {
+            // A slice of the mapped file, not a copy.
+            guard let range = reader.range(count: Int(bodyLength)) else {
+                return nil
+            }
+            body = data[range]
+        }
+        guard reader.isAtEnd else {
+            return nil
+        }
+
+        self.key = key
+        self.rules = rules
+        self.body = body
+    }
+
+    func write(toFile path: String) throws {
+        var out = [UInt8]()
+        out.reserveCapacity(64 + rules.count * 48 + (body?.count ?? 0))
+        out.append(contentsOf: PACRuleSnapshot.magic)
+        appendUInt32(PACRuleSnapshot.version, to: &out)
+        out.append(contentsOf: key)
+        appendUInt32(UInt32(rules.count), to: &out)
+        for rule in rules {
+            out.append(rule.kind.rawValue | (rule.isWhitelist ? 0x80 : 0))
+            appendUInt32(UInt32(rule.text.utf8.count), to: &out)
+            out.append(contentsOf: rule.text.utf8)
+            appendUInt32(UInt32(rule.body.utf8.count), to: &out)
+            out.append(contentsOf: rule.body.utf8)
+        }
+        if let body = body {
+            appendUInt32(UInt32(body.count), to: &out)
+            out.append(contentsOf: body)
+        } else {
+            appendUInt32(PACRuleSnapshot.noBody, to: &out)
+        }
+        try Data(out).write(to: URL(fileURLWithPath: path), options: .atomic)
+    }
+}
+
+private func appendUInt32(_ v: UInt32, to out: inout [UInt8]) {
+    out.append(UInt8(truncatingIfNeeded: v))
+    out.append(UInt8(truncatingIfNeeded: v >> 8))
+    out.append(UInt8(truncatingIfNeeded: v >> 16))
+    out.append(UInt8(truncatingIfNeeded: v >> 24))
+}
+
+private struct SnapshotReader {
+    let data: Data
+    var offset: Int
+
+    init(data: Data) {
+        self.data = data
+        self.offset = data.startIndex
+    }
+
+    var isAtEnd: Bool {
+        return offset == data.endIndex
+    }
+
+    mutating func range(count: Int) -> Range<Int>? {
+        guard count >= 0 && data.endIndex - offset >= count else {
+            return nil
+        }
+        defer { offset += count }
+        return offset..<(offset + count)
+    }
+
+    mutating func read(count: Int) -> [UInt8]? {
+        return range(count: count).map { [UInt8](data[$0]) }
+    }
+
+    mutating func readUInt8() -> UInt8? {
+        return range(count: 1).map { data[$0.lowerBound] }
+    }
+
+    mutating func readUInt32() -> UInt32? {
+        guard let r = range(count: 4) else {
+            return nil
+        }
+        var v: UInt32 = 0
+        for (i, b) in data[r].enumerated() {
+            v |= UInt32(b) << (8 * UInt32(i))
+        }
+        return v
+    }
+
+    mutating func readString() -> String? {
+        guard let length = readUInt32(), let r = range(count: Int(length)) else {
+            return nil
+        }
+        return String(decoding: data[r], as: UTF8.self)
+    }
+}
@@ -0,0 +1,124 @@
+//
+//  PACRuleSource.swift
+//  ShadowsocksX-NG
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import Foundation
+
+let PACRuleSourcesDirPath = PACRulesDirPath + "sources/"
+
+// One ABP list the PAC rules are merged from: the gfwlist, or one of the
+// extra subscriptions in the "PAC.RuleSources" user default, e.g. a list of
+// company domains or of CDN hosts.
+//
+// Every list is downloaded, parsed and cached on its own. Its parsed rules
+// are kept in a PACRuleSnapshot under ~/.ShadowsocksX-NG/sources/, keyed by
+// the list content, so refreshing one list never parses the others again.
+struct PACRuleSource {
+    // The parsed rules of a list and the digest of the list they came from.
+    struct Rules {
+        let key: [UInt8]
+        let rules: [PACRule]
+    }
+
+    let url: String
+    let listPath: String
+    let rulesPath: String
+    let format: RuleListFormat
+    // See GFWListUpdater.init.
+    let defaultsKey: String
+
+    static var gfwlist: PACRuleSource {
+        return PACRuleSource(url: UserDefaults.standard.string(forKey: "GFWListURL")!
+            , listPath: GFWListFilePath, rulesPath: PACRuleSourcesDirPath + "gfwlist.snapshot"
+            , format: .base64, defaultsKey: "GFWList")
+    }
+
+    static var subscriptions: [PACRuleSource] {
+        let urls = UserDefaults.standard.stringArray(forKey: "PAC.RuleSources") ?? []
+        return urls.map { PACRuleSource(subscription: $0) }
+    }
+
+    // The gfwlist first, then the subscriptions in their configured order,
+    // which is the order their rules are merged in.
+    static var all: [PACRuleSource] {
+        return [gfwlist] + subscriptions
+    }
+
+    init(url: String, listPath: String, rulesPath: String, format: RuleListFormat, defaultsKey: String) {
+        self.url = url
+        self.listPath = listPath
+        self.rulesPath = rulesPath
+        self.format = format
+        self.defaultsKey = defaultsKey
+    }
+
+    init(subscription url: String) {
+        let id = Data(url.utf8).sha1()
+        self.init(url: url, listPath: PACRuleSourcesDirPath + id + ".txt"
+            , rulesPath: PACRuleSourcesDirPath + id + ".snapshot"
+            , format: .detect, defaultsKey: "PAC.RuleSources." + id)
+    }
+
+    func key(list: Data) -> [UInt8] {
+        return PACRuleSnapshot.key(gfwlist: list, userRules: nil, template: Data()
+            , options: ["format=\(format.rawValue)"])
+    }
+
+    // The rules of the downloaded list, parsed only if the cached ones are
+    // stale. Returns nil if the list was never downloaded or is invalid.
+    func loadRules() -> Rules? {
+        guard let list = FileManager.default.contents(atPath: listPath) else {
+            return nil
+        }
+        let key = self.key(list: list)
+        if let snapshot = PACRuleSnapshot(contentsOfFile: rulesPath, key: key) {
+            return Rules(key: key, rules: snapshot.rules)
+        }
+        guard let rules = parseRuleList(list, format: format) else {
+            NSLog("PACRuleSource - \(url) is not valid base64")
+            return nil
+        }
+        writeRules(Rules(key: key, rules: rules))
+        return Rules(key: key, rules: rules)
+    }
+
+    // Saves a downloaded list together with the rules parsed from it.
+    func store(list: Data, rules: [PACRule]) -> Bool {
+        do {
+            try FileManager.default.createDirectory(atPath: PACRuleSourcesDirPath
+                , withIntermediateDirectories: true, attributes: nil)
+            try list.write(to: URL(fileURLWithPath: listPath), options: .atomic)
+        } catch {
+            NSLog("PACRuleSource - write \(listPath) failed.")
+            return false
+        }
+        writeRules(Rules(key: key(list: list), rules: rules))
+        return true
+    }
+
+    private func writeRules(_ rules: Rules) {
+        do {
+            try FileManager.default.createDirectory(atPath: PACRuleSourcesDirPath
+                , withIntermediateDirectories: true, attributes: nil)
+            try PACRuleSnapshot(key: rules.key, rules: rules.rules, body: nil).write(toFile: rulesPath)
+        } catch {
+            NSLog("PACRuleSource - write \(rulesPath) failed.")
+        }
+    }
+}
+
+// Loads the rules of every source, the stale ones each parsed on a worker of
+// its own.
+func LoadPACRuleSources(_ sources: [PACRuleSource]) -> [PACRuleSource.Rules?] {
+    var results = [PACRuleSource.Rules?](repeating: nil, count: sources.count)
+    results.withUnsafeMutableBufferPointer { results in
+        DispatchQueue.concurrentPerform(iterations: sources.count) { i in
+            results[i] = sources[i].loadRules()
+        }
+    }
+    return results
+}
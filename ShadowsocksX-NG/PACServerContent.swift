@@ -0,0 +1,224 @@
+//
+//  PACServerContent.swift
+//  ShadowsocksX-NG
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import Foundation
+import zlib
+import GCDWebServer
+
+// The PAC as the PAC server serves it. Its gzip variant is compressed once
+// per PAC instead of once per request, and every variant has a strong ETag,
+// so clients polling the PAC mostly get a 304 or else a compressed body.
+@objc class PACServerContent: NSObject {
+    static let contentType = "application/x-ns-proxy-autoconfig"
+
+    struct Variant {
+        // nil for the PAC itself.
+        let encoding: String?
+        // Bridged once, so the responses of every connection write the same
+        // immutable bytes to their sockets instead of copies.
+        let body: NSData
+        let eTag: String
+
+        var data: Data {
+            return body as Data
+        }
+    }
+
+    // In order of preference, the uncompressed PAC last. A compressed
+    // variant is only kept if it is smaller.
+    let variants: [Variant]
+    // Whole seconds, as HTTP dates have no more.
+    @objc let lastModified: Date
+
+    // The PAC for other proxies, by proxy string, rendered and compressed
+    // when first requested. Bounded, though the proxies come from the
+    // listeners and not from the clients.
+    private var proxyVariants: [String: PACServerContent] = [:]
+    private let proxyVariantsLock = NSLock()
+    static let maxProxyVariants = 16
+
+    @objc init(data: Data, lastModified: Date) {
+        let tag = data.sha1().prefix(16)
+        var variants: [Variant] = []
+        if let compressed = PACServerContent.gzip(data), compressed.count < data.count {
+            variants.append(Variant(encoding: "gzip", body: compressed as NSData, eTag: "\"\(tag)-gzip\""))
+        }
+        variants.append(Variant(encoding: nil, body: data as NSData, eTag: "\"\(tag)\""))
+        self.variants = variants
+        self.lastModified = Date(timeIntervalSince1970: lastModified.timeIntervalSince1970.rounded(.down))
+    }
+
+    @objc convenience init?(contentsOfFile path: String) {
+        guard let data = FileManager.default.contents(atPath: path) else {
+            return nil
+        }
+        let attributes = try? FileManager.default.attributesOfItem(atPath: path)
+        self.init(data: data, lastModified: attributes?[.modificationDate] as? Date ?? Date())
+    }
+
+    // The variant for an Accept-Encoding header: the first variant whose
+    // encoding the client accepts, by name or by "*", with a q-value above 0.
+    func variant(acceptEncoding: String?) -> Variant {
+        var accepted: [String: Bool] = [:]
+        for item in (acceptEncoding ?? "").split(separator: ",") {
+            let parts = item.split(separator: ";").map { $0.trimmingCharacters(in: .whitespaces).lowercased() }
+            guard let coding = parts.first, !coding.isEmpty else {
+                continue
+            }
+            var q = 1.0
+            for parameter in parts.dropFirst() where parameter.hasPrefix("q=") {
+                q = Double(parameter.dropFirst(2)) ?? 0
+            }
+            accepted[coding == "x-gzip" ? "gzip" : coding] = q > 0
+        }
+        return variants.first { variant in
+            guard let encoding = variant.encoding else {
+                return true
+            }
+            return accepted[encoding] ?? accepted["*"] ?? false
+        }!
+    }
+
+    // The PAC going through proxy instead. The compiled rules are not
+    // rendered again: the statement appended runs after the one abp.js
+    // declares proxy with, before any FindProxyForURL call reads it.
+    func content(proxy: String) -> PACServerContent {
+        proxyVariantsLock.lock()
+        defer {
+            proxyVariantsLock.unlock()
+        }
+        if let content = proxyVariants[proxy] {
+            return content
+        }
+        var pac = [UInt8](variants.last!.data)
+        pac.append(contentsOf: "\nproxy = \"".utf8)
+        appendJSONEscaped(proxy.utf8, to: &pac, escapeSlash: false)
+        pac.append(contentsOf: "\";\n".utf8)
+        let content = PACServerContent(data: Data(pac), lastModified: lastModified)
+        if proxyVariants.count < PACServerContent.maxProxyVariants {
+            proxyVariants[proxy] = content
+        }
+        return content
+    }
+
+    // The PAC a request selects with "?via=":
+    //   socks5  through the SOCKS5 listener, as gfwlist.js is generated
+    //   http    through the HTTP listener of privoxy
+    // A listener on every interface is named by the address the request came
+    // in on, which clients on the LAN can reach unlike 0.0.0.0. nil for an
+    // unknown via or an HTTP listener which is off.
+    @objc func content(for request: GCDWebServerRequest) -> PACServerContent? {
+        let defaults = UserDefaults.standard
+        let via = request.query?["via"]?.lowercased() ?? "socks5"
+        let address: String?
+        let port: Int
+        switch via {
+        case "socks5":
+            address = defaults.string(forKey: "LocalSocks5.ListenAddress")
+            port = defaults.integer(forKey: "LocalSocks5.ListenPort")
+        case "http" where defaults.bool(forKey: "LocalHTTPOn"):
+            address = defaults.string(forKey: "LocalHTTP.ListenAddress")
+            port = defaults.integer(forKey: "LocalHTTP.ListenPort")
+        default:
+            return nil
+        }
+        guard var host = address else {
+            return nil
+        }
+        let anyAddress = host == "0.0.0.0" || host == "::"
+        if anyAddress, let local = PACServerContent.numericHost(request.localAddressData) {
+            host = local
+        }
+        if via == "socks5" && !anyAddress {
+            return self
+        }
+        return content(proxy: PACServerContent.proxy(via: via, host: host, port: port))
+    }
+
+    // The proxy string of abp.js for a listener.
+    static func proxy(via: String, host: String, port: Int) -> String {
+        let endpoint = (host.contains(":") ? "[\(host)]" : host) + ":\(port)"
+        if via == "http" {
+            return "PROXY \(endpoint); DIRECT;"
+        }
+        return "SOCKS5 \(endpoint); SOCKS \(endpoint); DIRECT;"
+    }
+
+    static func numericHost(_ address: Data) -> String? {
+        guard !address.isEmpty else {
+            return nil
+        }
+        var host = [CChar](repeating: 0, count: Int(NI_MAXHOST))
+        let status = address.withUnsafeBytes { bytes in
+            getnameinfo(bytes.bindMemory(to: sockaddr.self).baseAddress!, socklen_t(address.count)
+                , &host, socklen_t(host.count), nil, 0, NI_NUMERICHOST)
+        }
+        return status == 0 ? String(cString: host) : nil
+    }
+
+    @objc func response(for request: GCDWebServerRequest) -> GCDWebServerResponse {
+        let variant = self.variant(acceptEncoding: request.headers["Accept-Encoding"])
+
+        // If-Modified-Since only counts without If-None-Match.
+        let notModified: Bool
+        if let ifNoneMatch = request.ifNoneMatch {
+            notModified = ifNoneMatch.split(separator: ",").contains { item in
+                var tag = item.trimmingCharacters(in: .whitespaces)
+                if tag.hasPrefix("W/") {
+                    tag.removeFirst(2)
+                }
+                return tag == "*" || tag == variant.eTag
+            }
+        } else if let ifModifiedSince = request.ifModifiedSince {
+            notModified = lastModified <= ifModifiedSince
+        } else {
+            notModified = false
+        }
+
+        let response: GCDWebServerResponse
+        if notModified {
+            response = GCDWebServerResponse(statusCode: 304)
+        } else {
+            response = GCDWebServerDataResponse(data: variant.body as Data, contentType: PACServerContent.contentType)
+            if let encoding = variant.encoding {
+                response.setValue(encoding, forAdditionalHeader: "Content-Encoding")
+            }
+        }
+        response.eTag = variant.eTag
+        response.lastModifiedDate = lastModified
+        response.setValue("Accept-Encoding", forAdditionalHeader: "Vary")
+        return response
+    }
+
+    static func gzip(_ data: Data) -> Data? {
+        var stream = z_stream()
+        // 16 more window bits for a gzip header and trailer.
+        guard deflateInit2_(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16, MAX_MEM_LEVEL
+            , Z_DEFAULT_STRATEGY, ZLIB_VERSION, Int32(MemoryLayout<z_stream>.size)) == Z_OK else {
+            return nil
+        }
+        defer {
+            deflateEnd(&stream)
+        }
+        var out = Data(count: Int(deflateBound(&stream, uLong(data.count))))
+        let status: Int32 = data.withUnsafeBytes { input in
+            out.withUnsafeMutableBytes { output in
+                stream.next_in = UnsafeMutablePointer(mutating: input.bindMemory(to: Bytef.self).baseAddress)
+                stream.avail_in = uInt(input.count)
+                stream.next_out = output.bindMemory(to: Bytef.self).baseAddress
+                stream.avail_out = uInt(output.count)
+                return deflate(&stream, Z_FINISH)
+            }
+        }
+        guard status == Z_STREAM_END else {
+            return nil
+        }
+        out.count = Int(stream.total_out)
+        return out
+    }
+}
@@ -0,0 +1,125 @@
+//
+//  PACServerMetrics.swift
+//  ShadowsocksX-NG
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import Foundation
+import GCDWebServer
+
+// Counters of the PAC server and of PAC generation, which the PAC server
+// serves at /metrics in the Prometheus text format when PacServer.Metrics is
+// on. Counted whether or not they are served, so that they are complete once
+// turned on.
+@objc class PACServerMetrics: NSObject {
+    @objc static let shared = PACServerMetrics()
+
+    @objc static let contentType = "text/plain; version=0.0.4; charset=utf-8"
+
+    struct RequestKey: Hashable {
+        let path: String
+        let status: Int
+    }
+
+    private let lock = NSLock()
+    private var requests: [RequestKey: Int] = [:]
+    private var bodyBytes = 0
+    // PAC responses only, for the 304 and compression ratios.
+    private var pacRequests = 0
+    private var pacNotModified = 0
+    private var pacBodyBytes = 0
+    private var pacUncompressedBytes = 0
+
+    private var generations: [Bool: Int] = [:]
+    private var generationSeconds = 0.0
+    private var lastGenerationSeconds = 0.0
+    private var lastGenerationDate: Date? = nil
+    private var rules = 0
+
+    // A response of the handler for path, with the content it served from.
+    @objc(recordResponse:path:content:)
+    func record(_ response: GCDWebServerResponse, path: String, content: PACServerContent?) {
+        let bytes = response.hasBody() ? Int(response.contentLength) : 0
+        lock.lock()
+        defer {
+            lock.unlock()
+        }
+        requests[RequestKey(path: path, status: response.statusCode), default: 0] += 1
+        bodyBytes += bytes
+        guard let content = content, response.statusCode == 200 || response.statusCode == 304 else {
+            return
+        }
+        pacRequests += 1
+        if response.statusCode == 304 {
+            pacNotModified += 1
+        } else {
+            pacBodyBytes += bytes
+            pacUncompressedBytes += content.variants.last!.body.length
+        }
+    }
+
+    func recordGeneration(seconds: Double, rules: Int, succeeded: Bool) {
+        lock.lock()
+        defer {
+            lock.unlock()
+        }
+        generations[succeeded, default: 0] += 1
+        generationSeconds += seconds
+        lastGenerationSeconds = seconds
+        lastGenerationDate = Date()
+        if succeeded {
+            self.rules = rules
+        }
+    }
+
+    // The metrics, with the connections of server and the sizes of content.
+    @objc(textForServer:content:)
+    func text(server: GCDWebServer?, content: PACServerContent?) -> String {
+        var lines: [String] = []
+        func metric(_ name: String, _ type: String, _ help: String, _ samples: [(String, Double)]) {
+            lines.append("# HELP ssxng_\(name) \(help)")
+            lines.append("# TYPE ssxng_\(name) \(type)")
+            for (labels, value) in samples {
+                let formatted = value == value.rounded() && abs(value) < 1e15 ? String(Int64(value)) : String(value)
+                lines.append("ssxng_\(name)\(labels) \(formatted)")
+            }
+        }
+
+        lock.lock()
+        let requests = self.requests.sorted { ($0.key.path, $0.key.status) < ($1.key.path, $1.key.status) }
+        metric("pac_server_requests_total", "counter", "Requests served, by handler path and status."
+            , requests.map { ("{path=\"\($0.key.path)\",status=\"\($0.key.status)\"}", Double($0.value)) })
+        metric("pac_server_body_bytes_total", "counter", "Response body bytes served."
+            , [("", Double(bodyBytes))])
+        metric("pac_not_modified_ratio", "gauge", "Share of PAC requests answered 304 Not Modified."
+            , [("", pacRequests > 0 ? Double(pacNotModified) / Double(pacRequests) : 0)])
+        metric("pac_compression_ratio", "gauge", "PAC body bytes served over their uncompressed size."
+            , [("", pacUncompressedBytes > 0 ? Double(pacBodyBytes) / Double(pacUncompressedBytes) : 1)])
+        metric("pac_generations_total", "counter", "PAC files generated, by result."
+            , [("{result=\"succeeded\"}", Double(generations[true] ?? 0))
+                , ("{result=\"failed\"}", Double(generations[false] ?? 0))])
+        metric("pac_generation_seconds", "summary", "Time spent generating PAC files."
+            , [("_sum", generationSeconds), ("_count", Double(generations.values.reduce(0, +)))])
+        metric("pac_generation_last_seconds", "gauge", "Time the last PAC generation took."
+            , [("", lastGenerationSeconds)])
+        metric("pac_generation_last_timestamp_seconds", "gauge", "When the last PAC generation ended."
+            , [("", lastGenerationDate?.timeIntervalSince1970 ?? 0)])
+        metric("pac_rules", "gauge", "Rules in the last PAC generated.", [("", Double(rules))])
+        lock.unlock()
+
+        if let server = server {
+            metric("pac_server_connections", "gauge", "Connections open.", [("", Double(server.activeConnectionCount))])
+            metric("pac_server_connections_total", "counter", "Connections opened."
+                , [("", Double(server.totalConnectionCount))])
+            metric("pac_server_refused_connections_total", "counter", "Connections over the limit per client."
+                , [("", Double(server.refusedConnectionCount))])
+        }
+        if let content = content {
+            metric("pac_bytes", "gauge", "Size of the PAC served, by content encoding."
+                , content.variants.map { ("{encoding=\"\($0.encoding ?? "identity")\"}", Double($0.body.length)) })
+        }
+        return lines.joined(separator: "\n") + "\n"
+    }
+}
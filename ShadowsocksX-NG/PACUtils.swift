@@ -15,6 +15,8 @@ let PACRulesDirPath = NSHomeDirectory() + "/.ShadowsocksX-NG/"
 let PACUserRuleFilePath = PACRulesDirPath + "user-rule.txt"
 let PACFilePath = PACRulesDirPath + "gfwlist.js"
 let GFWListFilePath = PACRulesDirPath + "gfwlist.txt"
+let PACRuleSnapshotFilePath = PACRulesDirPath + "gfwlist.snapshot"
+let PACSlowFilterReportFilePath = PACRulesDirPath + "gfwlist.slow-filters.txt"
 
 
 // Because of LocalSocks5.ListenPort may be changed
@@ -49,6 +51,14 @@ func SyncPac() {
 
 
 func GeneratePACFile() -> Bool {
+    let began = Date()
+    var rules = 0
+    var succeeded = false
+    defer {
+        PACServerMetrics.shared.recordGeneration(seconds: Date().timeIntervalSince(began), rules: rules
+            , succeeded: succeeded)
+    }
+    
     let fileMgr = FileManager.default
     // Maker the dir if rulesDirPath is not exesited.
     if !fileMgr.fileExists(atPath: PACRulesDirPath) {
@@ -72,93 +82,190 @@ func GeneratePACFile() -> Bool {
         try! fileMgr.copyItem(atPath: src!, toPath: PACUserRuleFilePath)
     }
     
+    let userRules = fileMgr.contents(atPath: PACUserRuleFilePath)
+    if userRules == nil {
+        NSLog("Not found user-rule.txt")
+    }
+    
+    guard let compiler = MakePACCompiler() else {
+        NSLog("Not found abp.js")
+        return false
+    }
+    
+    guard let snapshot = LoadPACRuleSnapshot(compiler: compiler, userRules: userRules) else {
+        NSLog("Failed to decode gfwlist.txt")
+        return false
+    }
+    rules = snapshot.rules.count
+    succeeded = WritePACFile(compiler: compiler, snapshot: snapshot)
+    return succeeded
+}
+
+func MakePACCompiler() -> PACCompiler? {
+    guard let template = PACTemplate.bundled else {
+        return nil
+    }
+    return PACCompiler(template: template
+        , precompileDomainTables: UserDefaults.standard.bool(forKey: "PAC.PrecompileDomainTables")
+        , compactOutput: UserDefaults.standard.bool(forKey: "PAC.OptimizeRules")
+        , lowerSlowFilters: UserDefaults.standard.bool(forKey: "PAC.LowerSlowFilters"))
+}
+
+func WritePACFile(compiler: PACCompiler, snapshot: PACRuleSnapshot) -> Bool {
     let socks5Address = UserDefaults.standard.string(forKey: "LocalSocks5.ListenAddress")!
     let socks5Port = UserDefaults.standard.integer(forKey: "LocalSocks5.ListenPort")
     
+    let pac: Data
+    if let body = snapshot.body {
+        var out = compiler.renderHeader(socks5Address: socks5Address, socks5Port: socks5Port)
+        out.append(contentsOf: body)
+        pac = Data(out)
+    } else {
+        pac = compiler.render(rules: snapshot.rules, socks5Address: socks5Address, socks5Port: socks5Port)
+    }
+    
     do {
-        let gfwlist = try String(contentsOfFile: GFWListFilePath, encoding: String.Encoding.utf8)
-        if let data = Data(base64Encoded: gfwlist, options: .ignoreUnknownCharacters) {
-            let str = String(data: data, encoding: String.Encoding.utf8)
-            var lines = str!.components(separatedBy: CharacterSet.newlines)
-            
-            do {
-                let userRuleStr = try String(contentsOfFile: PACUserRuleFilePath, encoding: String.Encoding.utf8)
-                let userRuleLines = userRuleStr.components(separatedBy: CharacterSet.newlines)
-                
-                lines = userRuleLines + lines.filter { (line) in
-                    // ignore the rule from gwf if user provide same rule for the same url
-                    var i = line.startIndex
-                    while i < line.endIndex {
-                        if line[i] == "@" || line[i] == "|" {
-                            i = line.index(after: i)
-                            continue
-                        }
-                        break
-                    }
-                    if i == line.startIndex {
-                        return !userRuleLines.contains(line)
-                    }
-                    return !userRuleLines.contains(String(line[i...]))
-                }
-            } catch {
-                NSLog("Not found user-rule.txt")
-            }
-            
-            // Filter empty and comment lines
-            lines = lines.filter({ (s: String) -> Bool in
-                if s.isEmpty {
-                    return false
-                }
-                let c = s[s.startIndex]
-                if c == "!" || c == "[" {
-                    return false
-                }
-                return true
-            })
-            
-            do {
-                // rule lines to json array
-                let rulesJsonData: Data
-                    = try JSONSerialization.data(withJSONObject: lines, options: .prettyPrinted)
-                let rulesJsonStr = String(data: rulesJsonData, encoding: String.Encoding.utf8)
-                
-                // Get raw pac js
-                let jsPath = Bundle.main.url(forResource: "abp", withExtension: "js")
-                let jsData = try? Data(contentsOf: jsPath!)
-                var jsStr = String(data: jsData!, encoding: String.Encoding.utf8)
-                
-                // Replace rules placeholder in pac js
-                jsStr = jsStr!.replacingOccurrences(of: "__RULES__"
-                    , with: rulesJsonStr!)
-                // Replace __SOCKS5PORT__ palcholder in pac js
-                jsStr = jsStr!.replacingOccurrences(of: "__SOCKS5PORT__"
-                    , with: "\(socks5Port)")
-                // Replace __SOCKS5ADDR__ palcholder in pac js
-                var sin6 = sockaddr_in6()
-                if socks5Address.withCString({ cstring in inet_pton(AF_INET6, cstring, &sin6.sin6_addr) }) == 1 {
-                    jsStr = jsStr!.replacingOccurrences(of: "__SOCKS5ADDR__"
-                        , with: "[\(socks5Address)]")
-                } else {
-                    jsStr = jsStr!.replacingOccurrences(of: "__SOCKS5ADDR__"
-                        , with: socks5Address)
-                }
-                
-                // Write the pac js to file.
-                try jsStr!.data(using: String.Encoding.utf8)?
-                    .write(to: URL(fileURLWithPath: PACFilePath), options: .atomic)
-                
-                return true
-            } catch {
-                
-            }
-        }
-        
+        // Write the pac js to file.
+        try pac.write(to: URL(fileURLWithPath: PACFilePath), options: .atomic)
+        return true
     } catch {
-        NSLog("Not found gfwlist.txt")
+        NSLog("Write gfwlist.js failed.")
     }
     return false
 }
 
+// Reuse the merged rules and the rendered body while none of the inputs
+// changed, e.g. when only the SOCKS5 address or port did. Otherwise merge the
+// rules of every source again, in order and under the user rules, and cache
+// them. If they come out the same as previous, its body is reused as well.
+//
+// Unless store, a merged snapshot is neither rendered nor cached, for rules
+// which are only looked at, e.g. user rules still being edited.
+func LoadPACRuleSnapshot(compiler: PACCompiler, userRules: Data?
+    , previous: PACRuleSnapshot? = nil, store: Bool = true) -> PACRuleSnapshot? {
+    let sources = PACRuleSource.all
+    let lists = LoadPACRuleSources(sources)
+    guard lists[0] != nil else {
+        return nil
+    }
+    for (source, list) in zip(sources, lists) where list == nil {
+        NSLog("GeneratePACFile - rule source \(source.url) is not downloaded yet")
+    }
+    let loaded = lists.compactMap { $0 }
+    let optimize = UserDefaults.standard.bool(forKey: "PAC.OptimizeRules")
+    
+    // The sources enter the key through their own keys.
+    let key = PACRuleSnapshot.key(gfwlist: Data(loaded.flatMap { $0.key }), userRules: userRules
+        , template: compiler.template.data, options: compiler.options + ["optimizeRules=\(optimize)"])
+    if let snapshot = PACRuleSnapshot(contentsOfFile: PACRuleSnapshotFilePath, key: key) {
+        return snapshot
+    }
+    
+    var ruleSet = PACRuleSet(userRules: userRules)
+    for list in loaded {
+        for rule in list.rules {
+            ruleSet.addGFWListRule(rule)
+        }
+    }
+    let report = ruleSet.report
+    NSLog("GeneratePACFile - gfwlist rules merged: \(report.summary)")
+    for o in report.conflicting {
+        NSLog("GeneratePACFile - gfwlist rule \(o.rule) is overridden by user rule \(o.userRule)")
+    }
+    
+    // The snapshot keeps the effective rules, so rules the optimizer drops
+    // do not count as a change either.
+    var rules = ruleSet.rules
+    if optimize {
+        let optimizer = PACRuleOptimizer(rules: rules)
+        // Both sizes with the same writer, so the saving is the optimizer's alone.
+        let before = compiler.rulesByteCount(rules)
+        rules = optimizer.rules
+        NSLog("GeneratePACFile - rules optimized: \(optimizer.report.summary)"
+            + ", \(before) -> \(compiler.rulesByteCount(rules)) bytes")
+    }
+    
+    guard store else {
+        return PACRuleSnapshot(key: key, rules: rules, body: nil)
+    }
+    var body: Data? = nil
+    if let previous = previous, previous.rules == rules {
+        body = previous.body
+    } else {
+        body = compiler.renderBody(rules: rules).map { Data($0) }
+        if compiler.lowerSlowFilters {
+            WriteSlowFilterReport(compiler.lowering(of: rules).report)
+        }
+    }
+    let snapshot = PACRuleSnapshot(key: key, rules: rules, body: body)
+    do {
+        try snapshot.write(toFile: PACRuleSnapshotFilePath)
+    } catch {
+        NSLog("Write gfwlist.snapshot failed.")
+    }
+    return snapshot
+}
+
+func WriteSlowFilterReport(_ report: PACRuleLowering.Report) {
+    NSLog("GeneratePACFile - slow filters lowered: \(report.summary)")
+    do {
+        try report.text.write(toFile: PACSlowFilterReportFilePath, atomically: true, encoding: .utf8)
+    } catch {
+        NSLog("Write gfwlist.slow-filters.txt failed.")
+    }
+}
+
+// A matcher over the rules the PAC is generated from with userRules, to test
+// URLs against without evaluating the PAC.
+func LoadPACMatcher(userRules: Data?) -> PACMatcher? {
+    guard let compiler = MakePACCompiler(),
+        let snapshot = LoadPACRuleSnapshot(compiler: compiler, userRules: userRules, store: false) else {
+        return nil
+    }
+    return PACMatcher(rules: snapshot.rules)
+}
+
+// Saves the downloaded lists and rewrites gfwlist.js only if the merged rules
+// differ from those it was generated from. Every rewrite makes
+// startMonitorPAC reload and compress the PAC the server serves and changes
+// its ETag, so every client downloads it again, and a list which only changed
+// in its comments or in the order of duplicates must not cause one.
+//
+// Returns whether gfwlist.js was rewritten, nil on failure.
+func ApplyRuleSourceDownloads(_ sources: [PACRuleSource], updaters: [GFWListUpdater]
+    , results: [GFWListUpdater.Result]) -> Bool? {
+    guard let compiler = MakePACCompiler() else {
+        NSLog("Not found abp.js")
+        return nil
+    }
+    let userRules = FileManager.default.contents(atPath: PACUserRuleFilePath)
+    
+    // The rules gfwlist.js is currently generated from.
+    var current: PACRuleSnapshot? = nil
+    if FileManager.default.fileExists(atPath: PACFilePath) {
+        current = LoadPACRuleSnapshot(compiler: compiler, userRules: userRules)
+    }
+    
+    for (i, result) in results.enumerated() {
+        if case .downloaded(let download) = result {
+            // Parsed while downloading, so only merged below.
+            if sources[i].store(list: download.list, rules: download.ruleSet.rules) {
+                updaters[i].commit(download)
+            }
+        }
+    }
+    
+    guard let snapshot = LoadPACRuleSnapshot(compiler: compiler, userRules: userRules, previous: current) else {
+        NSLog("Failed to decode gfwlist.txt")
+        return nil
+    }
+    if let current = current, current.rules == snapshot.rules {
+        return false
+    }
+    return WritePACFile(compiler: compiler, snapshot: snapshot) ? true : nil
+}
+
+// Downloads the gfwlist and every rule subscription concurrently.
 func UpdatePACFromGFWList() {
     // Make the dir if rulesDirPath is not exesited.
     if !FileManager.default.fileExists(atPath: PACRulesDirPath) {
@@ -169,31 +276,43 @@ func UpdatePACFromGFWList() {
         }
     }
     
-    let url = UserDefaults.standard.string(forKey: "GFWListURL")
-    AF.request(url!)
-        .validate()
-        .responseString {
-            response in
-            switch response.result {
-            case .success(let v):
-                do {
-                    try v.write(toFile: GFWListFilePath, atomically: true, encoding: String.Encoding.utf8)
-                    if GeneratePACFile() {
-                        // Popup a user notification
-                        let notification = NSUserNotification()
-                        notification.title = "PAC has been updated by latest GFW List.".localized
-                        NSUserNotificationCenter.default
-                            .deliver(notification)
-                    }
-                } catch {
-                    
-                }
-            case .failure:
-                // Popup a user notification
-                let notification = NSUserNotification()
-                notification.title = "Failed to download latest GFW List.".localized
-                NSUserNotificationCenter.default
-                    .deliver(notification)
+    let sources = PACRuleSource.all
+    let updaters = sources.map {
+        GFWListUpdater(url: $0.url, userRules: nil, format: $0.format, defaultsKey: $0.defaultsKey)
+    }
+    var results = [GFWListUpdater.Result](repeating: .failed, count: sources.count)
+    let group = DispatchGroup()
+    for (i, updater) in updaters.enumerated() {
+        group.enter()
+        updater.update(useValidators: FileManager.default.fileExists(atPath: sources[i].listPath)) {
+            result in
+            results[i] = result
+            group.leave()
+        }
+    }
+    
+    group.notify(queue: .main) {
+        for (source, result) in zip(sources, results).dropFirst() {
+            if case .failed = result {
+                NSLog("Failed to download rule source \(source.url)")
+            }
+        }
+        let rewritten = ApplyRuleSourceDownloads(sources, updaters: updaters, results: results)
+        
+        let notification = NSUserNotification()
+        if case .failed = results[0] {
+            notification.title = "Failed to download latest GFW List.".localized
+        } else if let rewritten = rewritten {
+            if rewritten {
+                notification.title = "PAC has been updated by latest GFW List.".localized
+            } else {
+                notification.title = "GFW List is already up to date.".localized
             }
+        } else {
+            return
         }
+        // Popup a user notification
+        NSUserNotificationCenter.default
+            .deliver(notification)
+    }
 }
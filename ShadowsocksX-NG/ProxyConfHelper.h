@@ -10,6 +10,8 @@
 #import <GCDWebServer/GCDWebServer.h>
 #import <GCDWebServer/GCDWebServerDataResponse.h>
 
+@class PACServerContent;
+
 @interface ProxyConfHelper : NSObject
 
 + (void)install;
@@ -24,4 +26,11 @@
 
 + (void)startMonitorPAC;
 
+// The PAC server as startPACServer: configures it, serving what content
+// returns for each request, or 404 while it returns nil and for variants
+// selected by the query which do not exist, see PACServerContent.
++ (GCDWebServer*)pacServerWithContent:(PACServerContent* (^)(void)) content;
+
++ (NSDictionary<NSString*, id>*)pacServerOptionsWithPort:(NSUInteger) port bindToLocalhost:(BOOL) bindToLocalhost;
+
 @end
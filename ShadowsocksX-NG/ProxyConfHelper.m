@@ -8,6 +8,7 @@
 
 #import "ProxyConfHelper.h"
 #import "proxy_conf_helper_version.h"
+#import "ShadowsocksX_NG-Swift.h"
 
 #define kShadowsocksHelper @"/Library/Application Support/ShadowsocksX-NG/proxy_conf_helper"
 
@@ -220,36 +221,123 @@ GCDWebServer *webServer = nil;
     return [defaults stringForKey:@"ExternalPACURL"];
 }
 
+// What the PAC server serves, swapped in place when the PAC changes.
+static PACServerContent *pacServerContent = nil;
+static NSDictionary<NSString*, id> *pacServerStartedOptions = nil;
+
++ (PACServerContent*)pacServerContent {
+    @synchronized (self) {
+        return pacServerContent;
+    }
+}
+
+// Compressed once here rather than per request. Keeps what is served if the
+// PAC cannot be read, e.g. while it is being replaced.
++ (BOOL)reloadPACServerContent:(NSString*) PACFilePath {
+    PACServerContent* content = [[PACServerContent alloc] initWithContentsOfFile:PACFilePath];
+    if (content == nil) {
+        NSLog(@"Failed to read the PAC to serve: %@", PACFilePath);
+        return NO;
+    }
+    @synchronized (self) {
+        pacServerContent = content;
+    }
+    return YES;
+}
+
 + (void)startPACServer:(NSString*) PACFilePath {
-    [self stopPACServer];
+    NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
     
-    NSString * routerPath = @"/proxy.pac";
+    BOOL bindToLocalhost = [defaults boolForKey:@"PacServer.BindToLocalhost"];
+    int port = (short)[defaults integerForKey:@"PacServer.ListenPort"];
     
-    NSData* originalPACData = [NSData dataWithContentsOfFile:PACFilePath];
+    NSDictionary<NSString*, id>* options = [self pacServerOptionsWithPort:port bindToLocalhost:bindToLocalhost];
     
-    webServer = [[GCDWebServer alloc] init];
+    [self reloadPACServerContent:PACFilePath];
+    // Only the content changed, the running server serves it from now on.
+    if ([webServer isRunning] && [pacServerStartedOptions isEqualToDictionary:options]) {
+        return;
+    }
     
-
+    [self stopPACServer];
+    
+    webServer = [self pacServerWithContent:^PACServerContent *{
+        return [ProxyConfHelper pacServerContent];
+    }];
+    // Always registered, so that PacServer.Metrics takes effect without a restart.
+    __weak GCDWebServer* server = webServer;
     [webServer addHandlerForMethod:@"GET"
-                              path:routerPath
+                              path:@"/metrics"
                       requestClass:[GCDWebServerRequest class]
                       processBlock:^GCDWebServerResponse *(GCDWebServerRequest *request)
     {
-        GCDWebServerDataResponse* resp = [GCDWebServerDataResponse responseWithData:originalPACData
-                                                                        contentType:@"application/x-ns-proxy-autoconfig"];
-        return resp;
+        GCDWebServerResponse* response;
+        if ([[NSUserDefaults standardUserDefaults] boolForKey:@"PacServer.Metrics"]) {
+            NSString* text = [PACServerMetrics.shared textForServer:server content:[ProxyConfHelper pacServerContent]];
+            response = [GCDWebServerDataResponse responseWithData:[text dataUsingEncoding:NSUTF8StringEncoding]
+                                                      contentType:PACServerMetrics.contentType];
+        } else {
+            response = [GCDWebServerResponse responseWithStatusCode:kGCDWebServerHTTPStatusCode_NotFound];
+        }
+        [PACServerMetrics.shared recordResponse:response path:@"/metrics" content:nil];
+        return response;
     }
      ];
-    
+    pacServerStartedOptions = options;
+    [webServer startWithOptions:options error:nil];
+}
+
+// Shared with PACServerLoadTests, which loads the server as configured here.
++ (GCDWebServer*)pacServerWithContent:(PACServerContent* (^)(void)) content {
+    GCDWebServer* server = [[GCDWebServer alloc] init];
+    // WPAD clients on the LAN fetch /wpad.dat, served from the same
+    // compressed bytes as /proxy.pac.
+    for (NSString* routerPath in @[@"/proxy.pac", @"/wpad.dat"]) {
+        [server addHandlerForMethod:@"GET"
+                               path:routerPath
+                       requestClass:[GCDWebServerRequest class]
+                       processBlock:^GCDWebServerResponse *(GCDWebServerRequest *request)
+        {
+            // Rendered from the current PAC for the proxy the query selects.
+            PACServerContent* current = [content() contentFor:request];
+            GCDWebServerResponse* response;
+            if (current == nil) {
+                response = [GCDWebServerResponse responseWithStatusCode:kGCDWebServerHTTPStatusCode_NotFound];
+            } else {
+                response = [current responseFor:request];
+            }
+            // By the path registered, which requests match whatever their case.
+            [PACServerMetrics.shared recordResponse:response path:routerPath content:current];
+            return response;
+        }
+         ];
+    }
+    return server;
+}
+
+// Sized for a whole LAN fetching the PAC at once when not bound to
+// localhost. Every local client shares the loopback address, so only LAN
+// clients are limited per address.
++ (NSDictionary<NSString*, id>*)pacServerOptionsWithPort:(NSUInteger) port bindToLocalhost:(BOOL) bindToLocalhost {
     NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
     
-    BOOL bindToLocalhost = [defaults boolForKey:@"PacServer.BindToLocalhost"];
-    int port = (short)[defaults integerForKey:@"PacServer.ListenPort"];
-    
-    [webServer startWithOptions:@{
+    NSMutableDictionary<NSString*, id>* options = [@{
         GCDWebServerOption_BindToLocalhost: @(bindToLocalhost),
         GCDWebServerOption_Port: @(port)
-    } error:nil];
+    } mutableCopy];
+    NSInteger maxPendingConnections = [defaults integerForKey:@"PacServer.MaxPendingConnections"];
+    if (maxPendingConnections > 0) {
+        options[GCDWebServerOption_MaxPendingConnections] = @(maxPendingConnections);
+    }
+    NSInteger acceptSources = [defaults integerForKey:@"PacServer.AcceptSources"];
+    if (acceptSources > 0) {
+        options[GCDWebServerOption_AcceptSources] = @(acceptSources);
+    }
+    NSInteger maxConnectionsPerClient = [defaults integerForKey:@"PacServer.MaxConnectionsPerClient"];
+    if (maxConnectionsPerClient > 0) {
+        options[GCDWebServerOption_MaxConnectionsPerClient] = @(maxConnectionsPerClient);
+    }
+    return options;
 }
 
 + (void)stopPACServer {
@@ -264,31 +352,40 @@ GCDWebServer *webServer = nil;
     NSString* PACFilePath = [self getPACFilePath];
     dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
     int fileId = open([PACFilePath UTF8String], O_EVTONLY);
+    if (fileId < 0) {
+        NSLog(@"Failed to monitor the PAC: %@", PACFilePath);
+        return;
+    }
     __block dispatch_source_t source = dispatch_source_create(DISPATCH_SOURCE_TYPE_VNODE, fileId,
                                                               DISPATCH_VNODE_DELETE | DISPATCH_VNODE_WRITE | DISPATCH_VNODE_EXTEND | DISPATCH_VNODE_ATTRIB | DISPATCH_VNODE_LINK | DISPATCH_VNODE_RENAME | DISPATCH_VNODE_REVOKE,
                                                               queue);
     dispatch_source_set_event_handler(source, ^
                                       {
                                           unsigned long flags = dispatch_source_get_data(source);
-                                          if(flags & DISPATCH_VNODE_DELETE)
+                                          // The PAC file was written by atomically (PACUtils.swift)
+                                          // That means the file monitored is replaced by a new one,
+                                          // which is monitored from now on.
+                                          BOOL replaced = (flags & (DISPATCH_VNODE_DELETE | DISPATCH_VNODE_RENAME | DISPATCH_VNODE_REVOKE)) != 0;
+                                          if (replaced)
                                           {
                                               dispatch_source_cancel(source);
                                           }
                                           
-                                          // The PAC file was written by atomically (PACUtils.swift:134)
-                                          // That means DISPATCH_VNODE_DELETE event always be trigged
-                                          // Need to be run the following statements in any events
-                                          NSUserDefaults* defaults = [NSUserDefaults standardUserDefaults];
-                                          if ([defaults boolForKey:@"ShadowsocksOn"]) {
-                                              if ([[defaults stringForKey:@"ShadowsocksRunningMode"] isEqualToString:@"auto"]) {
-                                                  [ProxyConfHelper disableProxy];
-                                                  [ProxyConfHelper enablePACProxy];
+                                          // The PAC URL stays the same, so the system proxy is left
+                                          // alone and the running PAC server swaps what it serves.
+                                          // On the main queue, like startPACServer: and stopPACServer,
+                                          // so webServer is not read while they assign it and the
+                                          // reloads are stored in the order the file changed.
+                                          dispatch_async(dispatch_get_main_queue(), ^{
+                                              if ([webServer isRunning]) {
+                                                  [ProxyConfHelper reloadPACServerContent:PACFilePath];
                                               }
-                                          }
+                                          });
                                       });
     dispatch_source_set_cancel_handler(source, ^(void) 
                                        {
                                            close(fileId);
+                                           [ProxyConfHelper startMonitorPAC];
                                        });
     dispatch_resume(source);
 }
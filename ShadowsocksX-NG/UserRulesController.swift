@@ -11,6 +11,13 @@ import Cocoa
 class UserRulesController: NSWindowController {
 
     @IBOutlet var userRulesView: NSTextView!
+    @IBOutlet var testURLField: NSTextField!
+    @IBOutlet var testResultField: NSTextField!
+
+    // Built for the user rules in the editor the first time a URL is tested
+    // with them.
+    private var matcher: PACMatcher?
+    private var matcherUserRules: String?
 
     override func windowDidLoad() {
         super.windowDidLoad()
@@ -25,6 +32,47 @@ class UserRulesController: NSWindowController {
         userRulesView.string = str!
     }
     
+    // Tells whether the PAC would proxy a URL, were the user rules saved as
+    // they are edited.
+    @IBAction func testURL(_ sender: AnyObject) {
+        var url = testURLField.stringValue.trimmingCharacters(in: .whitespaces)
+        if url.isEmpty {
+            testResultField.stringValue = ""
+            return
+        }
+        if !url.contains("://") {
+            url = "http://" + url
+        }
+        let userRules = userRulesView.string
+        if let matcher = matcher, matcherUserRules == userRules {
+            showDecision(matcher.decision(for: url))
+            return
+        }
+        DispatchQueue.global(qos: .userInitiated).async {
+            let matcher = LoadPACMatcher(userRules: userRules.data(using: String.Encoding.utf8))
+            DispatchQueue.main.async {
+                self.matcher = matcher
+                self.matcherUserRules = userRules
+                if let matcher = matcher {
+                    self.showDecision(matcher.decision(for: url))
+                } else {
+                    self.testResultField.stringValue = "Failed to load the PAC rules.".localized
+                }
+            }
+        }
+    }
+
+    private func showDecision(_ decision: PACMatcher.Decision) {
+        switch decision {
+        case .proxy(let rule):
+            testResultField.stringValue = String(format: "Proxy, by rule %@".localized, rule)
+        case .direct(let rule?):
+            testResultField.stringValue = String(format: "Direct, by rule %@".localized, rule)
+        case .direct(.none):
+            testResultField.stringValue = "Direct, no rule matches".localized
+        }
+    }
+
     @IBAction func didCancel(_ sender: AnyObject) {
         window?.performClose(self)
     }
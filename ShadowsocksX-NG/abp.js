@@ -5,6 +5,11 @@ var proxy = "SOCKS5 __SOCKS5ADDR__:__SOCKS5PORT__; SOCKS __SOCKS5ADDR__:__SOCKS5
 
 var rules = __RULES__;
 
+// "||domain", "||domain^" and "|http://..." rules compiled ahead of time.
+// "domains" and "prefixes" are sorted and prefix-free, so the only candidate
+// prefix of a string is the greatest entry not above it.
+var tables = __TABLES__;
+
 /*
  * This file is part of Adblock Plus <http://adblockplus.org/>,
  * Copyright (C) 2006-2014 Eyeo GmbH
@@ -184,6 +189,7 @@ extend(ActiveFilter, Filter, {
        }
        this.domainSource = null;
        }
+       this.domains = domains;
        return this.domains;
        },
        sitekeys: null,
@@ -620,93 +626,203 @@ matchesAny: function(location, contentType, docDomain, thirdParty, sitekey)
   }
 };
 
+function ResultCache(capacity)
+{
+  this.capacity = capacity;
+  this.clear();
+}
+ResultCache.prototype = {
+capacity: 0,
+size: 0,
+entries: null,
+head: null,
+tail: null,
+hits: 0,
+misses: 0,
+evictions: 0,
+clear: function()
+  {
+    this.entries = createDict();
+    this.size = 0;
+    this.head = null;
+    this.tail = null;
+  },
+get: function(key)
+  {
+    var entry = this.entries[key];
+    if (typeof entry == "undefined")
+    {
+      this.misses++;
+      return entry;
+    }
+    this.hits++;
+    if (entry !== this.head)
+    {
+      this._unlink(entry);
+      this._pushFront(entry);
+    }
+    return entry;
+  },
+put: function(key, value)
+  {
+    if (this.size >= this.capacity)
+    {
+      var last = this.tail;
+      this._unlink(last);
+      delete this.entries[last.key];
+      this.size--;
+      this.evictions++;
+    }
+    var entry = {key: key, value: value, prev: null, next: null};
+    this._pushFront(entry);
+    this.entries[key] = entry;
+    this.size++;
+  },
+_unlink: function(entry)
+  {
+    if (entry.prev)
+    {
+      entry.prev.next = entry.next;
+    }
+    else
+    {
+      this.head = entry.next;
+    }
+    if (entry.next)
+    {
+      entry.next.prev = entry.prev;
+    }
+    else
+    {
+      this.tail = entry.prev;
+    }
+    entry.prev = null;
+    entry.next = null;
+  },
+_pushFront: function(entry)
+  {
+    entry.next = this.head;
+    if (this.head)
+    {
+      this.head.prev = entry;
+    }
+    this.head = entry;
+    if (!this.tail)
+    {
+      this.tail = entry;
+    }
+  },
+stats: function()
+  {
+    return {capacity: this.capacity, size: this.size, hits: this.hits, misses: this.misses, evictions: this.evictions};
+  }
+};
+
 function CombinedMatcher()
 {
   this.blacklist = new Matcher();
   this.whitelist = new Matcher();
-  this.resultCache = createDict();
+  this.hostBlacklist = new Matcher();
+  this.hostWhitelist = new Matcher();
+  this.resultCache = new ResultCache(CombinedMatcher.maxCacheEntries);
 }
-CombinedMatcher.maxCacheEntries = 1000;
+// Sized with make pac-bench on the bundled rules: on its default corpus 8000
+// entries take the hit rate from 19.8% to 27.6% and the hot mean latency
+// from 270 to 236 us for 1.3 MB more heap. Doubling it again gains 3 points.
+CombinedMatcher.maxCacheEntries = 8000;
+// Filters whose result depends on nothing but the host: "||domain" and
+// "||domain^" without options. Assuming the URL has no user info, they match
+// a URL exactly if they match "scheme://host/", so their result is cached
+// per host and only the other filters are looked at per URL.
+CombinedMatcher.hostOnlyRegExp = /^(?:@@)?\|\|[a-z0-9.\-]+\^?$/i;
+CombinedMatcher.isHostOnly = function(filter)
+{
+  var text = filter.text;
+  var c = text.charAt(0);
+  return (c == "|" || c == "@") && filter instanceof RegExpFilter && CombinedMatcher.hostOnlyRegExp.test(text);
+};
 CombinedMatcher.prototype = {
 blacklist: null,
 whitelist: null,
+hostBlacklist: null,
+hostWhitelist: null,
 resultCache: null,
-cacheEntries: 0,
+urlWhitelistCount: 0,
+urlBlacklistCount: 0,
 clear: function()
   {
     this.blacklist.clear();
     this.whitelist.clear();
-    this.resultCache = createDict();
-    this.cacheEntries = 0;
+    this.hostBlacklist.clear();
+    this.hostWhitelist.clear();
+    this.resultCache.clear();
+    this.urlWhitelistCount = 0;
+    this.urlBlacklistCount = 0;
   },
-add: function(filter)
+_matcherFor: function(filter)
   {
+    var hostOnly = CombinedMatcher.isHostOnly(filter);
     if (filter instanceof WhitelistFilter)
     {
-      this.whitelist.add(filter);
+      return hostOnly ? this.hostWhitelist : this.whitelist;
     }
     else
     {
-      this.blacklist.add(filter);
-    }
-    if (this.cacheEntries > 0)
-    {
-      this.resultCache = createDict();
-      this.cacheEntries = 0;
+      return hostOnly ? this.hostBlacklist : this.blacklist;
     }
   },
-remove: function(filter)
+_countURLFilter: function(matcher, delta)
   {
-    if (filter instanceof WhitelistFilter)
-    {
-      this.whitelist.remove(filter);
-    }
-    else
+    if (matcher === this.whitelist)
     {
-      this.blacklist.remove(filter);
+      this.urlWhitelistCount += delta;
     }
-    if (this.cacheEntries > 0)
+    else if (matcher === this.blacklist)
     {
-      this.resultCache = createDict();
-      this.cacheEntries = 0;
+      this.urlBlacklistCount += delta;
     }
   },
-findKeyword: function(filter)
+add: function(filter)
   {
-    if (filter instanceof WhitelistFilter)
+    var matcher = this._matcherFor(filter);
+    if (!matcher.hasFilter(filter))
     {
-      return this.whitelist.findKeyword(filter);
+      matcher.add(filter);
+      this._countURLFilter(matcher, 1);
     }
-    else
+    if (this.resultCache.size > 0)
     {
-      return this.blacklist.findKeyword(filter);
+      this.resultCache.clear();
     }
   },
-hasFilter: function(filter)
+remove: function(filter)
   {
-    if (filter instanceof WhitelistFilter)
+    var matcher = this._matcherFor(filter);
+    if (matcher.hasFilter(filter))
     {
-      return this.whitelist.hasFilter(filter);
+      matcher.remove(filter);
+      this._countURLFilter(matcher, -1);
     }
-    else
+    if (this.resultCache.size > 0)
     {
-      return this.blacklist.hasFilter(filter);
+      this.resultCache.clear();
     }
   },
+findKeyword: function(filter)
+  {
+    return this._matcherFor(filter).findKeyword(filter);
+  },
+hasFilter: function(filter)
+  {
+    return this._matcherFor(filter).hasFilter(filter);
+  },
 getKeywordForFilter: function(filter)
   {
-    if (filter instanceof WhitelistFilter)
-    {
-      return this.whitelist.getKeywordForFilter(filter);
-    }
-    else
-    {
-      return this.blacklist.getKeywordForFilter(filter);
-    }
+    return this._matcherFor(filter).getKeywordForFilter(filter);
   },
 isSlowFilter: function(filter)
   {
-    var matcher = filter instanceof WhitelistFilter ? this.whitelist : this.blacklist;
+    var matcher = this._matcherFor(filter);
     if (matcher.hasFilter(filter))
     {
       return !matcher.getKeywordForFilter(filter);
@@ -716,7 +832,8 @@ isSlowFilter: function(filter)
       return !matcher.findKeyword(filter);
     }
   },
-matchesAnyInternal: function(location, contentType, docDomain, thirdParty, sitekey)
+// Once blacklistHit is set only the whitelist is looked at.
+_matchesAnyIn: function(whitelist, blacklist, blacklistHit, location, contentType, docDomain, thirdParty, sitekey)
   {
     var candidates = location.toLowerCase().match(/[a-z0-9%]{3,}/g);
     if (candidates === null)
@@ -724,41 +841,77 @@ matchesAnyInternal: function(location, contentType, docDomain, thirdParty, sitek
       candidates = [];
     }
     candidates.push("");
-    var blacklistHit = null;
     for (var i = 0, l = candidates.length; i < l; i++)
     {
       var substr = candidates[i];
-      if (substr in this.whitelist.filterByKeyword)
+      if (substr in whitelist.filterByKeyword)
       {
-        var result = this.whitelist._checkEntryMatch(substr, location, contentType, docDomain, thirdParty, sitekey);
+        var result = whitelist._checkEntryMatch(substr, location, contentType, docDomain, thirdParty, sitekey);
         if (result)
         {
           return result;
         }
       }
-      if (substr in this.blacklist.filterByKeyword && blacklistHit === null)
+      if (substr in blacklist.filterByKeyword && blacklistHit === null)
       {
-        blacklistHit = this.blacklist._checkEntryMatch(substr, location, contentType, docDomain, thirdParty, sitekey);
+        blacklistHit = blacklist._checkEntryMatch(substr, location, contentType, docDomain, thirdParty, sitekey);
       }
     }
     return blacklistHit;
   },
+_hostLocation: function(host)
+  {
+    return "http://" + (host.indexOf(":") >= 0 ? "[" + host + "]" : host) + "/";
+  },
+// A whitelist filter if one matches, else a blocking filter if one matches.
+// Which of the filters that match is returned is not defined.
+matchesAnyInternal: function(location, contentType, docDomain, thirdParty, sitekey)
+  {
+    var hostResult = this._matchesAnyIn(this.hostWhitelist, this.hostBlacklist, null, this._hostLocation(docDomain), contentType, docDomain, thirdParty, sitekey);
+    if (hostResult instanceof WhitelistFilter)
+    {
+      return hostResult;
+    }
+    return this._matchesAnyIn(this.whitelist, this.blacklist, hostResult, location, contentType, docDomain, thirdParty, sitekey);
+  },
+// docDomain has to be the host of location, as FindProxyForURL passes it.
 matchesAny: function(location, docDomain)
   {
-    var key = location + " " + docDomain + " ";
-    if (key in this.resultCache)
+    var cache = this.resultCache;
+    var key = "h " + docDomain;
+    var entry = cache.get(key);
+    var hostResult;
+    if (entry)
+    {
+      hostResult = entry.value;
+    }
+    else
+    {
+      hostResult = this._matchesAnyIn(this.hostWhitelist, this.hostBlacklist, null, this._hostLocation(docDomain), 0, docDomain, null, null);
+      cache.put(key, hostResult);
+    }
+    // Past a blocking host result only URL whitelist filters can change it.
+    if (hostResult instanceof WhitelistFilter || this.urlWhitelistCount == 0 && (hostResult || this.urlBlacklistCount == 0))
     {
-      return this.resultCache[key];
+      return hostResult;
     }
-    var result = this.matchesAnyInternal(location, 0, docDomain, null, null);
-    if (this.cacheEntries >= CombinedMatcher.maxCacheEntries)
+    key = "u " + location + " " + docDomain;
+    entry = cache.get(key);
+    var result;
+    if (entry)
     {
-      this.resultCache = createDict();
-      this.cacheEntries = 0;
+      result = entry.value;
+    }
+    else
+    {
+      result = this._matchesAnyIn(this.whitelist, this.blacklist, hostResult, location, 0, docDomain, null, null);
+      cache.put(key, result);
     }
-    this.resultCache[key] = result;
-    this.cacheEntries++;
     return result;
+  },
+cacheStats: function()
+  {
+    return this.resultCache.stats();
   }
 };
 var defaultMatcher = new CombinedMatcher();
@@ -769,8 +922,232 @@ for (var i = 0; i < rules.length; i++) {
   defaultMatcher.add(Filter.fromText(rules[i]));
 }
 
+// The index of the entry of a sorted prefix-free array which s starts with,
+// -1 if there is none.
+function prefixIndex(sorted, s)
+{
+  var lo = 0;
+  var hi = sorted.length - 1;
+  var found = -1;
+  while (lo <= hi)
+  {
+    var mid = (lo + hi) >> 1;
+    if (sorted[mid] <= s)
+    {
+      found = mid;
+      lo = mid + 1;
+    }
+    else
+    {
+      hi = mid - 1;
+    }
+  }
+  return found >= 0 && s.lastIndexOf(sorted[found], 0) == 0 ? found : -1;
+}
+
+// Whether the table has an entry for the URL. With explain, the entry written
+// as the rule it stands for, or null.
+function tableMatches(table, url, host, explain)
+{
+  // "||domain" matches at the start of the host or after any of its dots,
+  // without requiring the domain to end on a label boundary.
+  var p = 0;
+  var i;
+  while (true)
+  {
+    var rest = p > 0 ? host.substr(p) : host;
+    if (table.domains.length > 0 && (i = prefixIndex(table.domains, rest)) >= 0)
+    {
+      return explain ? "||" + table.domains[i] : true;
+    }
+    if (Object.prototype.hasOwnProperty.call(table.suffixes, rest))
+    {
+      return explain ? "||" + rest + "^" : true;
+    }
+    var nextDot = host.indexOf(".", p > 0 ? p : 1);
+    if (nextDot < 0)
+    {
+      break;
+    }
+    p = nextDot + 1;
+  }
+  if (table.prefixes.length > 0 && (i = prefixIndex(table.prefixes, url.toLowerCase())) >= 0)
+  {
+    return explain ? "|" + table.prefixes[i] : true;
+  }
+  // Only IP literals are looked up, names are never resolved.
+  if (table.ipv4.length > 0)
+  {
+    var v4 = ipv4Number(host);
+    if (v4 >= 0 && (i = rangeIndex(table.ipv4, v4)) >= 0)
+    {
+      return explain ? ipv4Text(table.ipv4[i << 1]) + "-" + ipv4Text(table.ipv4[(i << 1) + 1]) : true;
+    }
+  }
+  if (table.ipv6.length > 0 && host.indexOf(":") >= 0)
+  {
+    var v6 = ipv6Hex(host);
+    if (v6 !== null && (i = rangeIndex(table.ipv6, v6)) >= 0)
+    {
+      return explain ? ipv6Text(table.ipv6[i << 1]) + "-" + ipv6Text(table.ipv6[(i << 1) + 1]) : true;
+    }
+  }
+  return explain ? null : false;
+}
+
+// ranges is [first, last, first, last, ...], sorted and disjoint, of numbers
+// or of hex strings of the same length, which compare the same way. Returns
+// the index of the range holding address, -1 if none does.
+function rangeIndex(ranges, address)
+{
+  var lo = 0;
+  var hi = (ranges.length >> 1) - 1;
+  var found = -1;
+  while (lo <= hi)
+  {
+    var mid = (lo + hi) >> 1;
+    if (ranges[mid << 1] <= address)
+    {
+      found = mid;
+      lo = mid + 1;
+    }
+    else
+    {
+      hi = mid - 1;
+    }
+  }
+  return found >= 0 && address <= ranges[(found << 1) + 1] ? found : -1;
+}
+
+function ipv4Text(n)
+{
+  return [n >>> 24, (n >>> 16) & 255, (n >>> 8) & 255, n & 255].join(".");
+}
+
+function ipv6Text(hex)
+{
+  return hex.match(/.{4}/g).join(":");
+}
+
+var ipv4RegExp = /^(\d{1,3})\.(\d{1,3})\.(\d{1,3})\.(\d{1,3})$/;
+
+// The address of a dotted-quad host as a number, -1 for any other host.
+function ipv4Number(host)
+{
+  var match = ipv4RegExp.exec(host);
+  if (!match)
+  {
+    return -1;
+  }
+  var n = 0;
+  for (var i = 1; i <= 4; i++)
+  {
+    var b = parseInt(match[i], 10);
+    if (b > 255)
+    {
+      return -1;
+    }
+    n = n * 256 + b;
+  }
+  return n;
+}
+
+function hexGroup(n)
+{
+  return ("000" + n.toString(16)).slice(-4);
+}
+
+// The address of a lowercased IPv6 host, with or without brackets and zone,
+// as 32 hex digits. null if it is none.
+function ipv6Hex(host)
+{
+  if (host.charAt(0) == "[" && host.charAt(host.length - 1) == "]")
+  {
+    host = host.substring(1, host.length - 1);
+  }
+  var zone = host.indexOf("%");
+  if (zone >= 0)
+  {
+    host = host.substring(0, zone);
+  }
+  var halves = host.split("::");
+  if (halves.length > 2)
+  {
+    return null;
+  }
+  var groups = [[], []];
+  for (var h = 0; h < halves.length; h++)
+  {
+    if (halves[h] == "")
+    {
+      continue;
+    }
+    var parts = halves[h].split(":");
+    for (var i = 0; i < parts.length; i++)
+    {
+      if (h == halves.length - 1 && i == parts.length - 1 && parts[i].indexOf(".") >= 0)
+      {
+        var v4 = ipv4Number(parts[i]);
+        if (v4 < 0)
+        {
+          return null;
+        }
+        groups[h].push(hexGroup(Math.floor(v4 / 65536)), hexGroup(v4 % 65536));
+      }
+      else if (/^[0-9a-f]{1,4}$/.test(parts[i]))
+      {
+        groups[h].push(("000" + parts[i]).slice(-4));
+      }
+      else
+      {
+        return null;
+      }
+    }
+  }
+  var missing = 8 - groups[0].length - groups[1].length;
+  if (halves.length == 2 ? missing < 1 : missing != 0)
+  {
+    return null;
+  }
+  var zeros = "";
+  for (var z = 0; z < missing; z++)
+  {
+    zeros += "0000";
+  }
+  return groups[0].join("") + zeros + groups[1].join("");
+}
+
+// Debug hook for tools and tests evaluating the PAC; clients never call it.
+function PACCacheStats() {
+  return defaultMatcher.cacheStats();
+}
+
+// Debug hook for tools evaluating the PAC; clients never call it. The rule
+// deciding what FindProxyForURL returns, null if no rule matches and the URL
+// goes DIRECT. Table entries are written as the rules they stand for.
+function PACExplain(url, host) {
+  host = host.toLowerCase();
+  var entry = tableMatches(tables.direct, url, host, true);
+  if (entry !== null) {
+    return "@@" + entry;
+  }
+  var result = defaultMatcher.matchesAny(url, host);
+  if (result !== null) {
+    return result.text;
+  }
+  return tableMatches(tables.proxy, url, host, true);
+}
+
 function FindProxyForURL(url, host) {
-  if (defaultMatcher.matchesAny(url, host) instanceof BlockingFilter) {
+  host = host.toLowerCase();
+  if (tableMatches(tables.direct, url, host)) {
+    return direct;
+  }
+  var result = defaultMatcher.matchesAny(url, host);
+  if (result instanceof BlockingFilter) {
+    return proxy;
+  }
+  if (result === null && tableMatches(tables.proxy, url, host)) {
     return proxy;
   }
   return direct;
@@ -0,0 +1,181 @@
+//
+//  ServiceSupervisorTests.swift
+//  ShadowsocksX-NGTests
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import XCTest
+#if SWIFT_PACKAGE
+@testable import ShadowsocksXNGCore
+#else
+@testable import ShadowsocksX_NG
+#endif
+
+// ServiceSupervisor with stub programs instead of the launchctl scripts. Runs
+// on Linux too with swift test, see Package.swift.
+class ServiceSupervisorTests: XCTestCase {
+
+    // Exits with the status set for a script after delay, recording what ran.
+    final class StubLauncher: ProcessLauncher {
+        let delay: TimeInterval
+        var statuses: [String: Int32] = [:]
+        private let lock = NSLock()
+        private var running = 0
+        private(set) var runs: [String] = []
+        private(set) var maxRunning = 0
+
+        init(delay: TimeInterval) {
+            self.delay = delay
+        }
+
+        func run(_ launchPath: String, arguments: [String], completion: @escaping (Int32) -> Void) {
+            lock.lock()
+            runs.append(launchPath)
+            running += 1
+            maxRunning = max(maxRunning, running)
+            lock.unlock()
+            DispatchQueue.global().asyncAfter(deadline: .now() + delay) {
+                self.lock.lock()
+                self.running -= 1
+                let status = self.statuses[launchPath] ?? 0
+                self.lock.unlock()
+                completion(status)
+            }
+        }
+    }
+
+    let notificationCenter = NotificationCenter()
+    let stateChanged = Notification.Name("ServiceSupervisorTests.stateChanged")
+
+    func supervisor(_ launcher: ProcessLauncher) -> ServiceSupervisor {
+        return ServiceSupervisor(launcher: launcher, notificationCenter: notificationCenter
+            , notificationName: stateChanged, restartDelay: 0) {
+            $0
+        }
+    }
+
+    // The states posted for service, once the supervisor is idle.
+    func states(of service: ServiceSupervisor.Service, recording body: () -> Void) -> [String] {
+        var states: [String] = []
+        let observer = notificationCenter.addObserver(forName: stateChanged, object: nil
+            , queue: nil) { note in
+            if note.userInfo?[ServiceSupervisor.serviceKey] as? String == service.rawValue {
+                states.append(note.userInfo![ServiceSupervisor.stateKey] as! String)
+            }
+        }
+        body()
+        // Notifications are posted on the main queue.
+        let posted = expectation(description: "posted")
+        DispatchQueue.main.async {
+            posted.fulfill()
+        }
+        wait(for: [posted], timeout: 5)
+        notificationCenter.removeObserver(observer)
+        return states
+    }
+
+    func testServicesStartConcurrentlyWithoutBlocking() {
+        let launcher = StubLauncher(delay: 0.3)
+        let supervisor = self.supervisor(launcher)
+        let states = self.states(of: .ssLocal) {
+            let began = Date()
+            supervisor.start(.ssLocal)
+            supervisor.start(.privoxy)
+            XCTAssertLessThan(Date().timeIntervalSince(began), 0.1)
+            XCTAssertTrue(supervisor.waitUntilIdle(timeout: 5))
+        }
+        XCTAssertEqual(launcher.maxRunning, 2)
+        XCTAssertEqual(Set(launcher.runs), ["start_ss_local.sh", "start_privoxy.sh"])
+        XCTAssertEqual(states, ["starting", "running"])
+        XCTAssertEqual(supervisor.state(of: .ssLocal), .running)
+        XCTAssertEqual(supervisor.state(of: .privoxy), .running)
+    }
+
+    func testRequestsOfAServiceRunOneAtATime() {
+        let launcher = StubLauncher(delay: 0.1)
+        let supervisor = self.supervisor(launcher)
+        let states = self.states(of: .ssLocal) {
+            supervisor.restart(.ssLocal)
+            // Made while the restart runs, so only the last of them counts.
+            supervisor.stop(.ssLocal)
+            supervisor.start(.ssLocal)
+            supervisor.start(.ssLocal)
+            XCTAssertTrue(supervisor.waitUntilIdle(timeout: 5))
+        }
+        XCTAssertEqual(launcher.maxRunning, 1)
+        XCTAssertEqual(launcher.runs, ["stop_ss_local.sh", "start_ss_local.sh", "start_ss_local.sh"])
+        XCTAssertEqual(states, ["stopping", "stopped", "starting", "running", "starting", "running"])
+    }
+
+    func testWaitingRestartIsNotReplacedByStart() {
+        let launcher = StubLauncher(delay: 0.1)
+        let supervisor = self.supervisor(launcher)
+        supervisor.start(.privoxy)
+        supervisor.restart(.privoxy)
+        supervisor.start(.privoxy)
+        XCTAssertTrue(supervisor.waitUntilIdle(timeout: 5))
+        XCTAssertEqual(launcher.runs, ["start_privoxy.sh", "stop_privoxy.sh", "start_privoxy.sh"])
+    }
+
+    func testFailures() {
+        let launcher = StubLauncher(delay: 0)
+        launcher.statuses["start_ss_local.sh"] = 1
+        let supervisor = ServiceSupervisor(launcher: launcher, notificationCenter: notificationCenter
+            , notificationName: stateChanged) {
+            $0 == "stop_privoxy.sh" ? nil : $0
+        }
+        let states = self.states(of: .ssLocal) {
+            supervisor.start(.ssLocal)
+            supervisor.stop(.privoxy)
+            XCTAssertTrue(supervisor.waitUntilIdle(timeout: 5))
+        }
+        XCTAssertEqual(states, ["starting", "failed"])
+        XCTAssertEqual(supervisor.state(of: .ssLocal), .failed)
+        XCTAssertEqual(supervisor.state(of: .privoxy), .failed)
+        XCTAssertEqual(launcher.runs, ["start_ss_local.sh"])
+    }
+
+    // Real child processes, scripts standing in for the launchctl ones.
+    func testSystemProcessLauncher() throws {
+        let directory = NSTemporaryDirectory() + "ServiceSupervisorTests-\(UUID().uuidString)/"
+        try FileManager.default.createDirectory(atPath: directory, withIntermediateDirectories: true)
+        defer {
+            try? FileManager.default.removeItem(atPath: directory)
+        }
+        for (script, status) in [("start_ss_local.sh", 0), ("stop_ss_local.sh", 3)] {
+            try "#!/bin/sh\nsleep 0.2\nexit \(status)\n".write(toFile: directory + script, atomically: true
+                , encoding: .utf8)
+            try FileManager.default.setAttributes([.posixPermissions: 0o755], ofItemAtPath: directory + script)
+        }
+        let supervisor = ServiceSupervisor(launcher: SystemProcessLauncher(), notificationCenter: notificationCenter
+            , notificationName: stateChanged, restartDelay: 0) { directory + $0 }
+
+        supervisor.start(.ssLocal)
+        supervisor.start(.privoxy)  // Not an executable
+        XCTAssertTrue(supervisor.waitUntilIdle(timeout: 5))
+        XCTAssertEqual(supervisor.state(of: .ssLocal), .running)
+        XCTAssertEqual(supervisor.state(of: .privoxy), .failed)
+
+        var statuses: [Int32] = []
+        let observer = notificationCenter.addObserver(forName: stateChanged, object: nil
+            , queue: nil) { note in
+            if let status = note.userInfo?[ServiceSupervisor.statusKey] as? Int32 {
+                statuses.append(status)
+            }
+        }
+        defer {
+            notificationCenter.removeObserver(observer)
+        }
+        supervisor.stop(.ssLocal)
+        XCTAssertTrue(supervisor.waitUntilIdle(timeout: 5))
+        XCTAssertEqual(supervisor.state(of: .ssLocal), .failed)
+        let posted = expectation(description: "posted")
+        DispatchQueue.main.async {
+            posted.fulfill()
+        }
+        wait(for: [posted], timeout: 5)
+        XCTAssertEqual(statuses, [3])
+    }
+}
@@ -0,0 +1,234 @@
+//
+//  GCDWebServerConnectionTests.swift
+//  ShadowsocksX-NGTests
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import XCTest
+import GCDWebServer
+
+// Persistent connections of the PAC server, on a real loopback socket.
+class GCDWebServerConnectionTests: XCTestCase {
+
+    var server: GCDWebServer!
+    // Large enough for GCDWebServerFileResponse to map it.
+    let fileText = String(repeating: "0123456789abcdef", count: 20_000)
+    var filePath: String!
+
+    override func setUpWithError() throws {
+        filePath = NSTemporaryDirectory() + "GCDWebServerConnectionTests-\(UUID().uuidString).txt"
+        try fileText.write(toFile: filePath, atomically: true, encoding: .ascii)
+        server = GCDWebServer()
+        server.addHandler(forMethod: "GET", path: "/proxy.pac", request: GCDWebServerRequest.self) { _ in
+            return GCDWebServerDataResponse(text: "pac")
+        }
+        server.addHandler(forMethod: "POST", path: "/echo", request: GCDWebServerDataRequest.self) { request in
+            return GCDWebServerDataResponse(data: (request as! GCDWebServerDataRequest).data
+                , contentType: "application/octet-stream")
+        }
+        // Mapped, as the test owns the file and never changes it while served.
+        server.addHandler(forMethod: "GET", path: "/file", request: GCDWebServerRequest.self) { [filePath] request in
+            let response = request.hasByteRange()
+                ? GCDWebServerFileResponse(file: filePath!, byteRange: request.byteRange)
+                : GCDWebServerFileResponse(file: filePath!)
+            response?.mapsFile = true
+            return response
+        }
+        server.addHandler(forMethod: "GET", path: "/stream", request: GCDWebServerRequest.self) { _ in
+            var chunks = ["abc", "defgh"]
+            return GCDWebServerStreamedResponse(contentType: "text/plain") { _ in
+                return chunks.isEmpty ? Data() : Data(chunks.removeFirst().utf8)
+            }
+        }
+        try server.start(options: [
+            GCDWebServerOption_Port: 0,
+            GCDWebServerOption_BindToLocalhost: true,
+            GCDWebServerOption_ConnectionIdleTimeout: 1.0,
+            GCDWebServerOption_MaxRequestsPerConnection: 3,
+        ])
+    }
+
+    override func tearDownWithError() throws {
+        server.stop()
+        try? FileManager.default.removeItem(atPath: filePath)
+    }
+
+    // Writes request to a new connection, then reads until the server closes
+    // it, until the responses read so far satisfy done, or for 3 seconds.
+    func exchange(_ request: String, done: (String) -> Bool = { _ in false }) -> (String, closed: Bool) {
+        let fd = socket(AF_INET, SOCK_STREAM, 0)
+        XCTAssertGreaterThanOrEqual(fd, 0)
+        defer {
+            close(fd)
+        }
+        var timeout = timeval(tv_sec: 3, tv_usec: 0)
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, socklen_t(MemoryLayout<timeval>.size))
+        var address = sockaddr_in()
+        address.sin_family = sa_family_t(AF_INET)
+        address.sin_port = in_port_t(UInt16(server.port).bigEndian)
+        address.sin_addr.s_addr = inet_addr("127.0.0.1")
+        let connected = withUnsafePointer(to: &address) {
+            $0.withMemoryRebound(to: sockaddr.self, capacity: 1) {
+                connect(fd, $0, socklen_t(MemoryLayout<sockaddr_in>.size))
+            }
+        }
+        XCTAssertEqual(connected, 0)
+        let bytes = Array(request.utf8)
+        XCTAssertEqual(write(fd, bytes, bytes.count), bytes.count)
+
+        var received: [UInt8] = []
+        var buffer = [UInt8](repeating: 0, count: 4096)
+        while true {
+            let count = read(fd, &buffer, buffer.count)
+            if count <= 0 {
+                return (String(decoding: received, as: UTF8.self), closed: count == 0)
+            }
+            received += buffer[0..<count]
+            if done(String(decoding: received, as: UTF8.self)) {
+                return (String(decoding: received, as: UTF8.self), closed: false)
+            }
+        }
+    }
+
+    func count(_ string: String, in text: String) -> Int {
+        return text.components(separatedBy: string).count - 1
+    }
+
+    func testPipelinedRequests() {
+        let (text, closed) = exchange("GET /proxy.pac HTTP/1.1\r\nHost: localhost\r\n\r\n"
+            + "POST /echo HTTP/1.1\r\nHost: localhost\r\nContent-Length: 5\r\n\r\nhello"
+            + "GET /proxy.pac HTTP/1.1\r\nHost: localhost\r\n\r\n")
+        XCTAssertEqual(count("HTTP/1.1 200 OK", in: text), 3)
+        XCTAssertEqual(count("Connection: keep-alive", in: text), 2)
+        XCTAssertTrue(text.contains("Keep-Alive: timeout=1, max=2"))
+        XCTAssertTrue(text.contains("\r\n\r\nhello"))
+        // The third request reaches MaxRequestsPerConnection.
+        XCTAssertTrue(text.contains("Connection: Close\r\n"))
+        XCTAssertTrue(closed)
+    }
+
+    func testIdleTimeout() {
+        let start = Date()
+        let (text, closed) = exchange("GET /proxy.pac HTTP/1.1\r\nHost: localhost\r\n\r\n")
+        XCTAssertEqual(count("HTTP/1.1 200 OK", in: text), 1)
+        XCTAssertTrue(closed)
+        XCTAssertGreaterThanOrEqual(Date().timeIntervalSince(start), 0.9)
+    }
+
+    func testClosingRequests() {
+        let (closeText, closeClosed) = exchange(
+            "GET /proxy.pac HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n"
+            + "GET /proxy.pac HTTP/1.1\r\nHost: localhost\r\n\r\n")
+        XCTAssertEqual(count("HTTP/1.1 200 OK", in: closeText), 1)
+        XCTAssertTrue(closeText.contains("Connection: Close\r\n"))
+        XCTAssertTrue(closeClosed)
+
+        let (http10Text, http10Closed) = exchange("GET /proxy.pac HTTP/1.0\r\n\r\n")
+        XCTAssertTrue(http10Text.contains("Connection: Close\r\n"))
+        XCTAssertTrue(http10Closed)
+
+        let (keepAliveText, _) = exchange("GET /proxy.pac HTTP/1.0\r\nConnection: keep-alive\r\n\r\n") {
+            $0.hasSuffix("\r\n\r\npac")
+        }
+        XCTAssertTrue(keepAliveText.contains("Connection: keep-alive\r\n"))
+    }
+
+    // A request after a body which cannot be read must not be served, as the
+    // connection is no longer at the start of a request.
+    func testInvalidChunkedBody() {
+        for chunk in ["zz\r\n", "5\r\nhelloXX"] {
+            let (text, closed) = exchange("POST /echo HTTP/1.1\r\nHost: localhost\r\nTransfer-Encoding: chunked\r\n\r\n"
+                + chunk + "GET /proxy.pac HTTP/1.1\r\nHost: localhost\r\n\r\n")
+            XCTAssertTrue(text.hasPrefix("HTTP/1.1 400"), text)
+            XCTAssertTrue(text.contains("Connection: Close\r\n"))
+            XCTAssertFalse(text.contains("200 OK"))
+            XCTAssertTrue(closed)
+        }
+    }
+
+    func body(_ text: String) -> String? {
+        return text.range(of: "\r\n\r\n").map { String(text[$0.upperBound...]) }
+    }
+
+    func testFileResponses() {
+        let (text, closed) = exchange("GET /file HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n")
+        XCTAssertTrue(closed)
+        XCTAssertTrue(text.contains("Content-Length: \(fileText.utf8.count)\r\n"))
+        XCTAssertEqual(body(text), fileText)
+
+        // A range that starts within a page, past the first mapping.
+        let (rangeText, _) = exchange("GET /file HTTP/1.1\r\nHost: localhost\r\nRange: bytes=70001-\r\n"
+            + "Connection: close\r\n\r\n")
+        XCTAssertTrue(rangeText.hasPrefix("HTTP/1.1 206"))
+        XCTAssertEqual(body(rangeText), String(fileText.dropFirst(70001)))
+    }
+
+    func testChunkedResponse() {
+        let (text, closed) = exchange("GET /stream HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n")
+        XCTAssertTrue(closed)
+        XCTAssertTrue(text.contains("Transfer-Encoding: chunked\r\n"))
+        XCTAssertEqual(body(text), "3\r\nabc\r\n5\r\ndefgh\r\n0\r\n\r\n")
+    }
+
+    // Connections opened at once, all pending before any is accepted, are
+    // all served by the accept sources of a backlog large enough for them.
+    func testConnectionBurst() throws {
+        let burst = GCDWebServer()
+        burst.addHandler(forMethod: "GET", path: "/proxy.pac", request: GCDWebServerRequest.self) { _ in
+            return GCDWebServerDataResponse(text: "pac")
+        }
+        try burst.start(options: [
+            GCDWebServerOption_Port: 0,
+            GCDWebServerOption_BindToLocalhost: true,
+            GCDWebServerOption_MaxPendingConnections: 128,
+            GCDWebServerOption_AcceptSources: 4,
+            GCDWebServerOption_MaxConnectionsPerClient: 1,  // Loopback clients are not limited
+        ])
+        defer {
+            burst.stop()
+        }
+
+        let fds: [Int32] = (0..<100).map { _ in
+            let fd = socket(AF_INET, SOCK_STREAM, 0)
+            var timeout = timeval(tv_sec: 3, tv_usec: 0)
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, socklen_t(MemoryLayout<timeval>.size))
+            var address = sockaddr_in()
+            address.sin_family = sa_family_t(AF_INET)
+            address.sin_port = in_port_t(UInt16(burst.port).bigEndian)
+            address.sin_addr.s_addr = inet_addr("127.0.0.1")
+            let connected = withUnsafePointer(to: &address) {
+                $0.withMemoryRebound(to: sockaddr.self, capacity: 1) {
+                    connect(fd, $0, socklen_t(MemoryLayout<sockaddr_in>.size))
+                }
+            }
+            XCTAssertEqual(connected, 0)
+            return fd
+        }
+        defer {
+            fds.forEach { close($0) }
+        }
+        let request = Array("GET /proxy.pac HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n".utf8)
+        for fd in fds {
+            XCTAssertEqual(write(fd, request, request.count), request.count)
+        }
+        var served = 0
+        var buffer = [UInt8](repeating: 0, count: 4096)
+        for fd in fds {
+            var received: [UInt8] = []
+            while true {
+                let count = read(fd, &buffer, buffer.count)
+                if count <= 0 {
+                    break
+                }
+                received += buffer[0..<count]
+            }
+            let text = String(decoding: received, as: UTF8.self)
+            if text.hasPrefix("HTTP/1.1 200 OK") && text.hasSuffix("\r\n\r\npac") {
+                served += 1
+            }
+        }
+        XCTAssertEqual(served, fds.count)
+    }
+}
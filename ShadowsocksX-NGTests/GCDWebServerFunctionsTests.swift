@@ -0,0 +1,51 @@
+//
+//  GCDWebServerFunctionsTests.swift
+//  ShadowsocksX-NGTests
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import XCTest
+import GCDWebServer
+
+// The fixed-format dates of GCDWebServer against the NSDateFormatter it used.
+class GCDWebServerFunctionsTests: XCTestCase {
+
+    func formatter(_ format: String) -> DateFormatter {
+        let formatter = DateFormatter()
+        formatter.timeZone = TimeZone(abbreviation: "GMT")
+        formatter.dateFormat = format
+        formatter.locale = Locale(identifier: "en_US")
+        return formatter
+    }
+
+    func testDates() {
+        let rfc822 = formatter("EEE',' dd MMM yyyy HH':'mm':'ss 'GMT'")
+        let iso8601 = formatter("yyyy-MM-dd'T'HH:mm:ss'+00:00'")
+        var seconds: TimeInterval = -86_400 * 365
+        while seconds < 4_102_444_800 {  // 2100
+            let date = Date(timeIntervalSince1970: seconds + 0.75)
+            let whole = Date(timeIntervalSince1970: seconds)
+            XCTAssertEqual(GCDWebServerFormatRFC822(date), rfc822.string(from: date))
+            XCTAssertEqual(GCDWebServerFormatISO8601(date), iso8601.string(from: date))
+            XCTAssertEqual(GCDWebServerParseRFC822(rfc822.string(from: date)), whole)
+            XCTAssertEqual(GCDWebServerParseISO8601(iso8601.string(from: date)), whole)
+            seconds += 7_777_777
+        }
+        XCTAssertEqual(GCDWebServerFormatRFC822(Date(timeIntervalSince1970: 784_111_777)), "Sun, 06 Nov 1994 08:49:37 GMT")
+        XCTAssertNil(GCDWebServerParseRFC822("Sun, 06 Nov 1994 08:49:37 GMT garbage"))
+        XCTAssertNil(GCDWebServerParseISO8601("1994-13-06T08:49:37+00:00"))
+    }
+
+    func testMimeTypes() {
+        XCTAssertEqual(GCDWebServerGetMimeTypeForExtension("CSS", nil), "text/css")
+        XCTAssertEqual(GCDWebServerGetMimeTypeForExtension("pac", nil), "application/x-ns-proxy-autoconfig")
+        XCTAssertEqual(GCDWebServerGetMimeTypeForExtension("png", nil), "image/png")
+        XCTAssertEqual(GCDWebServerGetMimeTypeForExtension("png", ["png": "image/x-test"]), "image/x-test")
+        // Cached, either way.
+        XCTAssertEqual(GCDWebServerGetMimeTypeForExtension("png", nil), "image/png")
+        XCTAssertEqual(GCDWebServerGetMimeTypeForExtension("no-such-extension", nil), "application/octet-stream")
+        XCTAssertEqual(GCDWebServerGetMimeTypeForExtension("no-such-extension", nil), "application/octet-stream")
+    }
+}
@@ -0,0 +1,156 @@
+//
+//  GCDWebServerRoutingTests.swift
+//  ShadowsocksX-NGTests
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import XCTest
+import GCDWebServer
+
+// Handler dispatch of GCDWebServer: exact method and path handlers are found
+// by lookup, and must still lose to any handler added after them.
+class GCDWebServerRoutingTests: XCTestCase {
+
+    var server: GCDWebServer!
+
+    override func setUp() {
+        server = GCDWebServer()
+    }
+
+    override func tearDown() {
+        if server.isRunning {
+            server.stop()
+        }
+    }
+
+    func start() throws {
+        try server.start(options: [
+            GCDWebServerOption_Port: 0,
+            GCDWebServerOption_BindToLocalhost: true,
+            GCDWebServerOption_MaxRequestsPerConnection: 1_000_000,
+        ])
+    }
+
+    func addText(_ text: String, path: String, method: String = "GET") {
+        server.addHandler(forMethod: method, path: path, request: GCDWebServerRequest.self) { _ in
+            return GCDWebServerDataResponse(text: text)
+        }
+    }
+
+    func addText(_ text: String, pathRegex: String) {
+        server.addHandler(forMethod: "GET", pathRegex: pathRegex, request: GCDWebServerRequest.self) { _ in
+            return GCDWebServerDataResponse(text: text)
+        }
+    }
+
+    // Sends GET requests for paths on one connection, the last one closing
+    // it, and returns everything the server sent back.
+    func get(_ paths: [String]) -> String {
+        let fd = socket(AF_INET, SOCK_STREAM, 0)
+        defer {
+            close(fd)
+        }
+        var timeout = timeval(tv_sec: 10, tv_usec: 0)
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, socklen_t(MemoryLayout<timeval>.size))
+        var address = sockaddr_in()
+        address.sin_family = sa_family_t(AF_INET)
+        address.sin_port = in_port_t(UInt16(server.port).bigEndian)
+        address.sin_addr.s_addr = inet_addr("127.0.0.1")
+        let connected = withUnsafePointer(to: &address) {
+            $0.withMemoryRebound(to: sockaddr.self, capacity: 1) {
+                connect(fd, $0, socklen_t(MemoryLayout<sockaddr_in>.size))
+            }
+        }
+        XCTAssertEqual(connected, 0)
+        let requests = paths.enumerated().map { index, path in
+            "GET \(path) HTTP/1.1\r\nHost: localhost\r\n"
+                + (index == paths.count - 1 ? "Connection: close\r\n" : "") + "\r\n"
+        }
+        let bytes = Array(requests.joined().utf8)
+        var written = 0
+        while written < bytes.count {
+            let count = bytes[written...].withUnsafeBufferPointer { write(fd, $0.baseAddress, $0.count) }
+            XCTAssertGreaterThan(count, 0)
+            guard count > 0 else {
+                break
+            }
+            written += count
+        }
+
+        var received: [UInt8] = []
+        var buffer = [UInt8](repeating: 0, count: 65536)
+        while true {
+            let count = read(fd, &buffer, buffer.count)
+            if count <= 0 {
+                return String(decoding: received, as: UTF8.self)
+            }
+            received += buffer[0..<count]
+        }
+    }
+
+    func body(_ response: String) -> String? {
+        return response.range(of: "\r\n\r\n").map { String(response[$0.upperBound...]) }
+    }
+
+    func testExactHandlerPrecedence() throws {
+        server.addDefaultHandler(forMethod: "GET", request: GCDWebServerRequest.self) { _ in
+            return GCDWebServerDataResponse(text: "default")
+        }
+        addText("exact a", path: "/a")
+        addText("regex a", pathRegex: "^/a$")
+        addText("regex b", pathRegex: "^/b$")
+        addText("exact b", path: "/b")
+        addText("exact b again", path: "/B")
+        addText("post c", path: "/c", method: "POST")
+        addText("exact é", path: "/é")
+        try start()
+
+        let expected = [
+            "/a": "regex a",
+            "/b": "exact b again",
+            "/b?query=1": "exact b again",
+            "/c": "default",
+            "/%C3%A9": "exact é",
+            "/missing": "default",
+        ]
+        for (path, text) in expected {
+            XCTAssertEqual(body(get([path])), text, path)
+        }
+    }
+
+    // Time to serve one request, pipelined on a persistent connection, with
+    // count regex handlers then count exact handlers added, so the cost of
+    // dispatch shows as count grows. "/regex/0" runs every match block, as
+    // "/exact/0" did before exact handlers were looked up.
+    func dispatchMicroseconds(handlers count: Int, path: String, requests: Int = 500) throws -> Double {
+        server = GCDWebServer()
+        for i in 0..<count {
+            addText("regex \(i)", pathRegex: "^/regex/\(i)$")
+        }
+        for i in 0..<count {
+            addText("exact \(i)", path: "/exact/\(i)")
+        }
+        try start()
+        _ = get([path])  // Warms up
+        let began = Date()
+        let text = get(Array(repeating: path, count: requests))
+        let elapsed = Date().timeIntervalSince(began)
+        XCTAssertEqual(text.components(separatedBy: "HTTP/1.1 200 OK").count - 1, requests, path)
+        server.stop()
+        return elapsed * 1e6 / Double(requests)
+    }
+
+    func testDispatchCostAgainstHandlerCount() throws {
+        var lines = ["handlers   /exact/0 us/req   /regex/0 us/req"]
+        for count in [1, 10, 100, 1000] {
+            let exact = try dispatchMicroseconds(handlers: count, path: "/exact/0")
+            let regex = try dispatchMicroseconds(handlers: count, path: "/regex/0")
+            lines.append(String(format: "%8d %17.1f %17.1f", count, exact, regex))
+        }
+        let report = lines.joined(separator: "\n")
+        print(report)
+        add(XCTAttachment(string: report))
+    }
+}
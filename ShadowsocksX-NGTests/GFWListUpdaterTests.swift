@@ -0,0 +1,146 @@
+//
+//  GFWListUpdaterTests.swift
+//  ShadowsocksX-NGTests
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import XCTest
+import GCDWebServer
+@testable import ShadowsocksX_NG
+
+// Runs GFWListUpdater against a GCDWebServer on localhost standing in for
+// the gfwlist host. GCDWebServer answers 304 by itself when the request
+// validators match the response's eTag.
+class GFWListUpdaterTests: XCTestCase {
+
+    let suiteName = "GFWListUpdaterTests"
+    let userRules = Data("||google.com\n@@||example.org".utf8)
+
+    var server: GCDWebServer!
+    var defaults: UserDefaults!
+    var url: String!
+    var gfwlist = Data()
+    var eTag: String? = "\"1\""
+    var ifNoneMatch: [String?] = []
+
+    override func setUpWithError() throws {
+        defaults = try XCTUnwrap(UserDefaults(suiteName: suiteName))
+        defaults.removePersistentDomain(forName: suiteName)
+        gfwlist = Data(makeSyntheticGFWList(ruleCount: 2000).utf8)
+
+        server = GCDWebServer()
+        server.addHandler(forMethod: "GET", path: "/gfwlist.txt", request: GCDWebServerRequest.self) {
+            [unowned self] request in
+            DispatchQueue.main.sync {
+                self.ifNoneMatch.append(request.ifNoneMatch)
+            }
+            let response = GCDWebServerDataResponse(data: self.gfwlist, contentType: "text/plain")
+            response.eTag = self.eTag
+            return response
+        }
+        try server.start(options: [
+            GCDWebServerOption_BindToLocalhost: true,
+            GCDWebServerOption_Port: 0,
+        ])
+        url = "http://127.0.0.1:\(server.port)/gfwlist.txt"
+    }
+
+    override func tearDownWithError() throws {
+        server.stop()
+        defaults.removePersistentDomain(forName: suiteName)
+    }
+
+    func update(_ updater: GFWListUpdater, useValidators: Bool = true) -> GFWListUpdater.Result {
+        let done = expectation(description: "update")
+        var result = GFWListUpdater.Result.failed
+        updater.update(useValidators: useValidators) {
+            result = $0
+            done.fulfill()
+        }
+        wait(for: [done], timeout: 10)
+        return result
+    }
+
+    func download(_ updater: GFWListUpdater, useValidators: Bool = true) -> GFWListUpdater.Download? {
+        if case .downloaded(let download) = update(updater, useValidators: useValidators) {
+            return download
+        }
+        return nil
+    }
+
+    func testDownloadThenNotModified() throws {
+        let updater = GFWListUpdater(url: url, userRules: userRules, defaults: defaults)
+        let download = try XCTUnwrap(self.download(updater))
+        XCTAssertEqual(download.list, gfwlist)
+        XCTAssertEqual(download.etag, "\"1\"")
+        let expected = try XCTUnwrap(PACRuleSet(gfwlist: gfwlist, userRules: userRules))
+        XCTAssertEqual(download.ruleSet.rules, expected.rules)
+        XCTAssertEqual(download.ruleSet.report.summary, expected.report.summary)
+
+        updater.commit(download)
+        guard case .notModified = update(updater) else {
+            return XCTFail("not 304")
+        }
+
+        // The validators outlive the updater.
+        eTag = "\"2\""
+        let next = GFWListUpdater(url: url, userRules: userRules, defaults: defaults)
+        XCTAssertEqual(try XCTUnwrap(self.download(next)).etag, "\"2\"")
+        XCTAssertEqual(ifNoneMatch, [nil, "\"1\"", "\"1\""])
+    }
+
+    func testValidatorsAreNotSentWithoutLocalCopyOrForOtherURL() throws {
+        let updater = GFWListUpdater(url: url, userRules: nil, defaults: defaults)
+        updater.commit(try XCTUnwrap(download(updater)))
+
+        XCTAssertNotNil(download(updater, useValidators: false))
+        let other = GFWListUpdater(url: url + "?mirror", userRules: nil, defaults: defaults)
+        XCTAssertNotNil(download(other))
+        XCTAssertEqual(ifNoneMatch, [nil, nil, nil])
+        _ = update(updater, useValidators: true)
+        XCTAssertEqual(ifNoneMatch.last, "\"1\"")
+    }
+
+    func testInvalidBase64Fails() {
+        gfwlist = Data("<html>Not Found</html>=abc".utf8)
+        let updater = GFWListUpdater(url: url, userRules: nil, defaults: defaults)
+        guard case .failed = update(updater) else {
+            return XCTFail("not failed")
+        }
+    }
+
+    func testMissingFileFails() {
+        let updater = GFWListUpdater(url: url + ".missing", userRules: nil, defaults: defaults)
+        guard case .failed = update(updater) else {
+            return XCTFail("not failed")
+        }
+    }
+
+    // Chunk boundaries may fall inside a base64 quantum, a line or a
+    // multi-byte newline.
+    func testChunkedDecodeMatchesWholeDecode() throws {
+        let lines = ["[AutoProxy 0.2.9]", "||a.com", "中文.com", "|http://b.com/"].joined(separator: "\u{2028}")
+            + "\r\n@@||c.com\u{85}.d.org\n"
+        let data = Data(("\u{FEFF}" + lines).utf8).base64EncodedData(options: .lineLength64Characters)
+        let expected = try XCTUnwrap(PACRuleSet(gfwlist: data, userRules: userRules)).rules
+
+        for chunkSize in [1, 2, 3, 5, 64, data.count] {
+            var decoder = Base64Decoder()
+            var splitter = LineSplitter()
+            var ruleSet = PACRuleSet(userRules: userRules)
+            var decoded = [UInt8]()
+            for start in stride(from: 0, to: data.count, by: chunkSize) {
+                decoded.removeAll()
+                XCTAssertTrue(decoder.decode(data[start..<min(start + chunkSize, data.count)], to: &decoded))
+                splitter.feed(decoded) { ruleSet.addGFWListLine($0) }
+            }
+            decoded.removeAll()
+            XCTAssertTrue(decoder.finish(to: &decoded))
+            splitter.feed(decoded) { ruleSet.addGFWListLine($0) }
+            splitter.finish { ruleSet.addGFWListLine($0) }
+            XCTAssertEqual(ruleSet.rules, expected, "chunk size \(chunkSize)")
+        }
+    }
+}
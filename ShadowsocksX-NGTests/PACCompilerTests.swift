@@ -0,0 +1,173 @@
+//
+//  PACCompilerTests.swift
+//  ShadowsocksX-NGTests
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import XCTest
+@testable import ShadowsocksX_NG
+
+// The string pipeline GeneratePACFile() used before PACCompiler, kept as the
+// reference the compiler output must be byte-identical to. PACRuleSet also
+// drops repeated rules, which the Matcher in abp.js ignored anyway.
+func legacyGeneratePAC(gfwlist: String, userRuleStr: String?, template: String
+    , socks5Address: String, socks5Port: Int, deduplicate: Bool = true) -> Data? {
+    guard let data = Data(base64Encoded: gfwlist, options: .ignoreUnknownCharacters) else {
+        return nil
+    }
+    let str = String(data: data, encoding: String.Encoding.utf8)
+    var lines = str!.components(separatedBy: CharacterSet.newlines)
+
+    if let userRuleStr = userRuleStr {
+        let userRuleLines = userRuleStr.components(separatedBy: CharacterSet.newlines)
+
+        lines = userRuleLines + lines.filter { (line) in
+            var i = line.startIndex
+            while i < line.endIndex {
+                if line[i] == "@" || line[i] == "|" {
+                    i = line.index(after: i)
+                    continue
+                }
+                break
+            }
+            if i == line.startIndex {
+                return !userRuleLines.contains(line)
+            }
+            return !userRuleLines.contains(String(line[i...]))
+        }
+    }
+
+    lines = lines.filter({ (s: String) -> Bool in
+        if s.isEmpty {
+            return false
+        }
+        let c = s[s.startIndex]
+        if c == "!" || c == "[" {
+            return false
+        }
+        return true
+    })
+
+    if deduplicate {
+        var seen = Set<String>()
+        lines = lines.filter { seen.insert($0).inserted }
+    }
+
+    let rulesJsonData = try! JSONSerialization.data(withJSONObject: lines, options: .prettyPrinted)
+    let rulesJsonStr = String(data: rulesJsonData, encoding: String.Encoding.utf8)!
+
+    var jsStr = template.replacingOccurrences(of: "__RULES__", with: rulesJsonStr)
+    jsStr = jsStr.replacingOccurrences(of: "__TABLES__", with: emptyDomainTablesJS)
+    jsStr = jsStr.replacingOccurrences(of: "__SOCKS5PORT__", with: "\(socks5Port)")
+    if socks5Address.contains(":") {
+        jsStr = jsStr.replacingOccurrences(of: "__SOCKS5ADDR__", with: "[\(socks5Address)]")
+    } else {
+        jsStr = jsStr.replacingOccurrences(of: "__SOCKS5ADDR__", with: socks5Address)
+    }
+    return jsStr.data(using: String.Encoding.utf8)
+}
+
+let emptyDomainTablesJS = "{\"proxy\":{\"domains\":[],\"suffixes\":{},\"prefixes\":[],\"ipv4\":[],\"ipv6\":[]}"
+    + ",\"direct\":{\"domains\":[],\"suffixes\":{},\"prefixes\":[],\"ipv4\":[],\"ipv6\":[]}}"
+
+// Synthetic gfwlist in the shape of the real one: mostly "||domain" rules,
+// some "|http://" anchors, keywords, whitelists and regexes.
+func makeSyntheticGFWList(ruleCount: Int) -> String {
+    var lines = ["[AutoProxy 0.2.9]", "! Title: Synthetic", "!"]
+    lines.reserveCapacity(ruleCount + 3)
+    for i in 0..<ruleCount {
+        switch i % 10 {
+        case 0, 1, 2, 3, 4, 5:
+            lines.append("||site\(i).example\(i % 97).com")
+        case 6:
+            lines.append("|http://www.host\(i).net/path/\(i)")
+        case 7:
+            lines.append(".keyword\(i).org")
+        case 8:
+            lines.append("@@||direct\(i).cn")
+        default:
+            lines.append("/^https?:\\/\\/[^\\/]+regex\(i)\\.io/")
+        }
+    }
+    return Data(lines.joined(separator: "\n").utf8).base64EncodedString(options: .lineLength64Characters)
+}
+
+class PACCompilerTests: XCTestCase {
+
+    var templateString: String!
+    var compiler: PACCompiler!
+
+    override func setUpWithError() throws {
+        let url = try XCTUnwrap(Bundle.main.url(forResource: "abp", withExtension: "js"))
+        let data = try Data(contentsOf: url)
+        templateString = String(data: data, encoding: .utf8)
+        compiler = PACCompiler(template: PACTemplate(data: data))
+    }
+
+    func assertIdenticalToLegacy(gfwlist: String, userRules: String?
+        , socks5Address: String = "127.0.0.1", socks5Port: Int = 1086
+        , file: StaticString = #file, line: UInt = #line) {
+        let expected = legacyGeneratePAC(gfwlist: gfwlist, userRuleStr: userRules, template: templateString
+            , socks5Address: socks5Address, socks5Port: socks5Port)
+        let actual = compiler.compile(gfwlist: Data(gfwlist.utf8), userRules: userRules.map { Data($0.utf8) }
+            , socks5Address: socks5Address, socks5Port: socks5Port)
+        XCTAssertNotNil(actual, file: file, line: line)
+        XCTAssertEqual(actual, expected, file: file, line: line)
+    }
+
+    func testBundledGFWListIsByteIdentical() throws {
+        let gfwlistPath = try XCTUnwrap(Bundle.main.path(forResource: "gfwlist", ofType: "txt"))
+        let userRulePath = try XCTUnwrap(Bundle.main.path(forResource: "user-rule", ofType: "txt"))
+        let gfwlist = try String(contentsOfFile: gfwlistPath, encoding: .utf8)
+        let userRules = try String(contentsOfFile: userRulePath, encoding: .utf8)
+
+        assertIdenticalToLegacy(gfwlist: gfwlist, userRules: userRules)
+        assertIdenticalToLegacy(gfwlist: gfwlist, userRules: nil)
+        assertIdenticalToLegacy(gfwlist: gfwlist, userRules: userRules, socks5Address: "::1", socks5Port: 1080)
+    }
+
+    func testUserRulesOverrideAndEscaping() {
+        let rules = [
+            "||google.com",
+            "@@||baidu.com",
+            "|http://example.com/a\"b\\c",
+            "\tkeyword",
+            "中文.com",
+            "",
+            "! comment",
+        ].joined(separator: "\r\n")
+        let gfwlist = Data(rules.utf8).base64EncodedString()
+        let userRules = "! mine\ngoogle.com\nbaidu.com\n||twitter.com\u{2028}||facebook.com"
+
+        assertIdenticalToLegacy(gfwlist: gfwlist, userRules: userRules)
+    }
+
+    func testEmptyRules() {
+        assertIdenticalToLegacy(gfwlist: "", userRules: "! only comments")
+    }
+
+    func testInvalidBase64() {
+        XCTAssertNil(compiler.compile(gfwlist: Data("abcde".utf8), userRules: nil
+            , socks5Address: "127.0.0.1", socks5Port: 1086))
+    }
+
+    func testPerformanceCompile100kRules() {
+        let gfwlist = Data(makeSyntheticGFWList(ruleCount: 100_000).utf8)
+        let userRules = Data((0..<1000).map { "||user\($0).example.com" }.joined(separator: "\n").utf8)
+        measure {
+            _ = compiler.compile(gfwlist: gfwlist, userRules: userRules
+                , socks5Address: "127.0.0.1", socks5Port: 1086)
+        }
+    }
+
+    func testPerformanceLegacy100kRules() {
+        let gfwlist = makeSyntheticGFWList(ruleCount: 100_000)
+        let userRules = (0..<1000).map { "||user\($0).example.com" }.joined(separator: "\n")
+        measure {
+            _ = legacyGeneratePAC(gfwlist: gfwlist, userRuleStr: userRules, template: templateString
+                , socks5Address: "127.0.0.1", socks5Port: 1086, deduplicate: false)
+        }
+    }
+}
@@ -0,0 +1,92 @@
+//
+//  PACDomainTablesTests.swift
+//  ShadowsocksX-NGTests
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import XCTest
+@testable import ShadowsocksX_NG
+
+class PACDomainTablesTests: XCTestCase {
+
+    func testPartition() {
+        let rules = [
+            "||google.com",
+            "||Mail.Google.com",
+            "||twitter.com^",
+            "@@||baidu.com",
+            "|http://example.com/path",
+            "|http://example.com/path/more",
+            "|https://example.com/*.js",
+            "||example.org/path",
+            "||example.net$third-party",
+            ".keyword.com",
+            "/^https?:\\/\\/[^\\/]+example\\.io/",
+        ].map { PACRule(text: $0) }
+
+        let tables = PACDomainTables(rules: rules)
+
+        XCTAssertEqual(tables.proxy.domains, ["google.com"])
+        XCTAssertEqual(tables.proxy.suffixes, ["twitter.com"])
+        XCTAssertEqual(tables.proxy.prefixes, ["http://example.com/path"])
+        XCTAssertEqual(tables.direct.domains, ["baidu.com"])
+        XCTAssertEqual(tables.runtimeRules.map { $0.text }, [
+            "|https://example.com/*.js",
+            "||example.org/path",
+            "||example.net$third-party",
+            ".keyword.com",
+            "/^https?:\\/\\/[^\\/]+example\\.io/",
+        ])
+    }
+
+    func testWriteTables() {
+        let tables = PACDomainTables(rules: ["||a.com", "||b.com^", "@@|http://c.com/"].map { PACRule(text: $0) })
+        var out = [UInt8]()
+        tables.write(to: &out)
+        XCTAssertEqual(String(decoding: out, as: UTF8.self)
+            , "{\"proxy\":{\"domains\":[\"a.com\"],\"suffixes\":{\"b.com\":1},\"prefixes\":[],\"ipv4\":[],\"ipv6\":[]}"
+            + ",\"direct\":{\"domains\":[],\"suffixes\":{},\"prefixes\":[\"http:\\/\\/c.com\\/\"],\"ipv4\":[],\"ipv6\":[]}}")
+
+        out.removeAll()
+        PACDomainTables.empty.write(to: &out)
+        XCTAssertEqual(String(decoding: out, as: UTF8.self), emptyDomainTablesJS)
+    }
+
+    func testIPRanges() {
+        let rules = [
+            "10.0.0.0/8",
+            "10.1.0.0/16",
+            "203.0.113.7/24",
+            "@@192.168.0.0/16",
+            "2001:db8::/32",
+            "@@fd00::/8",
+            "69.65.19.160",
+            "10.0.0.0/33",
+            "example.com/24",
+            "10.0.0.0/8$image",
+        ].map { PACRule(text: $0) }
+
+        let tables = PACDomainTables(rules: rules)
+        XCTAssertEqual(tables.proxy.ranges.count, 3)
+        XCTAssertEqual(tables.direct.ranges.count, 2)
+        XCTAssertEqual(tables.runtimeRules.map { $0.text }, ["69.65.19.160", "10.0.0.0/33", "example.com/24"
+            , "10.0.0.0/8$image"])
+        XCTAssertEqual(PACDomainTables(ipRangesOf: rules).runtimeRules.count, 4)
+
+        var out = [UInt8]()
+        tables.write(to: &out)
+        XCTAssertEqual(String(decoding: out, as: UTF8.self)
+            , "{\"proxy\":{\"domains\":[],\"suffixes\":{},\"prefixes\":[],\"ipv4\":[167772160,184549375,3405803776,3405804031]"
+            + ",\"ipv6\":[\"20010db8000000000000000000000000\",\"20010db8ffffffffffffffffffffffff\"]}"
+            + ",\"direct\":{\"domains\":[],\"suffixes\":{},\"prefixes\":[],\"ipv4\":[3232235520,3232301055]"
+            + ",\"ipv6\":[\"fd000000000000000000000000000000\",\"fdffffffffffffffffffffffffffffff\"]}}")
+
+        let range = PACIPRange(rule: PACRule(text: "2001:db8::/32"))!
+        XCTAssertTrue(range.contains(PACIPRange.address("[2001:db8::1%en0]")!))
+        XCTAssertFalse(range.contains(PACIPRange.address("2001:db9::1")!))
+        XCTAssertFalse(range.contains(PACIPRange.address("32.1.13.184")!))
+        XCTAssertNil(PACIPRange.address("example.com"))
+    }
+}
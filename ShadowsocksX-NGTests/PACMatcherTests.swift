@@ -0,0 +1,158 @@
+//
+//  PACMatcherTests.swift
+//  ShadowsocksX-NGTests
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import XCTest
+import JavaScriptCore
+@testable import ShadowsocksX_NG
+
+class PACMatcherTests: XCTestCase {
+
+    func makeMatcher(_ texts: [String]) -> PACMatcher {
+        return PACMatcher(rules: texts.map { PACRule(text: $0) })
+    }
+
+    func bundledRules() throws -> [PACRule] {
+        let gfwlistPath = try XCTUnwrap(Bundle.main.path(forResource: "gfwlist", ofType: "txt"))
+        let userRulePath = try XCTUnwrap(Bundle.main.path(forResource: "user-rule", ofType: "txt"))
+        let gfwlist = try XCTUnwrap(FileManager.default.contents(atPath: gfwlistPath))
+        let userRules = FileManager.default.contents(atPath: userRulePath)
+        return try XCTUnwrap(PACRuleSet(gfwlist: gfwlist, userRules: userRules)).rules
+    }
+
+    func testDecisions() {
+        let matcher = makeMatcher([
+            "||example.com",
+            "@@||cn.example.com",
+            "|http://start.org/path",
+            "keyword",
+            "sep.net^",
+            "end.io|",
+            "Case.org/A$match-case",
+            "||limited.net$domain=a.limited.net|~b.a.limited.net",
+            "/^https?:\\/\\/[^\\/]+\\.regex\\.org/",
+            "||unknown.net$no-such-option",
+            "||sitekey.net$sitekey=abc",
+            "||image.net$image,third-party",
+            "10.0.0.0/8",
+            "@@10.1.0.0/16",
+        ])
+        XCTAssertEqual(matcher.ruleCount, 13)
+
+        XCTAssertEqual(matcher.decision(for: "https://www.example.com/"), .proxy(rule: "||example.com"))
+        XCTAssertEqual(matcher.decision(for: "https://example.com.hk/"), .proxy(rule: "||example.com"))
+        XCTAssertEqual(matcher.decision(for: "https://www.cn.example.com/"), .direct(rule: "@@||cn.example.com"))
+        XCTAssertEqual(matcher.decision(for: "https://notexample.com/"), .direct(rule: nil))
+        XCTAssertEqual(matcher.decision(for: "http://START.org/path/a"), .proxy(rule: "|http://start.org/path"))
+        XCTAssertEqual(matcher.decision(for: "https://start.org/path"), .direct(rule: nil))
+        XCTAssertEqual(matcher.decision(for: "http://a.b/some-keyword-path"), .proxy(rule: "keyword"))
+        XCTAssertEqual(matcher.decision(for: "http://sep.net/"), .proxy(rule: "sep.net^"))
+        XCTAssertEqual(matcher.decision(for: "http://sep.net"), .proxy(rule: "sep.net^"))
+        XCTAssertEqual(matcher.decision(for: "http://sep.network/"), .direct(rule: nil))
+        XCTAssertEqual(matcher.decision(for: "http://a.b/end.io"), .proxy(rule: "end.io|"))
+        XCTAssertEqual(matcher.decision(for: "http://end.io/"), .direct(rule: nil))
+        XCTAssertEqual(matcher.decision(for: "http://Case.org/A"), .proxy(rule: "Case.org/A$match-case"))
+        XCTAssertEqual(matcher.decision(for: "http://case.org/A"), .direct(rule: nil))
+        XCTAssertEqual(matcher.decision(for: "http://x.a.limited.net/").isProxy, true)
+        XCTAssertEqual(matcher.decision(for: "http://x.b.a.limited.net/").isProxy, false)
+        XCTAssertEqual(matcher.decision(for: "http://limited.net/").isProxy, false)
+        XCTAssertEqual(matcher.decision(for: "https://www.regex.org/").isProxy, true)
+        XCTAssertEqual(matcher.decision(for: "http://unknown.net/").isProxy, false)
+        XCTAssertEqual(matcher.decision(for: "http://sitekey.net/").isProxy, false)
+        XCTAssertEqual(matcher.decision(for: "http://image.net/").isProxy, true)
+        XCTAssertEqual(matcher.decision(for: "http://10.2.3.4:8080/"), .proxy(rule: "10.0.0.0/8"))
+        XCTAssertEqual(matcher.decision(for: "http://10.1.3.4/"), .direct(rule: "@@10.1.0.0/16"))
+        XCTAssertEqual(matcher.decision(for: "http://example.org/10.0.0.0/8"), .direct(rule: nil))
+    }
+
+    func testHost() {
+        XCTAssertEqual(PACMatcher.host(of: "https://user:pw@www.example.com:8443/a?b#c"), "www.example.com")
+        XCTAssertEqual(PACMatcher.host(of: "http://[2001:db8::1]:80/"), "2001:db8::1")
+        XCTAssertEqual(PACMatcher.host(of: "http://example.com"), "example.com")
+    }
+
+    func testAhoCorasick() {
+        let strings = ["he", "she", "his", "hers"].map { Array($0.utf8) }
+        let automaton = AhoCorasick(strings)
+        var found: [String] = []
+        automaton.forEachMatch(in: Array("ushers".utf8)) { i in
+            found.append(String(decoding: strings[i], as: UTF8.self))
+            return true
+        }
+        XCTAssertEqual(found, ["she", "he", "hers"])
+
+        var first: [Int] = []
+        automaton.forEachMatch(in: Array("ushers".utf8)) { i in
+            first.append(i)
+            return false
+        }
+        XCTAssertEqual(first, [1])
+    }
+
+    // The matcher and the PAC it stands for, evaluated by JavaScriptCore as
+    // clients do, agree on every URL of a corpus derived from the rules.
+    func testAgreesWithPAC() throws {
+        let rules = try bundledRules()
+        let matcher = PACMatcher(rules: rules)
+        let template = try XCTUnwrap(PACTemplate.bundled)
+
+        var hosts: [String] = []
+        var seen = Set<String>()
+        for rule in rules where rule.kind != .regex {
+            var body = Substring(rule.body.lowercased())
+            for scheme in ["http://", "https://"] where body.hasPrefix(scheme) {
+                body = body.dropFirst(scheme.count)
+            }
+            let host = body.prefix { $0.isASCII && ($0.isLetter || $0.isNumber || $0 == "." || $0 == "-") }
+                .drop { $0 == "." }
+            if !host.isEmpty && seen.insert(String(host)).inserted {
+                hosts.append(String(host))
+            }
+        }
+        var urls: [String] = []
+        for (i, host) in hosts.enumerated() {
+            urls.append("https://\(host)/")
+            urls.append("http://www.\(host)/path/index.html?q=1")
+            urls.append("https://\(host).example/")
+            urls.append("http://example.org/\(hosts[(i * 7 + 3) % hosts.count])")
+        }
+
+        for (precompileDomainTables, lowerSlowFilters) in [(false, false), (true, false), (true, true)] {
+            let pac = PACCompiler(template: template, precompileDomainTables: precompileDomainTables
+                , lowerSlowFilters: lowerSlowFilters)
+                .render(rules: rules, socks5Address: "127.0.0.1", socks5Port: 1086)
+            let context = try XCTUnwrap(JSContext())
+            context.evaluateScript(String(decoding: pac, as: UTF8.self))
+            let findProxyForURL = try XCTUnwrap(context.objectForKeyedSubscript("FindProxyForURL"))
+
+            var mismatches = 0
+            for url in urls {
+                let host = PACMatcher.host(of: url)
+                let result = try XCTUnwrap(findProxyForURL.call(withArguments: [url, host])?.toString())
+                let decision = matcher.decision(for: url, host: host)
+                if result.hasPrefix("DIRECT") == decision.isProxy {
+                    mismatches += 1
+                    if mismatches <= 10 {
+                        XCTFail("\(url): the PAC returns \(result), the matcher \(decision)")
+                    }
+                }
+            }
+            XCTAssertEqual(mismatches, 0, "precompileDomainTables=\(precompileDomainTables)"
+                + ", lowerSlowFilters=\(lowerSlowFilters)")
+        }
+    }
+
+    func testPerformanceDecisions() throws {
+        let matcher = PACMatcher(rules: try bundledRules())
+        let urls = (0..<10_000).map { "https://www.host\($0).example.com/path/\($0)/index.html?q=\($0)" }
+        measure {
+            for url in urls {
+                _ = matcher.decision(for: url)
+            }
+        }
+    }
+}
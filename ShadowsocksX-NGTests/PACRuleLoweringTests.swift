@@ -0,0 +1,107 @@
+//
+//  PACRuleLoweringTests.swift
+//  ShadowsocksX-NGTests
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import XCTest
+@testable import ShadowsocksX_NG
+
+class PACRuleLoweringTests: XCTestCase {
+
+    func lower(_ texts: [String]) -> PACRuleLowering {
+        return PACRuleLowering(rules: texts.map { PACRule(text: $0) })
+    }
+
+    func testLowerRegex() {
+        XCTAssertEqual(lower(["/twimg\\.edgesuite\\.net\\/\\/?appledaily/"]).rules.map { $0.text }
+            , ["twimg.edgesuite.net//appledaily", "twimg.edgesuite.net/appledaily"])
+        XCTAssertEqual(lower(["@@/^https?:\\/\\/cdn\\.example\\.com\\/x$/"]).rules.map { $0.text }
+            , ["@@|https://cdn.example.com/x|", "@@|http://cdn.example.com/x|"])
+    }
+
+    // "||" also matches ftp://, ws:// and wss:// URLs of the domain, which
+    // the regex does not.
+    func testKeepsSchemeSpecificDomainRegex() {
+        let text = "/^https?:\\/\\/([^\\/]+\\.)*example\\.(com|org)\\/.*/"
+        let lowering = lower([text])
+        XCTAssertEqual(lowering.rules.map { $0.text }, [text])
+        XCTAssertEqual(lowering.report.lowered, [])
+        XCTAssertEqual(lowering.report.slow.map { $0.reason }, ["character class"])
+    }
+
+    func testKeepsWhatCannotBeLowered() {
+        let texts = [
+            "/^https?:\\/\\/[^\\/]+blogspot\\.(.*)/",
+            "/google\\.co.uk/",
+            "/a(b|c)(d|e)(f|g)(h|i)(j|k)/",
+            "/(?=x)abc/",
+            "/ab+c/",
+            "/\\d+\\.example/",
+            "/^https?:\\/\\/example\\.com\\/$/$match-case",
+            "/!important\\.example/",
+        ]
+        let lowering = lower(texts)
+        XCTAssertEqual(lowering.rules.map { $0.text }, texts)
+        XCTAssertEqual(lowering.report.lowered, [])
+        XCTAssertEqual(lowering.report.slow.map { $0.reason }, [
+            "'.' matches any character",
+            "expands to more than 16 rules",
+            "lookaround",
+            "repetition",
+            "character class escape",
+            "would be read as a comment",
+            "character class",
+            "has options",
+        ])
+    }
+
+    func testMergeLiterals() {
+        let lowering = lower(["||example.com", "example.com", "Example.org", "foo.net", "example.co", "@@bar.org"])
+        XCTAssertEqual(lowering.rules.map { $0.text }
+            , ["||example.com", "/(?:example\\.(?:co|org)|foo\\.net)/", "@@bar.org"])
+        XCTAssertEqual(lowering.report.merged, 4)
+
+        let regex = try! NSRegularExpression(pattern: "(?:example\\.(?:co|org)|foo\\.net)", options: .caseInsensitive)
+        for (url, matches) in [("http://example.com/", true), ("http://a.b/EXAMPLE.ORG", true)
+            , ("http://foo.network/", true), ("http://example.net/", false), ("http://foo.ne/", false)] {
+            let found = regex.firstMatch(in: url, range: NSRange(url.startIndex..., in: url)) != nil
+            XCTAssertEqual(found, matches, url)
+        }
+    }
+
+    func testReport() {
+        let lowering = lower([
+            "||example.com",
+            "example.com",
+            "foo.net",
+            "@@bar.org",
+            "/twimg\\.edgesuite\\.net\\/\\/?appledaily/",
+            "/^https?:\\/\\/[^\\/]+blogspot\\.(.*)/",
+        ])
+        let report = lowering.report
+        XCTAssertEqual(report.slowBefore, 5)
+        XCTAssertEqual(report.lowered, [PACRuleLowering.Lowering(rule: "/twimg\\.edgesuite\\.net\\/\\/?appledaily/"
+            , to: ["twimg.edgesuite.net//appledaily", "twimg.edgesuite.net/appledaily"])])
+        XCTAssertEqual(report.slow, [
+            PACRuleLowering.SlowFilter(rule: "/(?:example\\.com|foo\\.net)/", reason: "2 literals merged", cost: 80),
+            PACRuleLowering.SlowFilter(rule: "@@bar.org", reason: "no keyword", cost: 80),
+            PACRuleLowering.SlowFilter(rule: "/^https?:\\/\\/[^\\/]+blogspot\\.(.*)/", reason: "character class"
+                , cost: 1),
+        ])
+        XCTAssertEqual(report.costBefore, 321)
+        XCTAssertEqual(report.costAfter, 161)
+        XCTAssertTrue(report.text.hasSuffix("1\tcharacter class\t/^https?:\\/\\/[^\\/]+blogspot\\.(.*)/\n"))
+    }
+
+    func testBundledList() throws {
+        let gfwlistPath = try XCTUnwrap(Bundle.main.path(forResource: "gfwlist", ofType: "txt"))
+        let gfwlist = try XCTUnwrap(FileManager.default.contents(atPath: gfwlistPath))
+        let rules = try XCTUnwrap(PACRuleSet(gfwlist: gfwlist, userRules: nil)).rules
+        let report = PACRuleLowering(rules: rules).report
+        XCTAssertLessThan(report.slow.count * 10, report.slowBefore)
+        XCTAssertLessThan(report.costAfter * 10, report.costBefore)
+    }
+}
@@ -0,0 +1,117 @@
+//
+//  PACRuleOptimizerTests.swift
+//  ShadowsocksX-NGTests
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import XCTest
+@testable import ShadowsocksX_NG
+
+class PACRuleOptimizerTests: XCTestCase {
+
+    func optimize(_ texts: [String]) -> PACRuleOptimizer {
+        return PACRuleOptimizer(rules: texts.map { PACRule(text: $0) })
+    }
+
+    func testSubsumption() {
+        let optimizer = optimize([
+            "||b.example.com",
+            "||example.com",
+            "||example.com.hk",
+            "|https://c.example.com/path",
+            "|http://example.org",
+            "|http://example.org/path",
+            ".keyword.net",
+            "||a.keyword.net",
+            "/path/a*.keyword.net",
+            "||keyword.net^",
+            "@@||cn.example.com",
+            "@@||a.cn.example.com",
+            "@@||other.com",
+        ])
+        XCTAssertEqual(optimizer.rules.map { $0.text }, [
+            "||example.com",
+            "|http://example.org",
+            ".keyword.net",
+            "||keyword.net^",
+            "@@||cn.example.com",
+            "@@||other.com",
+        ])
+        XCTAssertEqual(optimizer.report.subsumed, [
+            PACRuleOptimizer.Drop(rule: "||b.example.com", by: "||example.com"),
+            PACRuleOptimizer.Drop(rule: "||example.com.hk", by: "||example.com"),
+            PACRuleOptimizer.Drop(rule: "|https://c.example.com/path", by: "||example.com"),
+            PACRuleOptimizer.Drop(rule: "|http://example.org/path", by: "|http://example.org"),
+            PACRuleOptimizer.Drop(rule: "||a.keyword.net", by: ".keyword.net"),
+            PACRuleOptimizer.Drop(rule: "/path/a*.keyword.net", by: ".keyword.net"),
+            PACRuleOptimizer.Drop(rule: "@@||a.cn.example.com", by: "@@||cn.example.com"),
+        ])
+        XCTAssertEqual(optimizer.report.rulesAfter, 6)
+    }
+
+    func testMergeEquivalent() {
+        let optimizer = optimize(["||example.com", "||EXAMPLE.com*", "*keyword*", "keyword", "**keyword"])
+        XCTAssertEqual(optimizer.rules.map { $0.text }, ["||example.com", "*keyword*"])
+        XCTAssertEqual(optimizer.report.merged, [
+            PACRuleOptimizer.Drop(rule: "||EXAMPLE.com*", by: "||example.com"),
+            PACRuleOptimizer.Drop(rule: "keyword", by: "*keyword*"),
+            PACRuleOptimizer.Drop(rule: "**keyword", by: "*keyword*"),
+        ])
+    }
+
+    // Only rules covered by one of the same polarity, and only rules ABP
+    // matches the way the optimizer assumes, are dropped.
+    func testKeepsWhatMatters() {
+        let texts = [
+            "||example.com",
+            "@@||b.example.com",
+            "||*.example.org",
+            "example.org",
+            "||example.net$third-party",
+            "||a.example.net",
+            "/^https?:\\/\\/[^\\/]+example\\.io/",
+            "||b.example.io",
+            "||bar.com^",
+            ".bar.com",
+            "|http://evil.org/b.example.com",
+            "a b.example.com",
+        ]
+        XCTAssertEqual(optimize(texts).rules.map { $0.text }, texts.filter { $0 != "||*.example.org" })
+    }
+
+    func testBundledListKeepsOrder() throws {
+        let gfwlistPath = try XCTUnwrap(Bundle.main.path(forResource: "gfwlist", ofType: "txt"))
+        let gfwlist = try XCTUnwrap(FileManager.default.contents(atPath: gfwlistPath))
+        let rules = try XCTUnwrap(PACRuleSet(gfwlist: gfwlist, userRules: nil)).rules
+        let optimizer = PACRuleOptimizer(rules: rules)
+        XCTAssertLessThan(optimizer.rules.count, rules.count)
+        XCTAssertEqual(optimizer.rules.count, optimizer.report.rulesAfter)
+
+        var i = rules.startIndex
+        for rule in optimizer.rules {
+            i = try XCTUnwrap(rules[i...].firstIndex(of: rule))
+        }
+    }
+
+    func testCompactOutput() throws {
+        let template = PACTemplate(data: Data("var rules = __RULES__;".utf8))
+        let rules = ["||example.com", "|http://a\"b/c"].map { PACRule(text: $0) }
+        let compact = PACCompiler(template: template, compactOutput: true)
+        XCTAssertEqual(String(decoding: compact.render(rules: rules, socks5Address: "", socks5Port: 0), as: UTF8.self)
+            , "var rules = [\"||example.com\",\"|http://a\\\"b/c\"];")
+        XCTAssertEqual(String(decoding: compact.render(rules: [], socks5Address: "", socks5Port: 0), as: UTF8.self)
+            , "var rules = [];")
+        XCTAssertEqual(compact.rulesByteCount(rules), 34)
+        XCTAssertEqual(PACCompiler(template: template).rulesByteCount(rules), 44)
+    }
+
+    func testPerformanceOptimize100kRules() throws {
+        let gfwlist = Data(makeSyntheticGFWList(ruleCount: 100_000).utf8)
+        let rules = try XCTUnwrap(PACRuleSet(gfwlist: gfwlist, userRules: nil)).rules
+        measure {
+            _ = PACRuleOptimizer(rules: rules)
+        }
+    }
+}
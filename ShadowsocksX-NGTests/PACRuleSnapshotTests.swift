@@ -0,0 +1,67 @@
+//
+//  PACRuleSnapshotTests.swift
+//  ShadowsocksX-NGTests
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import XCTest
+@testable import ShadowsocksX_NG
+
+class PACRuleSnapshotTests: XCTestCase {
+
+    var path: String!
+    var compiler: PACCompiler!
+
+    override func setUpWithError() throws {
+        path = NSTemporaryDirectory() + "PACRuleSnapshotTests-\(UUID().uuidString).snapshot"
+        compiler = PACCompiler(template: try XCTUnwrap(PACTemplate.bundled), precompileDomainTables: true)
+    }
+
+    override func tearDownWithError() throws {
+        try? FileManager.default.removeItem(atPath: path)
+    }
+
+    func makeSnapshot(gfwlist: Data, userRules: Data?) throws -> PACRuleSnapshot {
+        let ruleSet = try XCTUnwrap(PACRuleSet(gfwlist: gfwlist, userRules: userRules))
+        let key = PACRuleSnapshot.key(gfwlist: gfwlist, userRules: userRules
+            , template: compiler.template.data, options: compiler.options)
+        return PACRuleSnapshot(key: key, rules: ruleSet.rules
+            , body: compiler.renderBody(rules: ruleSet.rules).map { Data($0) })
+    }
+
+    func testRoundTrip() throws {
+        let gfwlist = Data(makeSyntheticGFWList(ruleCount: 1000).utf8)
+        let userRules = Data("||中文.example.com\n@@||direct.example.com".utf8)
+        let snapshot = try makeSnapshot(gfwlist: gfwlist, userRules: userRules)
+        try snapshot.write(toFile: path)
+
+        let loaded = try XCTUnwrap(PACRuleSnapshot(contentsOfFile: path, key: snapshot.key))
+        XCTAssertEqual(loaded.rules, snapshot.rules)
+        XCTAssertEqual(loaded.body, snapshot.body)
+
+        var key = snapshot.key
+        key[0] ^= 1
+        XCTAssertNil(PACRuleSnapshot(contentsOfFile: path, key: key))
+    }
+
+    func testRejectsTruncatedFile() throws {
+        let snapshot = try makeSnapshot(gfwlist: Data(makeSyntheticGFWList(ruleCount: 10).utf8), userRules: nil)
+        try snapshot.write(toFile: path)
+        let data = try Data(contentsOf: URL(fileURLWithPath: path))
+        try data.prefix(data.count - 1).write(to: URL(fileURLWithPath: path))
+
+        XCTAssertNil(PACRuleSnapshot(contentsOfFile: path, key: snapshot.key))
+    }
+
+    func testHeaderAndBodyEqualFullRender() throws {
+        let snapshot = try makeSnapshot(gfwlist: Data(makeSyntheticGFWList(ruleCount: 1000).utf8), userRules: nil)
+        let body = try XCTUnwrap(snapshot.body)
+        for (address, port) in [("127.0.0.1", 1086), ("::1", 1080)] {
+            var out = compiler.renderHeader(socks5Address: address, socks5Port: port)
+            out.append(contentsOf: body)
+            XCTAssertEqual(Data(out), compiler.render(rules: snapshot.rules, socks5Address: address, socks5Port: port))
+        }
+    }
+}
@@ -0,0 +1,79 @@
+//
+//  PACRuleSourceTests.swift
+//  ShadowsocksX-NGTests
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import XCTest
+@testable import ShadowsocksX_NG
+
+class PACRuleSourceTests: XCTestCase {
+
+    var dir: String!
+
+    override func setUpWithError() throws {
+        dir = NSTemporaryDirectory() + "PACRuleSourceTests-\(UUID().uuidString)/"
+        try FileManager.default.createDirectory(atPath: dir, withIntermediateDirectories: true, attributes: nil)
+    }
+
+    override func tearDownWithError() throws {
+        try? FileManager.default.removeItem(atPath: dir)
+    }
+
+    func makeSource(_ name: String, format: RuleListFormat = .detect) -> PACRuleSource {
+        return PACRuleSource(url: "http://localhost/\(name)", listPath: dir + name + ".txt"
+            , rulesPath: dir + name + ".snapshot", format: format, defaultsKey: name)
+    }
+
+    func testDetectFormat() throws {
+        let plain = "[Adblock Plus 2.0]\n! CDN\n||cdn.example.com\n.static.example.net"
+        let expected = [PACRule(text: "||cdn.example.com"), PACRule(text: ".static.example.net")]
+        XCTAssertEqual(parseRuleList(Data(plain.utf8), format: .detect), expected)
+        XCTAssertEqual(parseRuleList(Data(plain.utf8), format: .plain), expected)
+
+        let base64 = Data(plain.utf8).base64EncodedData(options: .lineLength64Characters)
+        XCTAssertEqual(parseRuleList(base64, format: .detect), expected)
+        XCTAssertEqual(parseRuleList(base64, format: .base64), expected)
+        XCTAssertEqual(parseRuleList(Data(plain.utf8).base64EncodedData(), format: .detect), expected)
+
+        XCTAssertEqual(parseRuleList(Data("example.com\r\nexample.org".utf8), format: .detect)
+            , [PACRule(text: "example.com"), PACRule(text: "example.org")])
+        XCTAssertNil(parseRuleList(Data(plain.utf8), format: .base64))
+    }
+
+    func testStoreAndLoad() throws {
+        let source = makeSource("cdn")
+        XCTAssertNil(source.loadRules())
+
+        let list = Data("||a.com\n||b.com".utf8)
+        let rules = try XCTUnwrap(parseRuleList(list, format: .detect))
+        XCTAssertTrue(source.store(list: list, rules: rules))
+        let loaded = try XCTUnwrap(source.loadRules())
+        XCTAssertEqual(loaded.rules, rules)
+        XCTAssertEqual(loaded.key, source.key(list: list))
+
+        // A cached list edited behind our back is parsed again.
+        try Data("||c.com".utf8).write(to: URL(fileURLWithPath: source.listPath))
+        XCTAssertEqual(source.loadRules()?.rules, [PACRule(text: "||c.com")])
+        XCTAssertNotNil(PACRuleSnapshot(contentsOfFile: source.rulesPath, key: source.key(list: Data("||c.com".utf8))))
+    }
+
+    func testLoadSourcesInOrder() throws {
+        let sources = (0..<8).map { makeSource("list\($0)") }
+        for (i, source) in sources.enumerated() where i != 3 {
+            let list = Data("||list\(i).example.com\n||shared.example.com".utf8)
+            try list.write(to: URL(fileURLWithPath: source.listPath))
+        }
+        let lists = LoadPACRuleSources(sources)
+        XCTAssertEqual(lists.count, sources.count)
+        for (i, list) in lists.enumerated() {
+            if i == 3 {
+                XCTAssertNil(list)
+            } else {
+                XCTAssertEqual(list?.rules.first, PACRule(text: "||list\(i).example.com"))
+            }
+        }
+    }
+}
@@ -0,0 +1,77 @@
+//
+//  PACRuleTests.swift
+//  ShadowsocksX-NGTests
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import XCTest
+@testable import ShadowsocksX_NG
+
+class PACRuleTests: XCTestCase {
+
+    func testParseRule() {
+        let rule = PACRule(text: "@@||Example.com")
+        XCTAssertTrue(rule.isWhitelist)
+        XCTAssertEqual(rule.kind, .domainAnchor)
+        XCTAssertEqual(rule.body, "Example.com")
+
+        XCTAssertEqual(PACRule(text: "|http://example.com").kind, .startAnchor)
+        XCTAssertEqual(PACRule(text: "/^https?:\\/\\/[^\\/]+example\\.com/").kind, .regex)
+        XCTAssertEqual(PACRule(text: ".example.com").kind, .plain)
+
+        XCTAssertNil(PACRule(line: Array("! comment".utf8)))
+        XCTAssertNil(PACRule(line: Array("[AutoProxy 0.2.9]".utf8)))
+        XCTAssertNil(PACRule(line: [UInt8]()))
+    }
+
+    func testMergeReport() {
+        var set = PACRuleSet()
+        set.addUserRule(PACRule(text: "||google.com"))
+        set.addUserRule(PACRule(text: "baidu.com"))
+        set.addUserRule(PACRule(text: "twitter.com"))
+        set.addUserRule(PACRule(text: "||google.com"))
+
+        set.addGFWListRule(PACRule(text: "||google.com"))
+        set.addGFWListRule(PACRule(text: "@@||baidu.com"))
+        set.addGFWListRule(PACRule(text: "||twitter.com"))
+        set.addGFWListRule(PACRule(text: "||facebook.com"))
+        set.addGFWListRule(PACRule(text: "||facebook.com"))
+
+        XCTAssertEqual(set.rules.map { $0.text }
+            , ["||google.com", "baidu.com", "twitter.com", "||facebook.com"])
+        XCTAssertEqual(set.userRuleCount, 3)
+        XCTAssertEqual(set.report.duplicated, ["||google.com", "||google.com", "||facebook.com"])
+        XCTAssertEqual(set.report.shadowed
+            , [PACRuleSet.Override(rule: "||twitter.com", userRule: "twitter.com")])
+        XCTAssertEqual(set.report.conflicting
+            , [PACRuleSet.Override(rule: "@@||baidu.com", userRule: "baidu.com")])
+    }
+
+    // Only a user line equal to the rule without its leading "@" and "|"
+    // overrides it, as GeneratePACFile() compared them.
+    func testOverrideNeedsTheBareText() throws {
+        let userRules = Data("! example.org\n||x.com\nY.com\n/a|b/".utf8)
+        let gfwlist = Data(Data(["||x.com", "x.com", "||y.com", "|/a|b/", "|! example.org", "@|example.org"]
+            .joined(separator: "\n").utf8).base64EncodedData())
+        let set = try XCTUnwrap(PACRuleSet(gfwlist: gfwlist, userRules: userRules))
+
+        XCTAssertEqual(set.rules.map { $0.text }
+            , ["||x.com", "Y.com", "/a|b/", "x.com", "||y.com", "@|example.org"])
+        XCTAssertEqual(set.report.duplicated, ["||x.com"])
+        XCTAssertEqual(set.report.shadowed
+            , [PACRuleSet.Override(rule: "|/a|b/", userRule: "/a|b/")
+            , PACRuleSet.Override(rule: "|! example.org", userRule: "! example.org")])
+        XCTAssertTrue(set.report.conflicting.isEmpty)
+    }
+
+    func testPerformanceMergeThousandsOfUserRules() {
+        let gfwlist = Data(makeSyntheticGFWList(ruleCount: 100_000).utf8)
+        let userRules = Data((0..<5000).map { "||site\($0 * 10).example\($0 * 10 % 97).com" }
+            .joined(separator: "\n").utf8)
+        measure {
+            _ = PACRuleSet(gfwlist: gfwlist, userRules: userRules)
+        }
+    }
+}
@@ -0,0 +1,101 @@
+//
+//  PACServerContentTests.swift
+//  ShadowsocksX-NGTests
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import XCTest
+import Compression
+import GCDWebServer
+@testable import ShadowsocksX_NG
+
+class PACServerContentTests: XCTestCase {
+
+    let pac = Data(String(repeating: "function FindProxyForURL(url, host) { return \"DIRECT\"; }\n", count: 100).utf8)
+    let modified = Date(timeIntervalSince1970: 1_700_000_000.5)
+
+    func request(_ headers: [String: String]) -> GCDWebServerRequest {
+        return GCDWebServerRequest(method: "GET", url: URL(string: "http://localhost:1089/proxy.pac")!
+            , headers: headers, path: "/proxy.pac", query: nil)
+    }
+
+    func testVariants() {
+        let content = PACServerContent(data: pac, lastModified: modified)
+        let gzip = content.variant(acceptEncoding: "gzip, deflate")
+        XCTAssertEqual(gzip.encoding, "gzip")
+        XCTAssertLessThan(gzip.data.count, pac.count)
+        XCTAssertEqual(Array(gzip.data.prefix(2)), [0x1f, 0x8b])
+        // The deflate stream between the 10 byte header and the 8 byte trailer.
+        let inflated = gzip.data.dropFirst(10).dropLast(8).withUnsafeBytes { input -> Data in
+            var out = Data(count: pac.count + 1)
+            let count = out.withUnsafeMutableBytes { output in
+                compression_decode_buffer(output.bindMemory(to: UInt8.self).baseAddress!, output.count
+                    , input.bindMemory(to: UInt8.self).baseAddress!, input.count, nil, COMPRESSION_ZLIB)
+            }
+            return out.prefix(count)
+        }
+        XCTAssertEqual(inflated, pac)
+
+        XCTAssertNil(content.variant(acceptEncoding: nil).encoding)
+        XCTAssertNil(content.variant(acceptEncoding: "identity").encoding)
+        XCTAssertNil(content.variant(acceptEncoding: "gzip;q=0, deflate").encoding)
+        XCTAssertEqual(content.variant(acceptEncoding: "*").encoding, content.variants[0].encoding)
+        XCTAssertEqual(content.variant(acceptEncoding: "X-GZIP").encoding, "gzip")
+        XCTAssertEqual(content.variant(acceptEncoding: "br, gzip").encoding, "gzip")
+        XCTAssertEqual(Set(content.variants.map { $0.eTag }).count, content.variants.count)
+    }
+
+    func testValidators() throws {
+        let content = PACServerContent(data: pac, lastModified: modified)
+        XCTAssertEqual(content.lastModified, Date(timeIntervalSince1970: 1_700_000_000))
+
+        let full = try XCTUnwrap(content.response(for: request(["Accept-Encoding": "gzip"]))
+            as? GCDWebServerDataResponse)
+        XCTAssertEqual(full.statusCode, 200)
+        XCTAssertEqual(full.contentType, PACServerContent.contentType)
+        let eTag = try XCTUnwrap(full.eTag)
+        XCTAssertTrue(eTag.hasSuffix("-gzip\""))
+
+        let revalidated = content.response(for: request(["Accept-Encoding": "gzip", "If-None-Match": "\"x\", \(eTag)"]))
+        XCTAssertEqual(revalidated.statusCode, 304)
+        XCTAssertEqual(revalidated.eTag, eTag)
+        // The tag of another encoding does not validate this one.
+        XCTAssertEqual(content.response(for: request(["If-None-Match": eTag])).statusCode, 200)
+        XCTAssertEqual(content.response(for: request(["If-None-Match": "*"])).statusCode, 304)
+
+        let date = GCDWebServerFormatRFC822(content.lastModified)
+        XCTAssertEqual(content.response(for: request(["If-Modified-Since": date])).statusCode, 304)
+        XCTAssertEqual(content.response(for: request(["If-Modified-Since": date, "If-None-Match": "\"x\""]))
+            .statusCode, 200)
+        let earlier = GCDWebServerFormatRFC822(content.lastModified.addingTimeInterval(-1))
+        XCTAssertEqual(content.response(for: request(["If-Modified-Since": earlier])).statusCode, 200)
+    }
+
+    func testProxyVariants() {
+        let content = PACServerContent(data: pac, lastModified: modified)
+        XCTAssertEqual(PACServerContent.proxy(via: "socks5", host: "192.168.1.2", port: 1086)
+            , "SOCKS5 192.168.1.2:1086; SOCKS 192.168.1.2:1086; DIRECT;")
+        XCTAssertEqual(PACServerContent.proxy(via: "http", host: "fe80::1", port: 1087)
+            , "PROXY [fe80::1]:1087; DIRECT;")
+
+        let http = content.content(proxy: "PROXY 127.0.0.1:1087; DIRECT;")
+        XCTAssertTrue(http === content.content(proxy: "PROXY 127.0.0.1:1087; DIRECT;"))
+        XCTAssertEqual(http.variants.last!.data, pac + Data("\nproxy = \"PROXY 127.0.0.1:1087; DIRECT;\";\n".utf8))
+        XCTAssertEqual(http.lastModified, content.lastModified)
+        XCTAssertEqual(http.variants.map { $0.encoding }, content.variants.map { $0.encoding })
+        XCTAssertNotEqual(http.variants.last!.eTag, content.variants.last!.eTag)
+        XCTAssertEqual(content.content(proxy: "PROXY \"x\"; DIRECT;").variants.last!.data.suffix(32)
+            , Data("proxy = \"PROXY \\\"x\\\"; DIRECT;\";\n".utf8))
+
+        let unknown = GCDWebServerRequest(method: "GET", url: URL(string: "http://localhost:1089/proxy.pac?via=ftp")!
+            , headers: [:], path: "/proxy.pac", query: ["via": "ftp"])
+        XCTAssertNil(content.content(for: unknown))
+    }
+
+    func testSmallPACIsNotCompressed() {
+        let content = PACServerContent(data: Data("x".utf8), lastModified: modified)
+        XCTAssertEqual(content.variants.map { $0.encoding }, [nil])
+    }
+}
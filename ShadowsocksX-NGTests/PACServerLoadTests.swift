@@ -0,0 +1,335 @@
+//
+//  PACServerLoadTests.swift
+//  ShadowsocksX-NGTests
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import XCTest
+import GCDWebServer
+@testable import ShadowsocksX_NG
+
+// Loopback load test of the PAC server as ProxyConfHelper configures it, run
+// by `make pac-server-load` and skipped otherwise. Concurrent clients fetch
+// the PAC for a while on persistent connections, then with a connection per
+// request, and the results are written as JSON for regression tracking, in
+// the shape tools/http-bench writes against a running app.
+//
+// Environment, prefixed with TEST_RUNNER_ when set through xcodebuild:
+//   PAC_SERVER_LOAD           run the test at all
+//   PAC_SERVER_LOAD_CLIENTS   concurrent clients (default 8)
+//   PAC_SERVER_LOAD_DURATION  seconds per mode (default 5)
+//   PAC_SERVER_LOAD_PAC       PAC file to serve (default a generated one)
+//   PAC_SERVER_LOAD_JSON      file to write the results to
+class PACServerLoadTests: XCTestCase {
+
+    let environment = ProcessInfo.processInfo.environment
+
+    override func setUpWithError() throws {
+        try XCTSkipUnless(environment["PAC_SERVER_LOAD"] != nil, "Run with make pac-server-load")
+    }
+
+    // One client on its own thread, sending a request and reading its whole
+    // response before the next, as a browser fetching the PAC does.
+    final class Client {
+        let port: UInt16
+        let keepAlive: Bool
+        let request: [UInt8]
+        var fd: Int32 = -1
+        var buffer = [UInt8](repeating: 0, count: 65536)
+
+        var microseconds: [Double] = []
+        var statuses: [Int: Int] = [:]
+        var bytes = 0
+        var errors = 0
+        var connections = 0
+        var cpuSeconds = 0.0
+
+        init(port: UInt16, keepAlive: Bool) {
+            self.port = port
+            self.keepAlive = keepAlive
+            request = Array(("GET /proxy.pac HTTP/1.1\r\nHost: 127.0.0.1\r\nAccept-Encoding: gzip\r\n"
+                + "Connection: \(keepAlive ? "keep-alive" : "close")\r\n\r\n").utf8)
+        }
+
+        func run(until deadline: UInt64) {
+            let cpuStart = Client.threadCPUSeconds()
+            while DispatchTime.now().uptimeNanoseconds < deadline {
+                let began = DispatchTime.now().uptimeNanoseconds
+                if let (status, length) = exchange() {
+                    microseconds.append(Double(DispatchTime.now().uptimeNanoseconds - began) / 1e3)
+                    statuses[status, default: 0] += 1
+                    bytes += length
+                } else {
+                    errors += 1
+                    disconnect()
+                }
+            }
+            disconnect()
+            cpuSeconds = Client.threadCPUSeconds() - cpuStart
+        }
+
+        // CPU spent by the calling thread, so that the clients can be told
+        // apart from the server in the CPU time of the process.
+        static func threadCPUSeconds() -> Double {
+            var time = timespec()
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time)
+            return Double(time.tv_sec) + Double(time.tv_nsec) / 1e9
+        }
+
+        func connect() -> Bool {
+            fd = socket(AF_INET, SOCK_STREAM, 0)
+            guard fd >= 0 else {
+                return false
+            }
+            var timeout = timeval(tv_sec: 5, tv_usec: 0)
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, socklen_t(MemoryLayout<timeval>.size))
+            var noSigPipe: Int32 = 1
+            setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, socklen_t(MemoryLayout<Int32>.size))
+            var address = sockaddr_in()
+            address.sin_family = sa_family_t(AF_INET)
+            address.sin_port = in_port_t(port.bigEndian)
+            address.sin_addr.s_addr = inet_addr("127.0.0.1")
+            let connected = withUnsafePointer(to: &address) {
+                $0.withMemoryRebound(to: sockaddr.self, capacity: 1) {
+                    Darwin.connect(fd, $0, socklen_t(MemoryLayout<sockaddr_in>.size))
+                }
+            }
+            connections += 1
+            return connected == 0
+        }
+
+        func disconnect() {
+            if fd >= 0 {
+                close(fd)
+                fd = -1
+            }
+        }
+
+        // Returns the status and length of the response, or nil on any error.
+        func exchange() -> (Int, Int)? {
+            guard fd >= 0 || connect() else {
+                return nil
+            }
+            var written = 0
+            while written < request.count {
+                let count = request[written...].withUnsafeBufferPointer { write(fd, $0.baseAddress, $0.count) }
+                guard count > 0 else {
+                    return nil
+                }
+                written += count
+            }
+
+            var received: [UInt8] = []
+            var headerLength = 0
+            var contentLength = 0
+            var status = 0
+            var closing = !keepAlive
+            while headerLength == 0 || received.count < headerLength + contentLength {
+                let count = read(fd, &buffer, buffer.count)
+                guard count > 0 else {
+                    return nil
+                }
+                received += buffer[0..<count]
+                if headerLength == 0, let end = Client.headerEnd(received) {
+                    headerLength = end
+                    let lines = String(decoding: received[0..<end], as: UTF8.self).components(separatedBy: "\r\n")
+                    status = Int(lines[0].split(separator: " ").dropFirst().first ?? "") ?? 0
+                    for line in lines.dropFirst() {
+                        guard let colon = line.firstIndex(of: ":") else {
+                            continue
+                        }
+                        let name = line[..<colon].lowercased()
+                        let value = line[line.index(after: colon)...].trimmingCharacters(in: .whitespaces)
+                        if name == "content-length" {
+                            contentLength = Int(value) ?? 0
+                        } else if name == "connection" && value.lowercased() == "close" {
+                            closing = true
+                        }
+                    }
+                }
+            }
+            if closing {
+                disconnect()
+            }
+            return (status, received.count)
+        }
+
+        static func headerEnd(_ bytes: [UInt8]) -> Int? {
+            guard bytes.count >= 4 else {
+                return nil
+            }
+            for i in 0...(bytes.count - 4)
+                where bytes[i] == 13 && bytes[i + 1] == 10 && bytes[i + 2] == 13 && bytes[i + 3] == 10 {
+                return i + 4
+            }
+            return nil
+        }
+    }
+
+    static func openFileDescriptors() -> Int {
+        // Less the one listing the directory.
+        return ((try? FileManager.default.contentsOfDirectory(atPath: "/dev/fd"))?.count ?? 1) - 1
+    }
+
+    static func processCPUSeconds() -> Double {
+        var usage = rusage()
+        getrusage(RUSAGE_SELF, &usage)
+        return Double(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+            + Double(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6
+    }
+
+    static func percentile(_ sorted: [Double], _ p: Double) -> Double {
+        return sorted.isEmpty ? 0 : sorted[min(sorted.count - 1, Int(Double(sorted.count) * p))]
+    }
+
+    func run(port: UInt16, keepAlive: Bool, clients count: Int, duration: Double) -> [String: Any] {
+        let fdsBefore = PACServerLoadTests.openFileDescriptors()
+        var fdsPeak = fdsBefore
+        let samplerQueue = DispatchQueue(label: "PACServerLoadTests.fds")
+        let sampler = DispatchSource.makeTimerSource(queue: samplerQueue)
+        sampler.schedule(deadline: .now(), repeating: .milliseconds(10))
+        sampler.setEventHandler {
+            fdsPeak = max(fdsPeak, PACServerLoadTests.openFileDescriptors())
+        }
+        sampler.resume()
+
+        let clients = (0..<count).map { _ in Client(port: port, keepAlive: keepAlive) }
+        let group = DispatchGroup()
+        let cpuStart = PACServerLoadTests.processCPUSeconds()
+        let began = DispatchTime.now().uptimeNanoseconds
+        let deadline = began + UInt64(duration * 1e9)
+        for client in clients {
+            group.enter()
+            Thread {
+                client.run(until: deadline)
+                group.leave()
+            }.start()
+        }
+        group.wait()
+        let seconds = Double(DispatchTime.now().uptimeNanoseconds - began) / 1e9
+        let cpuSeconds = PACServerLoadTests.processCPUSeconds() - cpuStart
+        let clientCPUSeconds = clients.reduce(0) { $0 + $1.cpuSeconds }
+
+        // The server closes its end of each connection once it reads the
+        // close of the client.
+        var fdsAfter = PACServerLoadTests.openFileDescriptors()
+        for _ in 0..<100 where fdsAfter > fdsBefore {
+            Thread.sleep(forTimeInterval: 0.01)
+            fdsAfter = PACServerLoadTests.openFileDescriptors()
+        }
+        sampler.cancel()
+        fdsPeak = samplerQueue.sync { max(fdsPeak, fdsAfter) }
+
+        let microseconds = clients.flatMap { $0.microseconds }.sorted()
+        let requests = microseconds.count
+        var statuses: [String: Int] = [:]
+        for client in clients {
+            for (status, n) in client.statuses {
+                statuses[String(status), default: 0] += n
+            }
+        }
+        return [
+            "mode": keepAlive ? "keep-alive" : "close",
+            "requests": requests,
+            "errors": clients.reduce(0) { $0 + $1.errors },
+            "seconds": seconds,
+            "rps": Double(requests) / seconds,
+            "connections": clients.reduce(0) { $0 + $1.connections },
+            "bytes": clients.reduce(0) { $0 + $1.bytes },
+            "statuses": statuses,
+            "us": [
+                "mean": microseconds.reduce(0, +) / Double(max(requests, 1)),
+                "p50": PACServerLoadTests.percentile(microseconds, 0.5),
+                "p90": PACServerLoadTests.percentile(microseconds, 0.9),
+                "p99": PACServerLoadTests.percentile(microseconds, 0.99),
+                "max": microseconds.last ?? 0,
+            ],
+            // The clients run in this process too, their threads are counted
+            // apart to leave the CPU of the server.
+            "cpu": [
+                "processSeconds": cpuSeconds,
+                "clientSeconds": clientCPUSeconds,
+                "serverSeconds": max(cpuSeconds - clientCPUSeconds, 0),
+                "serverUsPerRequest": max(cpuSeconds - clientCPUSeconds, 0) * 1e6 / Double(max(requests, 1)),
+            ],
+            "fds": ["before": fdsBefore, "peak": fdsPeak, "after": fdsAfter],
+        ]
+    }
+
+    // A PAC shaped like the ones PACUtils writes, the size of a full gfwlist.
+    func generatedPAC() -> Data {
+        let domains = (0..<6000).map { "  \"example\($0).com\": 1" }.joined(separator: ",\n")
+        return Data(("var proxy = \"SOCKS5 127.0.0.1:1086; SOCKS 127.0.0.1:1086; DIRECT;\";\n"
+            + "var domains = {\n\(domains)\n};\n"
+            + "function FindProxyForURL(url, host) {\n"
+            + "  for (var suffix = host; suffix; suffix = suffix.substring(suffix.indexOf(\".\") + 1)) {\n"
+            + "    if (domains.hasOwnProperty(suffix)) return proxy;\n"
+            + "    if (suffix.indexOf(\".\") < 0) break;\n"
+            + "  }\n"
+            + "  return \"DIRECT\";\n"
+            + "}\n").utf8)
+    }
+
+    func testLoad() throws {
+        let clients = Int(environment["PAC_SERVER_LOAD_CLIENTS"] ?? "") ?? 8
+        let duration = Double(environment["PAC_SERVER_LOAD_DURATION"] ?? "") ?? 5
+        let content: PACServerContent
+        if let path = environment["PAC_SERVER_LOAD_PAC"] {
+            content = try XCTUnwrap(PACServerContent(contentsOfFile: path), path)
+        } else {
+            content = PACServerContent(data: generatedPAC(), lastModified: Date())
+        }
+
+        let server = ProxyConfHelper.pacServer { content }
+        try server.start(options: ProxyConfHelper.pacServerOptions(withPort: 0, bindToLocalhost: true))
+        defer {
+            server.stop()
+        }
+        let port = UInt16(server.port)
+        _ = run(port: port, keepAlive: true, clients: 1, duration: 0.2)  // Warms up
+
+        let results = [true, false].map { run(port: port, keepAlive: $0, clients: clients, duration: duration) }
+
+        var lines = [
+            "pac-server-load: \(clients) clients, \(duration) s per mode, \(content.variants.last!.body.length) B PAC",
+            "mode              req/s   errors  connections     mean      p50      p90      p99      max  (us)"
+                + "  server us/req   fds before/peak/after",
+        ]
+        for result in results {
+            let us = result["us"] as! [String: Double]
+            let cpu = result["cpu"] as! [String: Double]
+            let fds = result["fds"] as! [String: Int]
+            let mode = (result["mode"] as! String).padding(toLength: 12, withPad: " ", startingAt: 0)
+            lines.append(mode + String(format: "%11.0f%9d%13d", result["rps"] as! Double,
+                                       result["errors"] as! Int, result["connections"] as! Int)
+                + ["mean", "p50", "p90", "p99", "max"].map { String(format: "%9.0f", us[$0]!) }.joined()
+                + String(format: "%15.1f   %d/%d/%d", cpu["serverUsPerRequest"]!,
+                         fds["before"]!, fds["peak"]!, fds["after"]!))
+        }
+        let report = lines.joined(separator: "\n")
+        print(report)
+        add(XCTAttachment(string: report))
+
+        let json = try JSONSerialization.data(withJSONObject: [
+            "url": "http://127.0.0.1:\(port)/proxy.pac",
+            "connections": clients,
+            "pacBytes": content.variants.last!.body.length,
+            "results": results,
+        ], options: [.prettyPrinted, .sortedKeys])
+        add(XCTAttachment(data: json, uniformTypeIdentifier: "public.json"))
+        if let path = environment["PAC_SERVER_LOAD_JSON"] {
+            try json.write(to: URL(fileURLWithPath: path))
+        }
+
+        for result in results {
+            let mode = result["mode"] as! String
+            XCTAssertGreaterThan(result["requests"] as! Int, 0, mode)
+            XCTAssertEqual(result["errors"] as! Int, 0, mode)
+            XCTAssertEqual((result["statuses"] as! [String: Int]).keys.sorted(), ["200"], mode)
+            let fds = result["fds"] as! [String: Int]
+            XCTAssertLessThanOrEqual(fds["after"]!, fds["before"]!, "\(mode): file descriptors leaked")
+        }
+    }
+}
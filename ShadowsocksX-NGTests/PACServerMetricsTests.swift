@@ -0,0 +1,89 @@
+//
+//  PACServerMetricsTests.swift
+//  ShadowsocksX-NGTests
+//
+//  Created by agent on 2026/10/17.
+//  Copyright © 2026 qiuyuzhou. All rights reserved.
+//
+
+import XCTest
+import GCDWebServer
+@testable import ShadowsocksX_NG
+
+class PACServerMetricsTests: XCTestCase {
+
+    let pac = Data(String(repeating: "function FindProxyForURL(url, host) { return \"DIRECT\"; }\n", count: 100).utf8)
+
+    func request(_ headers: [String: String]) -> GCDWebServerRequest {
+        return GCDWebServerRequest(method: "GET", url: URL(string: "http://localhost:1089/proxy.pac")!
+            , headers: headers, path: "/proxy.pac", query: nil)
+    }
+
+    // The samples of the text, by metric name and labels.
+    func samples(_ text: String) -> [String: String] {
+        var samples: [String: String] = [:]
+        for line in text.split(separator: "\n") where !line.hasPrefix("#") {
+            let parts = line.split(separator: " ")
+            XCTAssertEqual(parts.count, 2, String(line))
+            samples[String(parts[0])] = String(parts[1])
+        }
+        return samples
+    }
+
+    func testText() {
+        let metrics = PACServerMetrics()
+        let content = PACServerContent(data: pac, lastModified: Date())
+        let gzip = content.response(for: request(["Accept-Encoding": "gzip"]))
+        let identity = content.response(for: request([:]))
+        let notModified = content.response(for: request(["Accept-Encoding": "gzip", "If-None-Match": gzip.eTag!]))
+        metrics.record(gzip, path: "/proxy.pac", content: content)
+        metrics.record(identity, path: "/wpad.dat", content: content)
+        metrics.record(notModified, path: "/proxy.pac", content: content)
+        metrics.record(GCDWebServerResponse(statusCode: 404), path: "/proxy.pac", content: nil)
+        metrics.recordGeneration(seconds: 0.5, rules: 42, succeeded: true)
+        metrics.recordGeneration(seconds: 0.25, rules: 0, succeeded: false)
+
+        let text = metrics.text(server: nil, content: content)
+        XCTAssertTrue(text.hasSuffix("\n"))
+        XCTAssertTrue(text.contains("# TYPE ssxng_pac_server_requests_total counter\n"))
+        let samples = self.samples(text)
+        XCTAssertEqual(samples["ssxng_pac_server_requests_total{path=\"/proxy.pac\",status=\"200\"}"], "1")
+        XCTAssertEqual(samples["ssxng_pac_server_requests_total{path=\"/proxy.pac\",status=\"304\"}"], "1")
+        XCTAssertEqual(samples["ssxng_pac_server_requests_total{path=\"/proxy.pac\",status=\"404\"}"], "1")
+        XCTAssertEqual(samples["ssxng_pac_server_requests_total{path=\"/wpad.dat\",status=\"200\"}"], "1")
+
+        let gzipBytes = content.variant(acceptEncoding: "gzip").body.length
+        XCTAssertEqual(samples["ssxng_pac_server_body_bytes_total"], String(gzipBytes + pac.count))
+        XCTAssertEqual(Double(samples["ssxng_pac_not_modified_ratio"]!)!, 1.0 / 3, accuracy: 1e-9)
+        XCTAssertEqual(Double(samples["ssxng_pac_compression_ratio"]!)!
+            , Double(gzipBytes + pac.count) / Double(2 * pac.count), accuracy: 1e-9)
+        XCTAssertEqual(samples["ssxng_pac_bytes{encoding=\"identity\"}"], String(pac.count))
+
+        XCTAssertEqual(samples["ssxng_pac_generations_total{result=\"succeeded\"}"], "1")
+        XCTAssertEqual(samples["ssxng_pac_generations_total{result=\"failed\"}"], "1")
+        XCTAssertEqual(samples["ssxng_pac_generation_seconds_sum"], "0.75")
+        XCTAssertEqual(samples["ssxng_pac_generation_seconds_count"], "2")
+        XCTAssertEqual(samples["ssxng_pac_generation_last_seconds"], "0.25")
+        // The rules of the last PAC actually written.
+        XCTAssertEqual(samples["ssxng_pac_rules"], "42")
+        XCTAssertNil(samples["ssxng_pac_server_connections"])
+    }
+
+    func testConnections() throws {
+        let server = GCDWebServer()
+        server.addHandler(forMethod: "GET", path: "/metrics", request: GCDWebServerRequest.self) { [weak server] _ in
+            return GCDWebServerDataResponse(text: PACServerMetrics().text(server: server, content: nil))
+        }
+        try server.start(options: [GCDWebServerOption_Port: 0, GCDWebServerOption_BindToLocalhost: true])
+        defer {
+            server.stop()
+        }
+        let url = URL(string: "http://127.0.0.1:\(server.port)/metrics")!
+        let text = try String(contentsOf: url)
+        let samples = self.samples(text)
+        // Counted from within the request, on its own connection.
+        XCTAssertEqual(samples["ssxng_pac_server_connections"], "1")
+        XCTAssertEqual(samples["ssxng_pac_server_connections_total"], "1")
+        XCTAssertEqual(samples["ssxng_pac_server_refused_connections_total"], "0")
+    }
+}
@@ -0,0 +1,189 @@
+#!/usr/bin/env node
+//
+//  http-bench.js
+//  ShadowsocksX-NG
+//
+//  Loopback benchmark of the PAC server, or of any HTTP server serving a
+//  URL. Runs the same load once on persistent connections and once with
+//  "Connection: close" on every request, as every PAC fetch was before
+//  GCDWebServerConnection kept connections open, and reports for each:
+//    - requests per second over the run
+//    - latency percentiles, from writing a request to its last body byte
+//    - connections opened, i.e. TCP handshakes and sockets left in
+//      TIME_WAIT
+//
+//  usage: node tools/http-bench/http-bench.js [options] [URL]
+//
+//    URL                default http://127.0.0.1:1089/proxy.pac, the PAC
+//                       server with the default PacServer.ListenPort
+//    --connections N    concurrent clients, each on its own connection
+//                       when kept alive (default 8)
+//    --duration S       seconds per mode (default 5)
+//    --mode MODE        keep-alive, close or both (default both)
+//    --header "K: V"    extra request header, repeatable. Accept-Encoding
+//                       defaults to gzip
+//    --json FILE        write the results as JSON
+//
+
+'use strict';
+
+const fs = require('fs');
+const http = require('http');
+
+function parseArgs(argv) {
+  const opts = {
+    url: 'http://127.0.0.1:1089/proxy.pac', connections: 8, duration: 5, modes: ['keep-alive', 'close'],
+    headers: { 'Accept-Encoding': 'gzip' }, json: null,
+  };
+  for (let i = 0; i < argv.length; i++) {
+    const arg = argv[i];
+    const value = () => {
+      if (i + 1 >= argv.length) {
+        throw new Error(arg + ' needs a value');
+      }
+      return argv[++i];
+    };
+    switch (arg) {
+      case '--connections': opts.connections = parseInt(value(), 10); break;
+      case '--duration': opts.duration = parseFloat(value()); break;
+      case '--mode': {
+        const mode = value();
+        if (mode !== 'both' && mode !== 'keep-alive' && mode !== 'close') {
+          throw new Error('--mode is keep-alive, close or both');
+        }
+        opts.modes = mode === 'both' ? ['keep-alive', 'close'] : [mode];
+        break;
+      }
+      case '--header': {
+        const header = value();
+        const colon = header.indexOf(':');
+        if (colon <= 0) {
+          throw new Error('--header needs "Name: value"');
+        }
+        opts.headers[header.slice(0, colon).trim()] = header.slice(colon + 1).trim();
+        break;
+      }
+      case '--json': opts.json = value(); break;
+      default:
+        if (arg.startsWith('--')) {
+          throw new Error('unknown option ' + arg);
+        }
+        opts.url = arg;
+    }
+  }
+  if (!(opts.connections > 0) || !(opts.duration > 0)) {
+    throw new Error('--connections and --duration must be positive');
+  }
+  return opts;
+}
+
+function percentile(sorted, p) {
+  return sorted.length > 0 ? sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))] : 0;
+}
+
+function request(agent, opts, keepAlive) {
+  return new Promise((resolve, reject) => {
+    const start = process.hrtime.bigint();
+    const headers = Object.assign({}, opts.headers, { Connection: keepAlive ? 'keep-alive' : 'close' });
+    const req = http.get(opts.url, { agent, headers }, (res) => {
+      let bytes = 0;
+      res.on('data', (chunk) => {
+        bytes += chunk.length;
+      });
+      res.on('end', () => {
+        resolve({ status: res.statusCode, bytes, us: Number(process.hrtime.bigint() - start) / 1e3 });
+      });
+      res.on('error', reject);
+    });
+    req.on('error', reject);
+  });
+}
+
+async function run(opts, mode) {
+  const keepAlive = mode === 'keep-alive';
+  const agent = new http.Agent({ keepAlive, maxSockets: opts.connections });
+  const sockets = new WeakSet();
+  let connections = 0;
+  const originalCreateConnection = agent.createConnection;
+  agent.createConnection = function() {
+    const socket = originalCreateConnection.apply(this, arguments);
+    if (!sockets.has(socket)) {
+      sockets.add(socket);
+      connections++;
+    }
+    return socket;
+  };
+
+  const latencies = [];
+  const statuses = {};
+  let bytes = 0;
+  let errors = 0;
+  const start = process.hrtime.bigint();
+  const end = start + BigInt(Math.round(opts.duration * 1e9));
+  const client = async () => {
+    while (process.hrtime.bigint() < end) {
+      try {
+        const r = await request(agent, opts, keepAlive);
+        latencies.push(r.us);
+        statuses[r.status] = (statuses[r.status] || 0) + 1;
+        bytes += r.bytes;
+      } catch (e) {
+        errors++;
+        if (errors === 1) {
+          console.error('http-bench: ' + mode + ': ' + e.message);
+        }
+      }
+    }
+  };
+  await Promise.all(Array.from({ length: opts.connections }, client));
+  const seconds = Number(process.hrtime.bigint() - start) / 1e9;
+  agent.destroy();
+
+  latencies.sort((a, b) => a - b);
+  return {
+    mode, requests: latencies.length, errors, seconds, rps: latencies.length / seconds, connections, bytes, statuses,
+    us: {
+      mean: latencies.reduce((a, b) => a + b, 0) / Math.max(latencies.length, 1),
+      p50: percentile(latencies, 0.5), p90: percentile(latencies, 0.9), p99: percentile(latencies, 0.99),
+      max: latencies.length > 0 ? latencies[latencies.length - 1] : 0,
+    },
+  };
+}
+
+function format(results, opts) {
+  const lines = [
+    'http-bench: ' + opts.url + ', ' + opts.connections + ' clients, ' + opts.duration + ' s per mode',
+    'mode              req/s   errors  connections     mean      p50      p90      p99      max  (us)',
+  ];
+  for (const r of results) {
+    lines.push(r.mode.padEnd(12) + r.rps.toFixed(0).padStart(11) + String(r.errors).padStart(9)
+      + String(r.connections).padStart(13)
+      + ['mean', 'p50', 'p90', 'p99', 'max'].map((k) => r.us[k].toFixed(0).padStart(9)).join(''));
+  }
+  if (results.length === 2 && results[1].rps > 0) {
+    lines.push('keep-alive serves ' + (results[0].rps / results[1].rps).toFixed(2) + 'x the requests per second'
+      + ' of a connection per request');
+  }
+  return lines.join('\n');
+}
+
+async function main() {
+  const opts = parseArgs(process.argv.slice(2));
+  const results = [];
+  for (const mode of opts.modes) {
+    results.push(await run(opts, mode));
+  }
+  console.log(format(results, opts));
+  if (opts.json) {
+    fs.writeFileSync(opts.json, JSON.stringify({ url: opts.url, connections: opts.connections, results }, null, 2)
+      + '\n');
+  }
+  if (results.some((r) => r.requests === 0)) {
+    process.exitCode = 1;
+  }
+}
+
+main().catch((e) => {
+  console.error('http-bench: ' + e.message);
+  process.exitCode = 2;
+});
@@ -0,0 +1,346 @@
+//
+//  http-scanner-bench.c
+//  ShadowsocksX-NG
+//
+//  Fuzzes and benchmarks GCDWebServerHTTPScanner.h, which frames the requests
+//  of the PAC server, outside of Xcode (it is plain C, so this builds with
+//  any cc, e.g. on Linux).
+//
+//    fuzz   feeds random requests and chunked bodies, valid and mangled, to
+//           the scanner split into random reads, and checks that it returns
+//           the same result as when fed the whole buffer at once, and the
+//           token length of a plain search for valid input. Build it with
+//           -fsanitize=address,undefined to also catch reads out of bounds.
+//    bench  compares, for several read sizes, the incremental scan against
+//           searching the whole buffer again after every read, as
+//           GCDWebServerConnection did with -rangeOfData:.
+//
+//  usage: make http-scanner-bench HTTP_SCANNER_BENCH_ARGS="[options]"
+//
+//    --mode MODE        fuzz, bench or both (default both)
+//    --iterations N     fuzz cases (default 200000)
+//    --seed N           fuzz seed (default 1)
+//    --headers N        header fields of the benchmarked request (default 12)
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "GCDWebServerHTTPScanner.h"
+
+static uint64_t _random_state = 1;
+
+// xorshift64*, for runs that reproduce from a seed on every libc.
+static uint64_t next_random(void) {
+  _random_state ^= _random_state >> 12;
+  _random_state ^= _random_state << 25;
+  _random_state ^= _random_state >> 27;
+  return _random_state * 0x2545F4914F6CDD1DULL;
+}
+
+static size_t random_below(size_t n) {
+  return n ? (size_t)(next_random() % n) : 0;
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef struct {
+  char* bytes;
+  size_t length;
+  size_t capacity;
+} buffer_t;
+
+static void append(buffer_t* buffer, const void* bytes, size_t length) {
+  if (buffer->length + length > buffer->capacity) {
+    buffer->capacity = (buffer->length + length) * 2;
+    buffer->bytes = realloc(buffer->bytes, buffer->capacity);
+    if (buffer->bytes == NULL) {
+      perror("http-scanner-bench");
+      exit(2);
+    }
+  }
+  memcpy(buffer->bytes + buffer->length, bytes, length);
+  buffer->length += length;
+}
+
+static void append_string(buffer_t* buffer, const char* string) {
+  append(buffer, string, strlen(string));
+}
+
+static const char* const _header_lines[] = {
+  "Host: 127.0.0.1:1089\r\n",
+  "User-Agent: Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7) AppleWebKit/605.1.15\r\n",
+  "Accept: */*\r\n",
+  "Accept-Encoding: gzip, deflate, br\r\n",
+  "Accept-Language: en-US,en;q=0.9\r\n",
+  "Connection: keep-alive\r\n",
+  "If-None-Match: \"0123456789abcdef-gzip\"\r\n",
+  "If-Modified-Since: Tue, 14 Nov 2023 22:13:20 GMT\r\n",
+  "Cache-Control: max-age=0\r\n",
+  "X-Requested-With: \r\n",
+};
+
+static void append_request(buffer_t* buffer, size_t headers) {
+  append_string(buffer, "GET /proxy.pac HTTP/1.1\r\n");
+  for (size_t i = 0; i < headers; ++i) {
+    append_string(buffer, _header_lines[i % (sizeof(_header_lines) / sizeof(_header_lines[0]))]);
+  }
+  append_string(buffer, "\r\n");
+}
+
+// A chunk size line, or a last chunk with its trailer, of random case,
+// padding and extensions, and the expected token length.
+static size_t append_chunk(buffer_t* buffer, uint64_t size) {
+  size_t start = buffer->length;
+  char line[64];
+  for (size_t i = random_below(3); i > 0; --i) {
+    append_string(buffer, "0");
+  }
+  snprintf(line, sizeof(line), random_below(2) ? "%llx" : "%llX", (unsigned long long)size);
+  append_string(buffer, line);
+  switch (random_below(4)) {
+    case 0: append_string(buffer, ";name=value"); break;
+    case 1: append_string(buffer, " ; name=\"quoted\""); break;
+    default: break;
+  }
+  append_string(buffer, "\r\n");
+  if (size == 0) {
+    for (size_t i = random_below(3); i > 0; --i) {
+      append_string(buffer, "Trailer-Field: value\r\n");
+    }
+    append_string(buffer, "\r\n");
+  }
+  return buffer->length - start;
+}
+
+static GCDWebServerHTTPScanResult scan_whole(GCDWebServerHTTPScannerMode mode, const char* bytes, size_t length, size_t* offset) {
+  GCDWebServerHTTPScanner scanner;
+  GCDWebServerHTTPScannerInit(&scanner, mode);
+  GCDWebServerHTTPScanResult result = GCDWebServerHTTPScan(&scanner, bytes, length);
+  *offset = scanner.offset;
+  return result;
+}
+
+// Grows the buffer handed to the scanner by random reads, as
+// GCDWebServerConnection does, each copied to its own allocation so the
+// sanitizers see any byte read past the end of the buffer.
+static GCDWebServerHTTPScanResult scan_split(GCDWebServerHTTPScannerMode mode, const char* bytes, size_t length, size_t* offset) {
+  GCDWebServerHTTPScanner scanner;
+  GCDWebServerHTTPScannerInit(&scanner, mode);
+  GCDWebServerHTTPScanResult result = kGCDWebServerHTTPScanResult_NeedMoreData;
+  size_t received = 0;
+  while (result == kGCDWebServerHTTPScanResult_NeedMoreData && received < length) {
+    size_t read = 1 + random_below(random_below(2) ? 8 : length - received);
+    received += read < length - received ? read : length - received;
+    char* copy = malloc(received ? received : 1);
+    memcpy(copy, bytes, received);
+    result = GCDWebServerHTTPScan(&scanner, copy, received);
+    free(copy);
+  }
+  *offset = scanner.offset;
+  return result;
+}
+
+static const char* const _result_names[] = {"need-more-data", "complete", "invalid"};
+
+// Checks that the scanner returns the same whether fed bytes at once or in
+// random reads, and that it completes at expected if it is not negative, or
+// that it does not complete at all if expected is -2.
+static int check(const char* what, GCDWebServerHTTPScannerMode mode, const char* bytes, size_t length, long expected) {
+  size_t wholeOffset, splitOffset;
+  GCDWebServerHTTPScanResult whole = scan_whole(mode, bytes, length, &wholeOffset);
+  GCDWebServerHTTPScanResult split = scan_split(mode, bytes, length, &splitOffset);
+  int failed = whole != split || (whole == kGCDWebServerHTTPScanResult_Complete && wholeOffset != splitOffset);
+  if (expected >= 0) {
+    failed |= whole != kGCDWebServerHTTPScanResult_Complete || wholeOffset != (size_t)expected;
+  } else if (expected == -2) {
+    failed |= whole == kGCDWebServerHTTPScanResult_Complete;
+  }
+  if (failed) {
+    fprintf(stderr, "http-scanner-bench: %s: whole %s at %zu, split %s at %zu, expected %ld for %zu bytes:\n", what,
+            _result_names[whole], wholeOffset, _result_names[split], splitOffset, expected, length);
+    fwrite(bytes, 1, length < 512 ? length : 512, stderr);
+    fputc('\n', stderr);
+  }
+  return failed;
+}
+
+// Replaces, inserts or deletes a few random bytes, mostly framing ones.
+static void mangle(buffer_t* buffer) {
+  static const char alphabet[] = "\r\n\r\n;0 \tfF:x\x80";
+  for (size_t i = 1 + random_below(3); i > 0 && buffer->length > 0; --i) {
+    size_t at = random_below(buffer->length);
+    char c = random_below(4) ? alphabet[random_below(sizeof(alphabet) - 1)] : (char)random_below(256);
+    switch (random_below(3)) {
+      case 0:
+        buffer->bytes[at] = c;
+        break;
+      case 1:
+        append(buffer, "", 1);
+        memmove(buffer->bytes + at + 1, buffer->bytes + at, buffer->length - at - 1);
+        buffer->bytes[at] = c;
+        break;
+      default:
+        memmove(buffer->bytes + at, buffer->bytes + at + 1, buffer->length - at - 1);
+        buffer->length -= 1;
+    }
+  }
+}
+
+// The end of the headers as found by searching from the start of the buffer,
+// like -[NSData rangeOfData:options:range:].
+static size_t rescan(const char* bytes, size_t length) {
+  for (size_t i = 0; i + 4 <= length; ++i) {
+    if (bytes[i] == '\r' && memcmp(bytes + i, "\r\n\r\n", 4) == 0) {
+      return i + 4;
+    }
+  }
+  return 0;
+}
+
+static int fuzz(unsigned long iterations) {
+  buffer_t buffer = {0};
+  unsigned long failures = 0;
+  unsigned long outcomes[3] = {0};
+  for (unsigned long i = 0; i < iterations && failures < 10; ++i) {
+    buffer.length = 0;
+    GCDWebServerHTTPScannerMode mode = random_below(2) ? kGCDWebServerHTTPScannerMode_Chunk : kGCDWebServerHTTPScannerMode_Headers;
+    long expected;
+    if (mode == kGCDWebServerHTTPScannerMode_Headers) {
+      append_request(&buffer, random_below(16));
+      expected = (long)rescan(buffer.bytes, buffer.length);
+    } else {
+      uint64_t size = random_below(4) ? random_below(1 << (random_below(5) * 6)) : (random_below(2) ? 0 : next_random() >> 4);
+      expected = (long)append_chunk(&buffer, size);
+    }
+    // The next pipelined request or chunk data, which the scanner must not reach.
+    append_string(&buffer, random_below(2) ? "\r\n\r\nPOST / HTTP/1.1\r\n" : "7\r\ndata\r\n\r\n");
+
+    size_t offset;
+    switch (random_below(4)) {
+      case 0:  // Truncated
+        buffer.length = random_below((size_t)expected);
+        failures += check("truncated", mode, buffer.bytes, buffer.length, -2);
+        break;
+      case 1:  // Mangled
+        mangle(&buffer);
+        if (mode == kGCDWebServerHTTPScannerMode_Headers) {  // Any bytes end at the first empty line
+          expected = (long)rescan(buffer.bytes, buffer.length);
+          failures += check("mangled", mode, buffer.bytes, buffer.length, expected ? expected : -2);
+        } else {
+          failures += check("mangled", mode, buffer.bytes, buffer.length, -1);
+        }
+        break;
+      default:
+        failures += check("valid", mode, buffer.bytes, buffer.length, expected);
+    }
+    outcomes[scan_whole(mode, buffer.bytes, buffer.length, &offset)] += 1;
+  }
+
+  // Chunk size lines at the length limit, and one past it.
+  for (size_t padding = kGCDWebServerHTTPScannerMaxChunkLineLength - 16; padding < kGCDWebServerHTTPScannerMaxChunkLineLength + 16; ++padding) {
+    buffer.length = 0;
+    append_string(&buffer, "a;");
+    while (buffer.length < padding - 2) {
+      append_string(&buffer, "x");
+    }
+    append_string(&buffer, "\r\n");
+    failures += check("long line", kGCDWebServerHTTPScannerMode_Chunk, buffer.bytes, buffer.length,
+                      buffer.length <= kGCDWebServerHTTPScannerMaxChunkLineLength ? (long)buffer.length : -2);
+  }
+
+  printf("fuzz: %lu cases, %lu complete, %lu need more data, %lu invalid, %lu failures\n", iterations,
+         outcomes[kGCDWebServerHTTPScanResult_Complete], outcomes[kGCDWebServerHTTPScanResult_NeedMoreData],
+         outcomes[kGCDWebServerHTTPScanResult_Invalid], failures);
+  free(buffer.bytes);
+  return failures ? 1 : 0;
+}
+
+static int bench(size_t headers) {
+  buffer_t request = {0};
+  append_request(&request, headers);
+  static const size_t read_sizes[] = {1, 16, 64, 256, 0};
+  printf("bench: %zu byte request with %zu header fields\n", request.length, headers);
+  printf("read size     rescan ns/req   incremental ns/req   speedup\n");
+  volatile size_t sink = 0;
+  for (size_t r = 0; r < sizeof(read_sizes) / sizeof(read_sizes[0]); ++r) {
+    size_t read = read_sizes[r] ? read_sizes[r] : request.length;
+    double results[2];
+    for (int incremental = 0; incremental < 2; ++incremental) {
+      unsigned long rounds = 0;
+      double start = now();
+      double elapsed;
+      do {
+        for (int i = 0; i < 1000; ++i) {
+          GCDWebServerHTTPScanner scanner;
+          GCDWebServerHTTPScannerInit(&scanner, kGCDWebServerHTTPScannerMode_Headers);
+          size_t end = 0;
+          for (size_t received = read < request.length ? read : request.length; end == 0; received += read) {
+            if (received > request.length) {
+              received = request.length;
+            }
+            if (incremental) {
+              end = GCDWebServerHTTPScan(&scanner, request.bytes, received) == kGCDWebServerHTTPScanResult_Complete ? scanner.offset : 0;
+            } else {
+              end = rescan(request.bytes, received);
+            }
+          }
+          sink += end;
+        }
+        rounds += 1000;
+        elapsed = now() - start;
+      } while (elapsed < 0.5);
+      results[incremental] = elapsed * 1e9 / rounds;
+    }
+    char label[16];
+    snprintf(label, sizeof(label), read_sizes[r] ? "%zu" : "whole", read);
+    printf("%9s %17.0f %20.0f %8.1fx\n", label, results[0], results[1], results[0] / results[1]);
+  }
+  free(request.bytes);
+  return sink ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+  int run_fuzz = 1, run_bench = 1;
+  unsigned long iterations = 200000;
+  size_t headers = 12;
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    if (i + 1 >= argc) {
+      fprintf(stderr, "http-scanner-bench: %s\n", strncmp(arg, "--", 2) == 0 ? "option needs a value" : "unknown argument");
+      return 2;
+    }
+    const char* value = argv[++i];
+    if (strcmp(arg, "--mode") == 0) {
+      run_fuzz = strcmp(value, "fuzz") == 0 || strcmp(value, "both") == 0;
+      run_bench = strcmp(value, "bench") == 0 || strcmp(value, "both") == 0;
+      if (!run_fuzz && !run_bench) {
+        fprintf(stderr, "http-scanner-bench: --mode is fuzz, bench or both\n");
+        return 2;
+      }
+    } else if (strcmp(arg, "--iterations") == 0) {
+      iterations = strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "--seed") == 0) {
+      _random_state = strtoull(value, NULL, 10) | 1;
+    } else if (strcmp(arg, "--headers") == 0) {
+      headers = strtoul(value, NULL, 10);
+    } else {
+      fprintf(stderr, "http-scanner-bench: unknown option %s\n", arg);
+      return 2;
+    }
+  }
+  int status = 0;
+  if (run_fuzz) {
+    status |= fuzz(iterations);
+  }
+  if (run_bench) {
+    status |= bench(headers);
+  }
+  return status;
+}
@@ -0,0 +1,434 @@
+#!/usr/bin/env node
+//
+//  pac-audit.js
+//  ShadowsocksX-NG
+//
+//  Routes a list of URLs, e.g. from proxy logs, through a generated
+//  gfwlist.js offline and aggregates the decisions, to check a gfwlist or
+//  user rule change against real traffic before rolling it out.
+//
+//  The PAC is evaluated as a client evaluates it, in a fresh JavaScript
+//  context, once per worker thread. Reports:
+//    - how many URLs go through the proxy and how many DIRECT
+//    - the rules deciding the most URLs, table entries included
+//    - the rules costing the most time, estimated from a sample of URLs
+//    - with --compare, the URLs a second PAC routes differently, by the
+//      rules deciding them before and after
+//
+//  usage: node tools/pac-audit/pac-audit.js [options] [FILE ...]
+//
+//    FILE               lines holding a URL, or a host:port as CONNECT logs
+//                       them, anywhere in the line. "#" comments. Reads
+//                       stdin without FILE or for "-"
+//    --pac FILE         the PAC, by default ~/.ShadowsocksX-NG/gfwlist.js,
+//                       which GeneratePACFile() writes
+//    --compare FILE     a second PAC, e.g. generated from candidate rules
+//    --jobs N           worker threads (default: one per CPU)
+//    --strip-https      pass https URLs as scheme://host/, as browsers do
+//    --print            print "PROXY|DIRECT<tab>rule<tab>url" for each URL,
+//                       in input order, instead of the report
+//    --top N            rules listed per table (default 20)
+//    --json FILE        write the aggregates as JSON
+//
+
+'use strict';
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const readline = require('readline');
+const vm = require('vm');
+const { Worker, isMainThread, parentPort, workerData } = require('worker_threads');
+
+const chunkSize = 4096;
+// Chunks queued per worker, so reading stays ahead without buffering the
+// whole input.
+const inFlightPerWorker = 2;
+// One URL in timingSample is timed, and the timings are scaled up by it.
+const timingSample = 8;
+
+function parseArgs(argv) {
+  const opts = {
+    pac: path.join(os.homedir(), '.ShadowsocksX-NG', 'gfwlist.js'), compare: null, jobs: os.cpus().length,
+    stripHTTPS: false, print: false, top: 20, json: null, files: [],
+  };
+  for (let i = 0; i < argv.length; i++) {
+    const arg = argv[i];
+    const value = () => {
+      if (i + 1 >= argv.length) {
+        throw new Error(arg + ' needs a value');
+      }
+      return argv[++i];
+    };
+    switch (arg) {
+      case '--pac': opts.pac = value(); break;
+      case '--compare': opts.compare = value(); break;
+      case '--jobs': opts.jobs = parseInt(value(), 10); break;
+      case '--strip-https': opts.stripHTTPS = true; break;
+      case '--print': opts.print = true; break;
+      case '--top': opts.top = parseInt(value(), 10); break;
+      case '--json': opts.json = value(); break;
+      default:
+        if (arg.startsWith('--')) {
+          throw new Error('unknown option ' + arg);
+        }
+        opts.files.push(arg);
+    }
+  }
+  if (!(opts.jobs > 0) || !(opts.top > 0)) {
+    throw new Error('--jobs and --top must be positive');
+  }
+  return opts;
+}
+
+const urlRegExp = /^[a-z][\w+.-]*:\/\/\S+$/i;
+const hostPortRegExp = /^(\[[0-9a-f:.]+\]|[^\s\/:]+):(\d+)$/i;
+
+// The URL and the host passed to FindProxyForURL for a log line, null if the
+// line has neither a URL nor a host:port.
+function parseLine(line, stripHTTPS) {
+  for (const field of line.split(/\s+/)) {
+    let url = null;
+    if (urlRegExp.test(field)) {
+      url = field;
+    } else {
+      const m = hostPortRegExp.exec(field);
+      if (m) {
+        url = m[2] === '443' ? 'https://' + m[1] + '/' : 'http://' + m[1] + (m[2] === '80' ? '' : ':' + m[2]) + '/';
+      }
+    }
+    if (url === null) {
+      continue;
+    }
+    let rest = url.slice(url.indexOf('://') + 3);
+    const end = rest.search(/[\/?#]/);
+    const authority = end < 0 ? rest : rest.slice(0, end);
+    let host = authority.slice(authority.lastIndexOf('@') + 1);
+    if (host[0] === '[') {
+      host = host.slice(1, host.indexOf(']') < 0 ? host.length : host.indexOf(']'));
+    } else if (host.indexOf(':') >= 0) {
+      host = host.slice(0, host.indexOf(':'));
+    }
+    if (stripHTTPS && /^https:/i.test(url)) {
+      url = url.slice(0, url.indexOf('://') + 3) + authority + '/';
+    }
+    return [url, host];
+  }
+  return null;
+}
+
+// MARK: - Worker
+
+function loadPAC(file) {
+  const context = vm.createContext({});
+  vm.runInContext(fs.readFileSync(file, 'utf8'), context, { filename: path.basename(file) });
+  if (typeof context.FindProxyForURL !== 'function') {
+    throw new Error(file + ' defines no FindProxyForURL');
+  }
+  if (typeof context.PACExplain !== 'function') {
+    throw new Error(file + ' has no PACExplain(), generate it again with this version');
+  }
+  return context;
+}
+
+// Times the tests of filters, by their text, while on. Timing every test
+// would more than double the run time, so only a sample of URLs is timed.
+function instrument(context, timings) {
+  const proto = context.RegExpFilter.prototype;
+  const matches = proto.matches;
+  const timed = function() {
+    const start = process.hrtime.bigint();
+    const result = matches.apply(this, arguments);
+    const ns = Number(process.hrtime.bigint() - start);
+    const t = timings.get(this.text);
+    if (t) {
+      t[0]++;
+      t[1] += ns;
+    } else {
+      timings.set(this.text, [1, ns]);
+    }
+    return result;
+  };
+  return (on) => {
+    proto.matches = on ? timed : matches;
+  };
+}
+
+function runWorker() {
+  const opts = workerData;
+  const pac = loadPAC(opts.pac);
+  const compare = opts.compare ? loadPAC(opts.compare) : null;
+  const timings = new Map();
+  const timing = instrument(pac, timings);
+  let n = 0;
+
+  // rule -> [URLs, proxied]
+  const rules = new Map();
+  // "before\tafter" -> [URLs, an example]
+  const changes = new Map();
+  let proxied = 0;
+
+  parentPort.on('message', (message) => {
+    if (message.done) {
+      parentPort.postMessage({ done: true, proxied, rules: [...rules], changes: [...changes], timings: [...timings] });
+      return;
+    }
+    const out = opts.print ? [] : null;
+    for (const [url, host] of message.entries) {
+      const timed = n++ % timingSample === 0;
+      if (timed) {
+        timing(true);
+      }
+      const isProxy = pac.FindProxyForURL(url, host).lastIndexOf('DIRECT', 0) !== 0;
+      if (timed) {
+        timing(false);
+      }
+      const rule = pac.PACExplain(url, host) || '';
+      if (isProxy) {
+        proxied++;
+      }
+      const r = rules.get(rule);
+      if (r) {
+        r[0]++;
+        r[1] += isProxy ? 1 : 0;
+      } else {
+        rules.set(rule, [1, isProxy ? 1 : 0]);
+      }
+      if (compare) {
+        const wasProxy = compare.FindProxyForURL(url, host).lastIndexOf('DIRECT', 0) !== 0;
+        if (wasProxy !== isProxy) {
+          const key = (wasProxy ? 'PROXY ' : 'DIRECT ') + (compare.PACExplain(url, host) || '-') + '\t'
+            + (isProxy ? 'PROXY ' : 'DIRECT ') + (rule || '-');
+          const c = changes.get(key);
+          if (c) {
+            c[0]++;
+          } else {
+            changes.set(key, [1, url]);
+          }
+        }
+      }
+      if (out) {
+        out.push((isProxy ? 'PROXY\t' : 'DIRECT\t') + (rule || '-') + '\t' + url);
+      }
+    }
+    parentPort.postMessage({ id: message.id, lines: out });
+  });
+}
+
+// MARK: - Main
+
+function startWorkers(opts) {
+  const workers = [];
+  for (let i = 0; i < opts.jobs; i++) {
+    const worker = new Worker(__filename, {
+      workerData: { pac: opts.pac, compare: opts.compare, print: opts.print },
+    });
+    worker.inFlight = 0;
+    workers.push(worker);
+  }
+  return workers;
+}
+
+async function* inputLines(files) {
+  for (const file of files.length > 0 ? files : ['-']) {
+    const input = file === '-' ? process.stdin : fs.createReadStream(file);
+    for await (const line of readline.createInterface({ input, crlfDelay: Infinity })) {
+      yield line;
+    }
+  }
+}
+
+async function audit(opts) {
+  const workers = startWorkers(opts);
+  const printed = new Map();
+  let nextPrinted = 0;
+  let waiting = null;
+  let failure = null;
+  const results = [];
+
+  for (const worker of workers) {
+    worker.on('error', (e) => {
+      failure = failure || e;
+      if (waiting) {
+        waiting();
+      }
+    });
+    worker.on('message', (message) => {
+      if (message.done) {
+        results.push(message);
+      } else {
+        worker.inFlight--;
+        if (message.lines) {
+          printed.set(message.id, message.lines);
+          while (printed.has(nextPrinted)) {
+            process.stdout.write(printed.get(nextPrinted).join('\n') + '\n');
+            printed.delete(nextPrinted++);
+          }
+        }
+      }
+      if (waiting) {
+        waiting();
+      }
+    });
+  }
+  const wait = () => new Promise((resolve) => {
+    if (failure) {
+      resolve();
+      return;
+    }
+    waiting = () => {
+      waiting = null;
+      resolve();
+    };
+  });
+  const check = () => {
+    if (failure) {
+      throw failure;
+    }
+  };
+
+  let urls = 0;
+  let unparsed = 0;
+  let chunks = 0;
+  let entries = [];
+  const send = async () => {
+    let worker;
+    while (!(worker = workers.find((w) => w.inFlight < inFlightPerWorker))) {
+      await wait();
+      check();
+    }
+    worker.inFlight++;
+    worker.postMessage({ id: chunks++, entries });
+    entries = [];
+  };
+
+  const start = process.hrtime.bigint();
+  for await (const line of inputLines(opts.files)) {
+    if (line.length === 0 || line[0] === '#') {
+      continue;
+    }
+    const entry = parseLine(line, opts.stripHTTPS);
+    if (entry === null) {
+      unparsed++;
+      continue;
+    }
+    entries.push(entry);
+    urls++;
+    if (entries.length === chunkSize) {
+      await send();
+    }
+  }
+  if (entries.length > 0) {
+    await send();
+  }
+  while (workers.some((w) => w.inFlight > 0)) {
+    await wait();
+    check();
+  }
+  for (const worker of workers) {
+    worker.postMessage({ done: true });
+  }
+  while (results.length < workers.length) {
+    await wait();
+    check();
+  }
+  const seconds = Number(process.hrtime.bigint() - start) / 1e9;
+  await Promise.all(workers.map((w) => w.terminate()));
+  return merge(results, { urls, unparsed, seconds, jobs: workers.length });
+}
+
+function merge(results, totals) {
+  const rules = new Map();
+  const changes = new Map();
+  const timings = new Map();
+  let proxied = 0;
+  const add = (map, key, values) => {
+    const v = map.get(key);
+    if (v) {
+      for (let i = 0; i < v.length; i++) {
+        if (typeof v[i] === 'number') {
+          v[i] += values[i];
+        }
+      }
+    } else {
+      map.set(key, values.slice());
+    }
+  };
+  for (const r of results) {
+    proxied += r.proxied;
+    r.rules.forEach(([k, v]) => add(rules, k, v));
+    r.changes.forEach(([k, v]) => add(changes, k, v));
+    r.timings.forEach(([k, v]) => add(timings, k, v));
+  }
+  return Object.assign(totals, {
+    proxied,
+    rules: [...rules].map(([rule, [count, proxy]]) => ({ rule: rule || null, count, proxied: proxy }))
+      .sort((a, b) => b.count - a.count),
+    slowest: [...timings]
+      .map(([rule, [tests, ns]]) => ({ rule, tests: tests * timingSample, ms: ns * timingSample / 1e6 }))
+      .sort((a, b) => b.ms - a.ms),
+    changed: [...changes].map(([key, [count, example]]) => {
+      const [before, after] = key.split('\t');
+      return { before, after, count, example };
+    }).sort((a, b) => b.count - a.count),
+  });
+}
+
+function format(report, opts) {
+  const pct = (n) => (report.urls > 0 ? n / report.urls * 100 : 0).toFixed(1).padStart(5) + '%';
+  const lines = [
+    'pac-audit: ' + report.urls + ' URLs, ' + report.unparsed + ' lines without one, ' + report.seconds.toFixed(1)
+      + ' s on ' + report.jobs + ' workers, ' + Math.round(report.urls / Math.max(report.seconds, 1e-9)) + ' URLs/s',
+    path.basename(opts.pac) + ': ' + report.proxied + ' PROXY (' + pct(report.proxied).trim() + '), '
+      + (report.urls - report.proxied) + ' DIRECT',
+    '',
+    'rules deciding the most URLs:',
+    '     URLs   share   proxied  rule',
+  ];
+  for (const r of report.rules.slice(0, opts.top)) {
+    lines.push(String(r.count).padStart(9) + ' ' + pct(r.count) + String(r.proxied).padStart(10) + '  '
+      + (r.rule === null ? '(no rule, DIRECT)' : r.rule));
+  }
+  lines.push('', 'rules costing the most time, over every test of them, estimated from 1 URL in ' + timingSample + ':',
+    '  total ms      tests  ns/test  rule');
+  for (const r of report.slowest.slice(0, opts.top)) {
+    lines.push(r.ms.toFixed(1).padStart(10) + String(r.tests).padStart(11)
+      + String(Math.round(r.ms * 1e6 / r.tests)).padStart(9) + '  ' + r.rule);
+  }
+  if (opts.compare) {
+    const changed = report.changed.reduce((n, c) => n + c.count, 0);
+    lines.push('', path.basename(opts.compare) + ' -> ' + path.basename(opts.pac) + ': ' + changed
+      + ' URLs routed differently (' + pct(changed).trim() + ')');
+    for (const c of report.changed.slice(0, opts.top)) {
+      lines.push(String(c.count).padStart(9) + '  ' + c.before + '  ->  ' + c.after + '   e.g. ' + c.example);
+    }
+  }
+  return lines.join('\n');
+}
+
+async function main() {
+  const opts = parseArgs(process.argv.slice(2));
+  const report = await audit(opts);
+  if (!opts.print) {
+    console.log(format(report, opts));
+  }
+  if (opts.json) {
+    fs.writeFileSync(opts.json, JSON.stringify(report, null, 2) + '\n');
+  }
+}
+
+if (isMainThread) {
+  // Stop quietly when the reader of --print goes away, e.g. head(1).
+  process.stdout.on('error', (e) => {
+    if (e.code !== 'EPIPE') {
+      throw e;
+    }
+    process.exit(0);
+  });
+  main().catch((e) => {
+    console.error('pac-audit: ' + e.message);
+    process.exitCode = 2;
+  });
+} else {
+  runWorker();
+}
@@ -0,0 +1,357 @@
+#!/usr/bin/env node
+//
+//  pac-bench.js
+//  ShadowsocksX-NG
+//
+//  Offline benchmark of a generated gfwlist.js, evaluated the way a client
+//  evaluates a PAC: in a fresh JavaScript context of an embedded engine,
+//  here V8 through node's vm module.
+//
+//  Reports, per PAC file:
+//    - init: compiling and running the script, which builds the matcher
+//    - heap: what a context holding the PAC retains after a GC, once it
+//      has answered the whole corpus
+//    - cold: FindProxyForURL latency on the first pass over the corpus in a
+//      fresh context, so every call misses the matcher's result cache
+//    - hot:  the same on later passes, with the caches and the JIT warm
+//    - cache: the matcher's result cache counters after the first context's
+//      passes, if the PAC has the PACCacheStats() debug hook
+//
+//  usage: node --expose-gc tools/pac-bench/pac-bench.js [options] [gfwlist.js ...]
+//
+//    --corpus FILE      lines of "url [host]", "#" comments. Defaults to
+//                       URLs derived from the hosts in the rules, with
+//                       page views of Zipf-distributed sites in between
+//    --runs N           fresh contexts for init, heap and cold (default 3)
+//    --passes N         hot passes per context (default 3)
+//    --json FILE        write the results as JSON
+//    --baseline FILE    compare with a --json file of an earlier run and
+//                       exit 1 if a metric regressed more than
+//    --tolerance PCT    this percentage (default 10)
+//
+//  Without a PAC file the bundled abp.js, gfwlist.txt and user-rule.txt are
+//  rendered the way GeneratePACFile() did before precompiled tables. To gate
+//  a generator change, benchmark the gfwlist.js it writes against a baseline
+//  run of the one before it.
+//
+
+'use strict';
+
+const fs = require('fs');
+const path = require('path');
+const vm = require('vm');
+const v8 = require('v8');
+
+const repo = path.resolve(__dirname, '..', '..');
+
+function parseArgs(argv) {
+  const opts = { corpus: null, runs: 3, passes: 3, json: null, baseline: null, tolerance: 10, pacs: [] };
+  for (let i = 0; i < argv.length; i++) {
+    const arg = argv[i];
+    const value = () => {
+      if (i + 1 >= argv.length) {
+        throw new Error(arg + ' needs a value');
+      }
+      return argv[++i];
+    };
+    switch (arg) {
+      case '--corpus': opts.corpus = value(); break;
+      case '--runs': opts.runs = parseInt(value(), 10); break;
+      case '--passes': opts.passes = parseInt(value(), 10); break;
+      case '--json': opts.json = value(); break;
+      case '--baseline': opts.baseline = value(); break;
+      case '--tolerance': opts.tolerance = parseFloat(value()); break;
+      default:
+        if (arg.startsWith('--')) {
+          throw new Error('unknown option ' + arg);
+        }
+        opts.pacs.push(arg);
+    }
+  }
+  if (!(opts.runs > 0) || !(opts.passes > 0)) {
+    throw new Error('--runs and --passes must be positive');
+  }
+  return opts;
+}
+
+// Rule lines as PACRuleSet merges them, user rules first.
+function bundledRules() {
+  const dir = path.join(repo, 'ShadowsocksX-NG');
+  const gfwlist = Buffer.from(fs.readFileSync(path.join(dir, 'gfwlist.txt'), 'utf8'), 'base64').toString('utf8');
+  const userRules = fs.readFileSync(path.join(dir, 'user-rule.txt'), 'utf8');
+  const lines = (userRules + '\n' + gfwlist).split(/[\n\r\u000b\u000c\u0085\u2028\u2029]/);
+  return [...new Set(lines.filter((l) => l && l[0] !== '!' && l[0] !== '['))];
+}
+
+function bundledPAC() {
+  const template = fs.readFileSync(path.join(repo, 'ShadowsocksX-NG', 'abp.js'), 'utf8');
+  const emptyTable = { domains: [], suffixes: {}, prefixes: [], ipv4: [], ipv6: [] };
+  return template
+    .replace('__RULES__', JSON.stringify(bundledRules(), null, 2))
+    .replace('__TABLES__', JSON.stringify({ proxy: emptyTable, direct: emptyTable }))
+    .replace(/__SOCKS5ADDR__/g, '127.0.0.1')
+    .replace(/__SOCKS5PORT__/g, '1086');
+}
+
+function loadCorpus(file) {
+  const entries = [];
+  if (file) {
+    for (const line of fs.readFileSync(file, 'utf8').split('\n')) {
+      const fields = line.trim().split(/\s+/);
+      if (!fields[0] || fields[0][0] === '#') {
+        continue;
+      }
+      const url = fields[0];
+      const host = fields[1] || (url.match(/^[a-z][\w+.-]*:\/\/([^\/:?#]+)/i) || [])[1] || '';
+      entries.push([url, host]);
+    }
+    return entries;
+  }
+  // Every host named by a rule, its subdomains, look-alikes and unrelated
+  // paths, so the corpus hits the proxy, direct and no-match paths.
+  const hosts = new Set();
+  for (const rule of bundledRules()) {
+    const m = rule.match(/^(?:@@)?\|{0,2}(?:https?:\/\/)?([a-z0-9.\-]+)/i);
+    if (m) {
+      hosts.add(m[1].replace(/^\./, '').toLowerCase());
+    }
+  }
+  // Browsing revisits a few sites far more than the rest, and fetches
+  // several URLs per page from its host. After the first visit of each host
+  // comes a page view of a site drawn with Zipf's law over the hosts, in a
+  // fixed shuffled order, so the result cache sees the repeats it is for.
+  const random = seededRandom(1);
+  const sites = Array.from(hosts);
+  for (let i = sites.length - 1; i > 0; i--) {
+    const j = Math.floor(random() * (i + 1));
+    [sites[i], sites[j]] = [sites[j], sites[i]];
+  }
+  const zipf = zipfSampler(sites.length, random);
+  for (const h of sites) {
+    entries.push(['https://' + h + '/', h]);
+    entries.push(['http://www.' + h + '/path/index.html?q=1', 'www.' + h]);
+    entries.push(['https://' + h + '.example/', h + '.example']);
+    const site = sites[zipf()];
+    const page = 'https://' + site + '/page/' + Math.floor(random() * 4);
+    entries.push([page, site]);
+    entries.push([page + '/app.js', site]);
+  }
+  return entries;
+}
+
+// Deterministic, so runs to compare replay the same corpus.
+function seededRandom(seed) {
+  let state = seed >>> 0;
+  return () => {
+    state = (state + 0x6d2b79f5) >>> 0;
+    let t = Math.imul(state ^ (state >>> 15), state | 1);
+    t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+    return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+  };
+}
+
+// Ranks 0..<n, rank r drawn with a probability proportional to 1 / (r + 1).
+function zipfSampler(n, random) {
+  const cumulative = new Float64Array(n);
+  let total = 0;
+  for (let r = 0; r < n; r++) {
+    total += 1 / (r + 1);
+    cumulative[r] = total;
+  }
+  return () => {
+    const u = random() * total;
+    let lo = 0;
+    let hi = n - 1;
+    while (lo < hi) {
+      const mid = (lo + hi) >> 1;
+      if (cumulative[mid] < u) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  };
+}
+
+function quantile(sorted, q) {
+  return sorted[Math.min(sorted.length - 1, Math.floor(q * sorted.length))];
+}
+
+function summarize(samples) {
+  const sorted = Float64Array.from(samples).sort();
+  let sum = 0;
+  for (const s of sorted) {
+    sum += s;
+  }
+  return {
+    mean: sum / sorted.length,
+    p50: quantile(sorted, 0.5),
+    p90: quantile(sorted, 0.9),
+    p99: quantile(sorted, 0.99),
+    max: sorted[sorted.length - 1],
+  };
+}
+
+function collectGarbage() {
+  if (global.gc) {
+    global.gc();
+    global.gc();
+  }
+}
+
+// Microseconds per call, into samples from offset on.
+function pass(find, corpus, samples, offset) {
+  for (let i = 0; i < corpus.length; i++) {
+    const start = process.hrtime.bigint();
+    find(corpus[i][0], corpus[i][1]);
+    samples[offset + i] = Number(process.hrtime.bigint() - start) / 1000;
+  }
+}
+
+function bench(source, corpus, opts) {
+  const script = new vm.Script(source, { filename: 'gfwlist.js' });
+  const init = [];
+  const heap = [];
+  // Allocated up front, so no array grows or is trimmed by the GC while
+  // the heap is measured.
+  const cold = new Float64Array(opts.runs * corpus.length);
+  const hot = new Float64Array(opts.runs * opts.passes * corpus.length);
+  const results = new Map();
+  let cache = null;
+
+  for (let run = 0; run < opts.runs; run++) {
+    const start = process.hrtime.bigint();
+    let context = vm.createContext({});
+    script.runInContext(context);
+    init.push(Number(process.hrtime.bigint() - start) / 1e6);
+
+    let find = context.FindProxyForURL;
+    if (typeof find !== 'function') {
+      throw new Error('the PAC defines no FindProxyForURL');
+    }
+    pass(find, corpus, cold, run * corpus.length);
+    for (let i = 0; i < opts.passes; i++) {
+      pass(find, corpus, hot, (run * opts.passes + i) * corpus.length);
+    }
+
+    // Every context has to agree, or the numbers compare different work.
+    if (run === 0) {
+      if (typeof context.PACCacheStats === 'function') {
+        cache = Object.assign({}, context.PACCacheStats());
+      }
+      for (const [url, host] of corpus) {
+        results.set(url + ' ' + host, find(url, host));
+      }
+    }
+
+    // What the context retains, matcher caches included: the heap with it
+    // less the heap once it is gone.
+    collectGarbage();
+    const heapWith = v8.getHeapStatistics().used_heap_size;
+    context = null;
+    find = null;
+    collectGarbage();
+    heap.push((heapWith - v8.getHeapStatistics().used_heap_size) / 1024);
+  }
+
+  let proxied = 0;
+  for (const r of results.values()) {
+    if (r.indexOf('DIRECT') !== 0) {
+      proxied++;
+    }
+  }
+  return {
+    bytes: Buffer.byteLength(source),
+    calls: corpus.length,
+    proxied,
+    initMs: summarize(init),
+    heapKB: summarize(heap),
+    coldUs: summarize(cold),
+    hotUs: summarize(hot),
+    cache,
+  };
+}
+
+function format(name, r) {
+  const f = (v, d) => v.toFixed(d).padStart(9);
+  const lines = [
+    name + ': ' + r.bytes + ' bytes, ' + r.calls + ' URLs, ' + r.proxied + ' proxied',
+    '                mean      p50      p90      p99      max',
+  ];
+  for (const [label, key, d] of [['init ms', 'initMs', 2], ['heap KB', 'heapKB', 0]
+    , ['cold us', 'coldUs', 2], ['hot us', 'hotUs', 2]]) {
+    const s = r[key];
+    lines.push(label.padEnd(8) + f(s.mean, d) + f(s.p50, d) + f(s.p90, d) + f(s.p99, d) + f(s.max, d));
+  }
+  if (r.cache) {
+    const c = r.cache;
+    const lookups = c.hits + c.misses;
+    lines.push('cache   ' + c.hits + ' hits, ' + c.misses + ' misses, ' + c.evictions + ' evictions, '
+      + (lookups > 0 ? (c.hits / lookups * 100).toFixed(1) : '0.0') + '% hit rate, ' + c.size + '/' + c.capacity + ' entries');
+  }
+  return lines.join('\n');
+}
+
+// The metrics a generator change must not make worse.
+const gated = [['initMs', 'p50'], ['heapKB', 'p50'], ['coldUs', 'p50'], ['coldUs', 'p99']
+  , ['hotUs', 'p50'], ['hotUs', 'p99']];
+
+function compare(results, baseline, tolerance) {
+  let regressions = 0;
+  for (const name of Object.keys(results)) {
+    const base = baseline[name] || Object.values(baseline)[0];
+    if (!base) {
+      continue;
+    }
+    for (const [metric, stat] of gated) {
+      const before = base[metric][stat];
+      const after = results[name][metric][stat];
+      const change = before > 0 ? (after - before) / before * 100 : 0;
+      const bad = change > tolerance;
+      if (bad) {
+        regressions++;
+      }
+      console.log((bad ? 'REGRESSED ' : 'ok        ') + name + ' ' + metric + '.' + stat + ': '
+        + before.toFixed(2) + ' -> ' + after.toFixed(2) + ' (' + (change >= 0 ? '+' : '') + change.toFixed(1) + '%)');
+    }
+  }
+  return regressions;
+}
+
+function main() {
+  const opts = parseArgs(process.argv.slice(2));
+  if (!global.gc) {
+    console.warn('warning: run node with --expose-gc for stable heap numbers');
+  }
+  const corpus = loadCorpus(opts.corpus);
+  if (corpus.length === 0) {
+    throw new Error('the corpus is empty');
+  }
+
+  const pacs = opts.pacs.length > 0
+    ? opts.pacs.map((file) => [file, fs.readFileSync(file, 'utf8')])
+    : [['bundled', bundledPAC()]];
+  const results = {};
+  for (const [name, source] of pacs) {
+    results[name] = bench(source, corpus, opts);
+    console.log(format(name, results[name]) + '\n');
+  }
+
+  if (opts.json) {
+    fs.writeFileSync(opts.json, JSON.stringify(results, null, 2) + '\n');
+  }
+  if (opts.baseline) {
+    const baseline = JSON.parse(fs.readFileSync(opts.baseline, 'utf8'));
+    if (compare(results, baseline, opts.tolerance) > 0) {
+      process.exitCode = 1;
+    }
+  }
+}
+
+try {
+  main();
+} catch (e) {
+  console.error('pac-bench: ' + e.message);
+  process.exitCode = 2;
+}
@@ -0,0 +1,177 @@
+//
+//  main.swift
+//  ShadowsocksX-NG
+//
+//  Benchmarks PACCompiler on synthetic gfwlists outside of Xcode. It is built
+//  with swiftc from the compiler sources of the app and only needs
+//  Foundation, so it runs on Linux too.
+//
+//  Reports, per compiler configuration, the median and minimum over the
+//  iterations of:
+//    - merge:  decoding the base64 gfwlist and merging it under the user
+//              rules, i.e. PACRuleSet(gfwlist:userRules:)
+//    - render: writing the merged rules into the template
+//    - total:  PACCompiler.compile, both of the above
+//  and the size of the gfwlist.js written.
+//
+//  usage: make pac-compiler-bench PAC_COMPILER_BENCH_ARGS="[options]"
+//
+//    --rules N          gfwlist rules (default 100000)
+//    --user-rules N     user rules (default 1000)
+//    --iterations N     compiles per configuration (default 5)
+//    --template FILE    abp.js (default ShadowsocksX-NG/abp.js)
+//    --json FILE        write the results as JSON
+//
+
+import Foundation
+
+struct Options {
+    var rules = 100_000
+    var userRules = 1000
+    var iterations = 5
+    var template = "ShadowsocksX-NG/abp.js"
+    var json: String? = nil
+}
+
+func parseOptions(_ arguments: [String]) -> Options {
+    var options = Options()
+    var i = 0
+    func value() -> String {
+        guard i + 1 < arguments.count else {
+            fail("\(arguments[i]) needs a value")
+        }
+        i += 1
+        return arguments[i]
+    }
+    func count() -> Int {
+        let name = arguments[i]
+        guard let count = Int(value()), count > 0 else {
+            fail("\(name) must be positive")
+        }
+        return count
+    }
+    while i < arguments.count {
+        switch arguments[i] {
+        case "--rules": options.rules = count()
+        case "--user-rules": options.userRules = count()
+        case "--iterations": options.iterations = count()
+        case "--template": options.template = value()
+        case "--json": options.json = value()
+        default: fail("unknown option \(arguments[i])")
+        }
+        i += 1
+    }
+    return options
+}
+
+func fail(_ message: String) -> Never {
+    FileHandle.standardError.write(Data("pac-compiler-bench: \(message)\n".utf8))
+    exit(2)
+}
+
+// The mix of makeSyntheticGFWList in PACCompilerTests.swift: mostly domain
+// anchors, then start anchors, keywords, whitelist rules and regexes.
+func syntheticGFWList(ruleCount: Int) -> Data {
+    var lines = ["[AutoProxy 0.2.9]", "! Title: Synthetic", "!"]
+    lines.reserveCapacity(ruleCount + 3)
+    for i in 0..<ruleCount {
+        switch i % 10 {
+        case 0, 1, 2, 3, 4, 5:
+            lines.append("||site\(i).example\(i % 97).com")
+        case 6:
+            lines.append("|http://www.host\(i).net/path/\(i)")
+        case 7:
+            lines.append(".keyword\(i).org")
+        case 8:
+            lines.append("@@||direct\(i).cn")
+        default:
+            lines.append("/^https?:\\/\\/[^\\/]+regex\(i)\\.io/")
+        }
+    }
+    return Data(Data(lines.joined(separator: "\n").utf8).base64EncodedString(options: .lineLength64Characters).utf8)
+}
+
+func milliseconds(_ body: () -> Void) -> Double {
+    let start = DispatchTime.now().uptimeNanoseconds
+    body()
+    return Double(DispatchTime.now().uptimeNanoseconds - start) / 1e6
+}
+
+struct Timing: Codable {
+    let median: Double
+    let min: Double
+
+    init(_ samples: [Double]) {
+        let sorted = samples.sorted()
+        median = sorted[sorted.count / 2]
+        min = sorted[0]
+    }
+}
+
+struct ConfigurationResult: Codable {
+    let configuration: String
+    let merge: Timing
+    let render: Timing
+    let total: Timing
+    let bytes: Int
+}
+
+let options = parseOptions(Array(CommandLine.arguments.dropFirst()))
+guard let templateData = FileManager.default.contents(atPath: options.template) else {
+    fail("cannot read \(options.template)")
+}
+let template = PACTemplate(data: templateData)
+let gfwlist = syntheticGFWList(ruleCount: options.rules)
+let userRules = Data((0..<options.userRules).map { "||user\($0).example.com" }.joined(separator: "\n").utf8)
+
+let configurations: [(String, PACCompiler)] = [
+    ("default", PACCompiler(template: template)),
+    ("compact", PACCompiler(template: template, compactOutput: true)),
+    ("tables", PACCompiler(template: template, precompileDomainTables: true, compactOutput: true)),
+    ("tables+lowering", PACCompiler(template: template, precompileDomainTables: true, compactOutput: true
+        , lowerSlowFilters: true)),
+]
+
+print("\(options.rules) gfwlist rules, \(options.userRules) user rules, \(options.iterations) iterations, ms")
+print("configuration".padding(toLength: 18, withPad: " ", startingAt: 0)
+    + "   merge p50/min    render p50/min     total p50/min      bytes")
+var results: [ConfigurationResult] = []
+for (name, compiler) in configurations {
+    var merge: [Double] = []
+    var render: [Double] = []
+    var total: [Double] = []
+    var bytes = 0
+    for _ in 0..<options.iterations {
+        var ruleSet: PACRuleSet? = nil
+        merge.append(milliseconds {
+            ruleSet = PACRuleSet(gfwlist: gfwlist, userRules: userRules)
+        })
+        guard let rules = ruleSet?.rules else {
+            fail("the synthetic gfwlist does not decode")
+        }
+        render.append(milliseconds {
+            bytes = compiler.render(rules: rules, socks5Address: "127.0.0.1", socks5Port: 1086).count
+        })
+        total.append(milliseconds {
+            _ = compiler.compile(gfwlist: gfwlist, userRules: userRules, socks5Address: "127.0.0.1", socks5Port: 1086)
+        })
+    }
+    let result = ConfigurationResult(configuration: name, merge: Timing(merge), render: Timing(render)
+        , total: Timing(total), bytes: bytes)
+    results.append(result)
+    let columns = [result.merge, result.render, result.total].map {
+        String(format: "%8.1f/%-8.1f", $0.median, $0.min)
+    }
+    print(name.padding(toLength: 18, withPad: " ", startingAt: 0) + columns.joined(separator: " ")
+        + String(format: " %10ld", bytes))
+}
+
+if let json = options.json {
+    let encoder = JSONEncoder()
+    encoder.outputFormatting = .prettyPrinted
+    do {
+        try encoder.encode(results).write(to: URL(fileURLWithPath: json))
+    } catch {
+        fail("cannot write \(json): \(error)")
+    }
+}